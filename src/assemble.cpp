@@ -7,8 +7,11 @@
 #include <vector>   // std::vector
 
 #include "bitmasks.hpp"
+#include "cache.cpp"
+#include "debuginfo.cpp"
 #include "error.hpp"
 #include "globals.hpp"
+#include "linkinfo.cpp"
 #include "slice.cpp"
 #include "token.cpp"
 #include "types.hpp"
@@ -20,39 +23,104 @@ using std::vector;
 // This can be large as it is never aggregated
 #define MAX_LINE 512  // Includes '\0'
 
+// Part of the key for cached objects
+// MUST be incremented whenever the output of the assembler changes
+#define ASSEMBLER_VERSION 5
+
 // TODO(chore): Document functions
 // TODO(chore): Move all function doc comments to prototypes ?
 // TODO(refactor): Change some out-params to be return values
 
+// Assembled words are stored as a list of segments, each as: origin, word
+//     count, words. This is also the body of a segmented object file
+
 void assemble(
-    const char *const asm_filename, const ObjectFile &output, Error &error
+    FILE *const diagnostics,
+    const char *const asm_filename,
+    const ObjectFile &output,
+    AssemblyCache &cache,
+    Error &error
 );
-// Used by `assemble`
+// Used by `assemble` and `link`
+void write_words_to_memory(const vector<Word> &words);
 void write_obj_file(
-    const char *const filename, const vector<Word> &words, Error &error
+    FILE *const diagnostics,
+    const char *const filename,
+    const vector<Word> &words,
+    const LinkInfo &link_info,
+    Error &error
 );
 void assemble_file_to_words(
-    const char *const filename, vector<Word> &words, Error &error
+    FILE *const diagnostics,
+    const char *const filename,
+    vector<Word> &words,
+    DebugInfo &debug_info,
+    LinkInfo &link_info,
+    Error &error
+);
+void assemble_file_to_words_cached(
+    FILE *const diagnostics,
+    const char *const filename,
+    vector<Word> &words,
+    DebugInfo &debug_info,
+    LinkInfo &link_info,
+    AssemblyCache &cache,
+    Error &error
+);
+// Used by `assemble_file_to_words[_cached]`
+FILE *open_asm_file(FILE *const diagnostics, const char *const filename);
+void read_file_to_buffer(
+    FILE *const diagnostics,
+    const char *const filename,
+    vector<char> &buffer,
+    Error &error
+);
+void assemble_stream_to_words(
+    FILE *const diagnostics,
+    FILE *const asm_file,
+    vector<Word> &words,
+    DebugInfo &debug_info,
+    LinkInfo &link_info,
+    Error &error
 );
 
-// Used by `assemble_file_to_words`
+// Used by `assemble_stream_to_words`
+Word address_of_index(
+    const vector<Word> &words,
+    const vector<size_t> &segment_starts,
+    const size_t index
+);
+void check_segments_overlap(
+    FILE *const diagnostics,
+    const vector<Word> &words,
+    const vector<size_t> &segment_starts,
+    Error &error
+);
 void parse_line(
+    FILE *const diagnostics,
     vector<Word> &words,
     const char *&line,
     vector<LabelDefinition> &label_definitions,
     vector<LabelReference> &label_references,
+    LinkInfo &link_info,
     int line_number,
     bool &is_end,
+    LineKind &kind,
     bool &failed
 );
 void parse_directive(
+    FILE *const diagnostics,
     vector<Word> &words,
     const char *&line,
     const Directive directive,
+    vector<LabelReference> &label_references,
+    LinkInfo &link_info,
+    const int line_number,
     bool &is_end,
     bool &failed
 );
 void parse_instruction(
+    FILE *const diagnostics,
     Word &word,
     const char *&line,
     const Instruction &instruction,
@@ -63,37 +131,54 @@ void parse_instruction(
 );
 
 void print_invalid_operand(
+    FILE *const diagnostics,
     const char *const expected,
     const TokenKind token_kind,
     Instruction instruction
 );
-void expect_next_token(const char *&line, Token &token, bool &failed);
+void expect_next_token(
+    FILE *const diagnostics, const char *&line, Token &token, bool &failed
+);
 void expect_next_token_after_comma(
-    const char *&line, Token &token, bool &failed
+    FILE *const diagnostics, const char *&line, Token &token, bool &failed
 );
 void expect_token_is_kind(
-    const Token &token, const enum TokenKind kind, bool &failed
+    FILE *const diagnostics,
+    const Token &token,
+    const enum TokenKind kind,
+    bool &failed
 );
 void expect_integer_fits_size(
-    InitialSignWord integer, size_t size_bits, bool &failed
+    FILE *const diagnostics,
+    InitialSignWord integer,
+    size_t size_bits,
+    bool &failed
 );
-void expect_line_eol(const char *line, bool &failed);
+void expect_line_eol(FILE *const diagnostics, const char *line, bool &failed);
 
 uint8_t get_branch_condition_code(const Instruction instruction);
 TrapVector get_trap_vector(const Instruction instruction);
 void add_label_reference(
     vector<LabelReference> &references,
     const StringSlice &name,
-    const Word index,
+    const size_t index,
     const int line_number,
-    const bool is_offset11
+    const ReferenceKind kind
 );
 bool find_label_definition(
     const LabelString &target,
     const vector<LabelDefinition> &definitions,
-    SignedWord &index
+    size_t &index
+);
+bool find_external_symbol(
+    const LabelString &target,
+    const vector<ExternalSymbol> &externals,
+    Word &index
+);
+bool is_link_symbol_declared(
+    const StringSlice &name, const LinkInfo &link_info
 );
-char escape_character(const char ch, bool &failed);
+char escape_character(FILE *const diagnostics, const char ch, bool &failed);
 
 bool does_integer_fit_size(
     const InitialSignWord integer, const uint8_t size_bits
@@ -103,29 +188,74 @@ bool does_integer_fit_size_inner(
 );
 
 void assemble(
-    const char *const asm_filename, const ObjectFile &output, Error &error
+    FILE *const diagnostics,
+    const char *const asm_filename,
+    const ObjectFile &output,
+    AssemblyCache &cache,
+    Error &error
 ) {
     vector<Word> words;
-    assemble_file_to_words(asm_filename, words, error);
+    DebugInfo info;
+    LinkInfo link_info;
+    if (cache.directory == nullptr) {
+        assemble_file_to_words(
+            diagnostics, asm_filename, words, info, link_info, error
+        );
+    } else {
+        assemble_file_to_words_cached(
+            diagnostics, asm_filename, words, info, link_info, cache, error
+        );
+    }
     OK_OR_RETURN(error);
 
     if (output.kind == ObjectFile::FILE) {
-        write_obj_file(output.filename, words, error);
+        write_obj_file(diagnostics, output.filename, words, link_info, error);
         OK_OR_RETURN(error);
+        // Not written alongside stdout
+        if (output.filename[0] != '\0') {
+            write_debug_info_file(diagnostics, output.filename, info, error);
+            OK_OR_RETURN(error);
+        }
     } else {
+        if (link_info.externals.size() > 0) {
+            fprintf(
+                diagnostics,
+                "Program with `.EXTERNAL` labels must be assembled and "
+                "linked separately\n"
+            );
+            SET_ERROR(error, ASSEMBLE);
+            return;
+        }
         // TODO(refactor): Write to memory in `assemble_file_to_words`
         //      Saves a redundant copy of the array
-        const Word origin = words[0];
-        for (size_t i = 1; i < words.size(); ++i) {
-            memory[origin + i - 1] = words[i];
-        }
-        memory_file_bounds.start = origin;
-        memory_file_bounds.end = origin + words.size() - 1;
+        write_words_to_memory(words);
+        debug_info = info;
+    }
+}
+
+void write_words_to_memory(const vector<Word> &words) {
+    memory_file_bounds.start = MEMORY_USER_MAX;
+    memory_file_bounds.end = 0;
+    memory_file_bounds.entry = words[0];
+    // Gaps between segments are left as they are
+    for (size_t i = 0; i < words.size(); i += 2 + words[i + 1]) {
+        const Word origin = words[i];
+        const Word size = words[i + 1];
+        for (size_t j = 0; j < size; ++j)
+            memory[origin + j] = words[i + 2 + j];
+        if (origin < memory_file_bounds.start)
+            memory_file_bounds.start = origin;
+        if (origin + size > memory_file_bounds.end)
+            memory_file_bounds.end = origin + size;
     }
 }
 
 void write_obj_file(
-    const char *const filename, const vector<Word> &words, Error &error
+    FILE *const diagnostics,
+    const char *const filename,
+    const vector<Word> &words,
+    const LinkInfo &link_info,
+    Error &error
 ) {
     FILE *obj_file;
     if (filename[0] == '\0') {
@@ -135,14 +265,38 @@ void write_obj_file(
         obj_file = fopen(filename, "wb");
         if (obj_file == nullptr) {
             fprintf(
-                stderr, "Failed to open output file for writing: %s\n", filename
+                diagnostics,
+                "Failed to open output file for writing: %s\n",
+                filename
             );
             SET_ERROR(error, FILE);
             return;
         }
     }
 
-    for (size_t i = 0; i < words.size(); ++i) {
+    // A single segment is written in the plain format, without its size
+    vector<Word> header;
+    size_t body_start = 0;
+    if (link_info.is_relocatable) {
+        header.push_back(OBJECT_EXTENDED_MARKER);
+        header.push_back(static_cast<Word>(ObjectKind::RELOCATABLE));
+        Word segment_count = 0;
+        for (size_t i = 0; i < words.size(); i += 2 + words[i + 1])
+            ++segment_count;
+        header.push_back(segment_count);
+    } else if (words[1] + 2UL == words.size()) {
+        header.push_back(words[0]);
+        body_start = 2;
+    } else {
+        header.push_back(OBJECT_EXTENDED_MARKER);
+        header.push_back(static_cast<Word>(ObjectKind::SEGMENTED));
+    }
+
+    for (size_t i = 0; i < header.size(); ++i) {
+        const Word word = swap_endian(header[i]);
+        fwrite(&word, sizeof(Word), 1, obj_file);
+    }
+    for (size_t i = body_start; i < words.size(); ++i) {
         const Word word = swap_endian(words[i]);
         fwrite(&word, sizeof(Word), 1, obj_file);
         if (ferror(obj_file)) {
@@ -150,41 +304,137 @@ void write_obj_file(
             return;
         }
     }
+    if (link_info.is_relocatable && !write_link_info(obj_file, link_info)) {
+        SET_ERROR(error, FILE);
+        return;
+    }
 
     fclose(obj_file);
 }
 
 void assemble_file_to_words(
-    const char *const filename, vector<Word> &words, Error &error
+    FILE *const diagnostics,
+    const char *const filename,
+    vector<Word> &words,
+    DebugInfo &debug_info,
+    LinkInfo &link_info,
+    Error &error
+) {
+    FILE *const asm_file = open_asm_file(diagnostics, filename);
+    if (asm_file == nullptr) {
+        SET_ERROR(error, FILE);
+        return;
+    }
+    assemble_stream_to_words(
+        diagnostics, asm_file, words, debug_info, link_info, error
+    );
+    fclose(asm_file);
+}
+
+// Source file is read entirely before assembling, so that it can be hashed to
+//     look up in the cache. Nothing is tokenized if the object is cached.
+// Only successfully assembled objects are stored in the cache.
+void assemble_file_to_words_cached(
+    FILE *const diagnostics,
+    const char *const filename,
+    vector<Word> &words,
+    DebugInfo &debug_info,
+    LinkInfo &link_info,
+    AssemblyCache &cache,
+    Error &error
+) {
+    vector<char> source;
+    read_file_to_buffer(diagnostics, filename, source, error);
+    OK_OR_RETURN(error);
+
+    const uint32_t version = ASSEMBLER_VERSION;
+    uint64_t key = hash_bytes(&version, sizeof(version), FNV_OFFSET_BASIS);
+    key = hash_bytes(source.data(), source.size(), key);
+
+    if (cache_lookup(cache, key, source.size(), words, debug_info, link_info))
+        return;
+
+    const size_t source_size = source.size();
+    // `fmemopen` does not accept an empty buffer
+    // Extra newline does not affect assembly
+    if (source.size() == 0)
+        source.push_back('\n');
+
+    FILE *const asm_file = fmemopen(source.data(), source.size(), "r");
+    if (asm_file == nullptr) {
+        SET_ERROR(error, FILE);
+        return;
+    }
+    assemble_stream_to_words(
+        diagnostics, asm_file, words, debug_info, link_info, error
+    );
+    fclose(asm_file);
+    OK_OR_RETURN(error);
+
+    cache_store(cache, key, source_size, words, debug_info, link_info);
+}
+
+// Empty filename refers to stdin
+FILE *open_asm_file(FILE *const diagnostics, const char *const filename) {
+    if (filename[0] == '\0')
+        return stdin;
+    FILE *const asm_file = fopen(filename, "r");
+    if (asm_file == nullptr) {
+        fprintf(
+            diagnostics,
+            "Failed to open assembly file for reading: %s\n",
+            filename
+        );
+    }
+    return asm_file;
+}
+
+void read_file_to_buffer(
+    FILE *const diagnostics,
+    const char *const filename,
+    vector<char> &buffer,
+    Error &error
+) {
+    FILE *const file = open_asm_file(diagnostics, filename);
+    if (file == nullptr) {
+        SET_ERROR(error, FILE);
+        return;
+    }
+
+    char chunk[MAX_LINE];
+    size_t chunk_size;
+    while ((chunk_size = fread(chunk, 1, MAX_LINE, file)) > 0)
+        buffer.insert(buffer.end(), chunk, chunk + chunk_size);
+
+    if (ferror(file)) {
+        fprintf(diagnostics, "Failed to read assembly file: %s\n", filename);
+        SET_ERROR(error, FILE);
+    }
+    fclose(file);
+}
+
+void assemble_stream_to_words(
+    FILE *const diagnostics,
+    FILE *const asm_file,
+    vector<Word> &words,
+    DebugInfo &debug_info,
+    LinkInfo &link_info,
+    Error &error
 ) {
     // File errors are fatal to assembly process, all other errors can be
     // 'ignored' to allow parsing to continue to following lines. However, if
     // any error occurs, the program will stop after parsing, and not write the
     // output file (or execute, in ax mode).
 
-    FILE *asm_file;
-    if (filename[0] == '\0') {
-        asm_file = stdin;
-    } else {
-        asm_file = fopen(filename, "r");
-        if (asm_file == nullptr) {
-            fprintf(
-                stderr,
-                "Failed to open assembly file for reading: %s\n",
-                filename
-            );
-            SET_ERROR(error, FILE);
-            return;
-        }
-    }
-
     vector<LabelDefinition> label_definitions;
     vector<LabelReference> label_references;
+    vector<size_t> segment_starts;  // Index of origin of each segment
 
-    bool is_end = false;  // Set to `true` by `.END`
+    // Set to `false` by `.ORIG`, and `true` by `.END`
+    bool is_end = true;
 
     char line_buf[MAX_LINE];  // Buffer gets overwritten
-    for (int line_number = 1; !is_end; ++line_number) {
+    for (int line_number = 1;; ++line_number) {
         const char *line = line_buf;  // Pointer address is mutated
 
         if (fgets(line_buf, MAX_LINE, asm_file) == NULL)
@@ -194,52 +444,115 @@ void assemble_file_to_words(
             return;
         }
 
+        const size_t size_before = words.size();
+        const bool was_end = is_end;
+        LineKind kind = LineKind::CODE;  // Changed by directives
         bool failed = false;
         parse_line(
+            diagnostics,
             words,
             line,
             label_definitions,
             label_references,
+            link_info,
             line_number,
             is_end,
+            kind,
             failed
         );
 
         if (failed) {
-            fprintf(stderr, "\tLine %d\n", line_number);
+            fprintf(diagnostics, "\tLine %d\n", line_number);
             SET_ERROR(error, ASSEMBLE);
         }
+
+        if (was_end) {
+            if (!is_end)
+                segment_starts.push_back(size_before);
+            continue;
+        }
+
+        if (words.size() > size_before) {
+            const Word address =
+                address_of_index(words, segment_starts, size_before);
+            add_debug_line(debug_info, address, line_number, kind);
+        }
+        if (is_end) {
+            const size_t start = segment_starts.back();
+            const Word origin = words[start];
+            const size_t size = words.size() - start - 2;
+            if (origin + size > MEMORY_SIZE) {
+                fprintf(
+                    diagnostics,
+                    "Segment at 0x%04hx does not fit in memory\n",
+                    origin
+                );
+                fprintf(diagnostics, "\tLine %d\n", line_number);
+                SET_ERROR(error, ASSEMBLE);
+                continue;
+            }
+            words[start + 1] = size;
+            // Mark end of segment
+            if (origin + size < MEMORY_SIZE)
+                add_debug_line(
+                    debug_info, origin + size, 0, LineKind::RESERVED
+                );
+        }
     }
 
-    if (!is_end) {
-        fprintf(stderr, "File does not contain `.END` directive\n");
+    if (!is_end || segment_starts.size() == 0) {
+        fprintf(diagnostics, "File does not contain `.END` directive\n");
         SET_ERROR(error, ASSEMBLE);
+    } else {
+        check_segments_overlap(diagnostics, words, segment_starts, error);
     }
 
-    // Replace label references with PC offsets based on label definitions
+    // Replace label references with PC offsets (or addresses) based on label
+    //     definitions
     for (size_t i = 0; i < label_references.size(); ++i) {
         const LabelReference &ref = label_references[i];
+        const Word ref_address =
+            address_of_index(words, segment_starts, ref.index);
 
-        SignedWord index;
+        size_t index;
         if (!find_label_definition(ref.name, label_definitions, index)) {
-            fprintf(stderr, "Undefined label '%s'\n", ref.name);
-            fprintf(stderr, "\tLine %d\n", ref.line_number);
+            Word external;
+            if (find_external_symbol(ref.name, link_info.externals, external)) {
+                // Resolved when linking
+                link_info.fixups.push_back({ref.kind, ref_address, external});
+                continue;
+            }
+            fprintf(diagnostics, "Undefined label '%s'\n", ref.name);
+            fprintf(diagnostics, "\tLine %d\n", ref.line_number);
             SET_ERROR(error, ASSEMBLE);
             continue;
         }
 
-        const uint8_t size = (ref.is_offset11 ? 11 : 9);
+        // May be in different segments
+        const Word address = address_of_index(words, segment_starts, index);
+
+        if (ref.kind == ReferenceKind::ADDRESS) {
+            words[ref.index] = address;
+            // Other references are relative, so are unaffected by relocation
+            if (link_info.is_relocatable) {
+                link_info.fixups.push_back(
+                    {ref.kind, ref_address, FIXUP_OWN_MODULE}
+                );
+            }
+            continue;
+        }
+
+        const uint8_t size = (ref.kind == ReferenceKind::PC_OFFSET11 ? 11 : 9);
         const Word mask = (1U << size) - 1;
 
-        const SignedWord pc_offset =
-            index - static_cast<SignedWord>(ref.index) - 1;
+        const SignedWord pc_offset = address - ref_address - 1;
         if (!does_integer_fit_size_inner(pc_offset, size)) {
             fprintf(
-                stderr,
+                diagnostics,
                 "Label '%s' is too far away to be referenced\n",
                 ref.name
             );
-            fprintf(stderr, "\tLine %d\n", ref.line_number);
+            fprintf(diagnostics, "\tLine %d\n", ref.line_number);
             SET_ERROR(error, ASSEMBLE);
             continue;
         }
@@ -247,49 +560,177 @@ void assemble_file_to_words(
         words[ref.index] |= pc_offset & mask;
     }
 
-    fclose(asm_file);
+    for (size_t i = 0; i < label_definitions.size(); ++i) {
+        const LabelDefinition &def = label_definitions[i];
+        const Word address = address_of_index(words, segment_starts, def.index);
+        add_debug_symbol(debug_info, def.name, address);
+
+        Word external;
+        if (find_external_symbol(def.name, link_info.externals, external)) {
+            fprintf(
+                diagnostics,
+                "Label '%s' is declared as `.EXTERNAL`, but is defined\n",
+                def.name
+            );
+            SET_ERROR(error, ASSEMBLE);
+        }
+    }
+    sort_debug_info(debug_info);
+
+    for (size_t i = 0; i < link_info.globals.size(); ++i) {
+        Symbol &global = link_info.globals[i];
+        size_t index;
+        if (!find_label_definition(global.name, label_definitions, index)) {
+            fprintf(
+                diagnostics,
+                "Label '%s' is declared as `.GLOBAL`, but is not defined\n",
+                global.name
+            );
+            SET_ERROR(error, ASSEMBLE);
+            continue;
+        }
+        global.address = address_of_index(words, segment_starts, index);
+    }
+}
+
+// Address of word at `index`, in the last segment which starts before it
+// A label after the last word of a segment gets the address following it,
+//     as its index is the start of the next segment
+Word address_of_index(
+    const vector<Word> &words,
+    const vector<size_t> &segment_starts,
+    const size_t index
+) {
+    size_t low = 0;
+    size_t high = segment_starts.size();
+    // Find first segment starting at or after index
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (segment_starts[middle] < index)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == 0)
+        return 0;  // Only after an error
+    const size_t start = segment_starts[low - 1];
+    return words[start] + (index - start - 2);
+}
+
+typedef struct SegmentBounds {
+    Word origin;
+    Word size;
+} SegmentBounds;
+
+int compare_segments_by_origin(const void *const a, const void *const b) {
+    const Word a_origin = static_cast<const SegmentBounds *>(a)->origin;
+    const Word b_origin = static_cast<const SegmentBounds *>(b)->origin;
+    return (a_origin > b_origin) - (a_origin < b_origin);
+}
+
+void check_segments_overlap(
+    FILE *const diagnostics,
+    const vector<Word> &words,
+    const vector<size_t> &segment_starts,
+    Error &error
+) {
+    vector<SegmentBounds> segments(segment_starts.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+        segments[i].origin = words[segment_starts[i]];
+        segments[i].size = words[segment_starts[i] + 1];
+    }
+    qsort(
+        segments.data(),
+        segments.size(),
+        sizeof(SegmentBounds),
+        compare_segments_by_origin
+    );
+    for (size_t i = 1; i < segments.size(); ++i) {
+        const SegmentBounds &previous = segments[i - 1];
+        if (previous.origin + previous.size > segments[i].origin) {
+            fprintf(
+                diagnostics,
+                "Segments at 0x%04hx and 0x%04hx overlap\n",
+                previous.origin,
+                segments[i].origin
+            );
+            SET_ERROR(error, ASSEMBLE);
+        }
+    }
 }
 
 void parse_line(
+    FILE *const diagnostics,
     vector<Word> &words,
     const char *&line,
     vector<LabelDefinition> &label_definitions,
     vector<LabelReference> &label_references,
+    LinkInfo &link_info,
     int line_number,
     bool &is_end,
+    LineKind &kind,
     bool &failed
 ) {
     Token token;
-    take_next_token(line, token, failed);
+    take_next_token(diagnostics, line, token, failed);
     RETURN_IF_FAILED(failed);
 
     // Empty line (including line with only whitespace or a comment)
     if (token.kind == TokenKind::EOL)
         return;
 
-    if (words.size() == 0) {
-        if (token.kind != TokenKind::DIRECTIVE) {
-            fprintf(stderr, "First line must be `.ORIG` directive\n");
+    if (is_end) {
+        // May be declared before `.ORIG`
+        if (token.kind == TokenKind::DIRECTIVE &&
+            (token.value.directive == Directive::EXTERNAL ||
+             token.value.directive == Directive::GLOBAL)) {
+            parse_directive(
+                diagnostics,
+                words,
+                line,
+                token.value.directive,
+                label_references,
+                link_info,
+                line_number,
+                is_end,
+                failed
+            );
+            RETURN_IF_FAILED(failed);
+            expect_line_eol(diagnostics, line, failed);
+            return;
+        }
+        if (token.kind != TokenKind::DIRECTIVE ||
+            token.value.directive != Directive::ORIG) {
+            if (words.size() == 0) {
+                fprintf(diagnostics, "First line must be `.ORIG` directive\n");
+            } else {
+                fprintf(
+                    diagnostics, "Expected `.ORIG` directive after `.END`\n"
+                );
+            }
             failed = true;
             // Silence this error message for following lines
             // Compilation will not succeed regardless
-
             words.push_back(0x0000);
+            words.push_back(0x0000);
+            is_end = false;
             return;
         }
-        take_next_token(line, token, failed);
+        take_next_token(diagnostics, line, token, failed);
         RETURN_IF_FAILED(failed);
         // Must be unsigned
         if (token.kind != TokenKind::INTEGER || token.value.integer.is_signed) {
             fprintf(
-                stderr, "Positive integer literal required after `.ORIG`\n"
+                diagnostics, "Positive integer literal required after `.ORIG`\n"
             );
             failed = true;
             return;
         }
-        expect_line_eol(line, failed);
+        expect_line_eol(diagnostics, line, failed);
         RETURN_IF_FAILED(failed);
         words.push_back(token.value.integer.value);
+        words.push_back(0x0000);  // Size is set by `.END`
+        is_end = false;
         return;
     }
 
@@ -299,16 +740,20 @@ void parse_line(
 
         for (size_t i = 0; i < label_definitions.size(); ++i) {
             if (string_equals_slice(label_definitions[i].name, name)) {
-                fprintf(stderr, "Multiple labels are defined with the name '");
-                print_string_slice(stderr, name);
-                fprintf(stderr, "'\n");
+                fprintf(
+                    diagnostics, "Multiple labels are defined with the name '"
+                );
+                print_string_slice(diagnostics, name);
+                fprintf(diagnostics, "'\n");
                 failed = true;
                 return;
             }
             if (label_definitions[i].index == index) {
-                fprintf(stderr, "Label defined on already-labelled line '");
-                print_string_slice(stderr, name);
-                fprintf(stderr, "'\n");
+                fprintf(
+                    diagnostics, "Label defined on already-labelled line '"
+                );
+                print_string_slice(diagnostics, name);
+                fprintf(diagnostics, "'\n");
                 failed = true;
                 // Don't return, so that label still gets defined
             }
@@ -321,19 +766,31 @@ void parse_line(
         def.index = index;
 
         // Continue to instruction/directive after label
-        take_next_token(line, token, failed);
+        take_next_token(diagnostics, line, token, failed);
         RETURN_IF_FAILED(failed);
         // Skip if colon following label name
         if (token.kind == TokenKind::COLON) {
-            take_next_token(line, token, failed);
+            take_next_token(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
         }
     }
 
     if (token.kind == TokenKind::DIRECTIVE) {
-        parse_directive(words, line, token.value.directive, is_end, failed);
+        kind = token.value.directive == Directive::BLKW ? LineKind::RESERVED
+                                                        : LineKind::DATA;
+        parse_directive(
+            diagnostics,
+            words,
+            line,
+            token.value.directive,
+            label_references,
+            link_info,
+            line_number,
+            is_end,
+            failed
+        );
         RETURN_IF_FAILED(failed);
-        expect_line_eol(line, failed);
+        expect_line_eol(diagnostics, line, failed);
         RETURN_IF_FAILED(failed);
         return;  // Next line
     }
@@ -344,7 +801,7 @@ void parse_line(
 
     if (token.kind != TokenKind::INSTRUCTION) {
         fprintf(
-            stderr,
+            diagnostics,
             "Unexpected %s. Expected instruction or end of line\n",
             token_kind_to_string(token.kind)
         );
@@ -355,6 +812,7 @@ void parse_line(
     const Instruction instruction = token.value.instruction;
     Word word;
     parse_instruction(
+        diagnostics,
         word,
         line,
         instruction,
@@ -364,15 +822,19 @@ void parse_line(
         failed
     );
     RETURN_IF_FAILED(failed);
-    expect_line_eol(line, failed);
+    expect_line_eol(diagnostics, line, failed);
     RETURN_IF_FAILED(failed);
     words.push_back(word);
 }
 
 void parse_directive(
+    FILE *const diagnostics,
     vector<Word> &words,
     const char *&line,
     const Directive directive,
+    vector<LabelReference> &label_references,
+    LinkInfo &link_info,
+    const int line_number,
     bool &is_end,
     bool &failed
 ) {
@@ -380,7 +842,7 @@ void parse_directive(
 
     switch (directive) {
         case Directive::ORIG:
-            fprintf(stderr, "Unexpected `.ORIG` directive\n");
+            fprintf(diagnostics, "Unexpected `.ORIG` directive\n");
             failed = true;
             return;
 
@@ -390,9 +852,23 @@ void parse_directive(
             return;
 
         case Directive::FILL: {
-            expect_next_token(line, token, failed);
+            expect_next_token(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
-            expect_token_is_kind(token, TokenKind::INTEGER, failed);
+            // Address of label
+            if (token.kind == TokenKind::LABEL) {
+                add_label_reference(
+                    label_references,
+                    token.value.label,
+                    words.size(),
+                    line_number,
+                    ReferenceKind::ADDRESS
+                );
+                words.push_back(0x0000);
+                break;
+            }
+            expect_token_is_kind(
+                diagnostics, token, TokenKind::INTEGER, failed
+            );
             RETURN_IF_FAILED(failed);
             // Don't check integer size -- it should have been checked
             //     to fit in a word when token was parsed
@@ -401,12 +877,12 @@ void parse_directive(
         }; break;
 
         case Directive::BLKW: {
-            expect_next_token(line, token, failed);
+            expect_next_token(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
             if (token.kind != TokenKind::INTEGER ||
                 token.value.integer.is_signed) {
                 fprintf(
-                    stderr,
+                    diagnostics,
                     "Positive integer literal required after `.BLKW` "
                     "directive\n"
                 );
@@ -421,11 +897,11 @@ void parse_directive(
         }; break;
 
         case Directive::STRINGZ: {
-            take_next_token(line, token, failed);
+            take_next_token(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
             if (token.kind != TokenKind::STRING) {
                 fprintf(
-                    stderr,
+                    diagnostics,
                     "String literal required after `.STRINGZ` directive\n"
                 );
                 failed = true;
@@ -438,21 +914,52 @@ void parse_directive(
                     ++i;
                     // "... \" is treated as unterminated
                     if (i > token.value.string.length) {
-                        fprintf(stderr, "Unterminated string literal\n");
+                        fprintf(diagnostics, "Unterminated string literal\n");
                         failed = true;
                         return;
                     }
-                    ch = escape_character(string[i], failed);
+                    ch = escape_character(diagnostics, string[i], failed);
                     RETURN_IF_FAILED(failed);
                 }
                 words.push_back(static_cast<Word>(ch));
             }
             words.push_back(0x0000);  // Null-termination
         }; break;
+
+        case Directive::EXTERNAL:
+        case Directive::GLOBAL: {
+            expect_next_token(diagnostics, line, token, failed);
+            RETURN_IF_FAILED(failed);
+            expect_token_is_kind(diagnostics, token, TokenKind::LABEL, failed);
+            RETURN_IF_FAILED(failed);
+            const StringSlice &name = token.value.label;
+            if (is_link_symbol_declared(name, link_info)) {
+                fprintf(diagnostics, "Label '");
+                print_string_slice(diagnostics, name);
+                fprintf(diagnostics, "' is already declared\n");
+                failed = true;
+                return;
+            }
+            // Label length has already been checked
+            if (directive == Directive::EXTERNAL) {
+                link_info.externals.push_back({});
+                copy_string_slice_to_string(
+                    link_info.externals.back().name, name
+                );
+            } else {
+                // Address is found after all labels are defined
+                link_info.globals.push_back({});
+                copy_string_slice_to_string(
+                    link_info.globals.back().name, name
+                );
+            }
+            link_info.is_relocatable = true;
+        }; break;
     }
 }
 
 void parse_instruction(
+    FILE *const diagnostics,
     Word &word,
     const char *&line,
     const Instruction &instruction,
@@ -471,16 +978,20 @@ void parse_instruction(
             opcode =
                 instruction == Instruction::ADD ? Opcode::ADD : Opcode::AND;
 
-            expect_next_token(line, token, failed);
+            expect_next_token(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
-            expect_token_is_kind(token, TokenKind::REGISTER, failed);
+            expect_token_is_kind(
+                diagnostics, token, TokenKind::REGISTER, failed
+            );
             RETURN_IF_FAILED(failed);
             const Register dest_reg = token.value.register_;
             operands |= dest_reg << 9;
 
-            expect_next_token_after_comma(line, token, failed);
+            expect_next_token_after_comma(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
-            expect_token_is_kind(token, TokenKind::REGISTER, failed);
+            expect_token_is_kind(
+                diagnostics, token, TokenKind::REGISTER, failed
+            );
             RETURN_IF_FAILED(failed);
             const Register src_reg_a = token.value.register_;
             operands |= src_reg_a << 6;
@@ -488,19 +999,20 @@ void parse_instruction(
             // TODO(feat): Replace `expect_token_is_kind` with
             //     `print_invalid_operand` or something
 
-            expect_next_token_after_comma(line, token, failed);
+            expect_next_token_after_comma(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
             if (token.kind == TokenKind::REGISTER) {
                 const Register src_reg_b = token.value.register_;
                 operands |= src_reg_b;
             } else if (token.kind == TokenKind::INTEGER) {
                 const InitialSignWord immediate = token.value.integer;
-                expect_integer_fits_size(immediate, 5, failed);
+                expect_integer_fits_size(diagnostics, immediate, 5, failed);
                 RETURN_IF_FAILED(failed);
                 operands |= 1 << 5;  // Flag
                 operands |= immediate.value & BITMASK_LOW_5;
             } else {
                 print_invalid_operand(
+                    diagnostics,
                     "integer or label", token.kind, instruction
                 );
                 failed = true;
@@ -511,16 +1023,20 @@ void parse_instruction(
         case Instruction::NOT: {
             opcode = Opcode::NOT;
 
-            expect_next_token(line, token, failed);
+            expect_next_token(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
-            expect_token_is_kind(token, TokenKind::REGISTER, failed);
+            expect_token_is_kind(
+                diagnostics, token, TokenKind::REGISTER, failed
+            );
             RETURN_IF_FAILED(failed);
             const Register dest_reg = token.value.register_;
             operands |= dest_reg << 9;
 
-            expect_next_token_after_comma(line, token, failed);
+            expect_next_token_after_comma(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
-            expect_token_is_kind(token, TokenKind::REGISTER, failed);
+            expect_token_is_kind(
+                diagnostics, token, TokenKind::REGISTER, failed
+            );
             RETURN_IF_FAILED(failed);
             const Register src_reg = token.value.register_;
             operands |= src_reg << 6;
@@ -540,11 +1056,13 @@ void parse_instruction(
             const uint8_t condition = get_branch_condition_code(instruction);
             operands |= condition << 9;
 
-            expect_next_token(line, token, failed);
+            expect_next_token(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
             if (token.kind == TokenKind::INTEGER) {
                 // 9 bits
-                expect_integer_fits_size(token.value.integer, 9, failed);
+                expect_integer_fits_size(
+                    diagnostics, token.value.integer, 9, failed
+                );
                 RETURN_IF_FAILED(failed);
                 operands |= token.value.integer.value & BITMASK_LOW_9;
             } else if (token.kind == TokenKind::LABEL) {
@@ -553,10 +1071,11 @@ void parse_instruction(
                     token.value.label,
                     word_index,
                     line_number,
-                    false
+                    ReferenceKind::PC_OFFSET9
                 );
             } else {
                 print_invalid_operand(
+                    diagnostics,
                     "integer or label", token.kind, instruction
                 );
                 failed = true;
@@ -570,9 +1089,11 @@ void parse_instruction(
 
             Register addr_reg = 7;  // Default R7 for `RET`
             if (instruction == Instruction::JMP) {
-                expect_next_token(line, token, failed);
+                expect_next_token(diagnostics, line, token, failed);
                 RETURN_IF_FAILED(failed);
-                expect_token_is_kind(token, TokenKind::REGISTER, failed);
+                expect_token_is_kind(
+                    diagnostics, token, TokenKind::REGISTER, failed
+                );
                 RETURN_IF_FAILED(failed);
                 addr_reg = token.value.register_;
             }
@@ -587,11 +1108,13 @@ void parse_instruction(
                 operands |= 1 << 11;  // Flag
 
                 // PCOffset11
-                expect_next_token(line, token, failed);
+                expect_next_token(diagnostics, line, token, failed);
                 RETURN_IF_FAILED(failed);
                 if (token.kind == TokenKind::INTEGER) {
                     // 11 bits
-                    expect_integer_fits_size(token.value.integer, 11, failed);
+                    expect_integer_fits_size(
+                        diagnostics, token.value.integer, 11, failed
+                    );
                     RETURN_IF_FAILED(failed);
                     operands |= token.value.integer.value & BITMASK_LOW_11;
                 } else if (token.kind == TokenKind::LABEL) {
@@ -600,17 +1123,19 @@ void parse_instruction(
                         token.value.label,
                         word_index,
                         line_number,
-                        true
+                        ReferenceKind::PC_OFFSET11
                     );
                 } else {
-                    fprintf(stderr, "Invalid operand\n");
+                    fprintf(diagnostics, "Invalid operand\n");
                     failed = true;
                     return;
                 }
             } else {
-                expect_next_token(line, token, failed);
+                expect_next_token(diagnostics, line, token, failed);
                 RETURN_IF_FAILED(failed);
-                expect_token_is_kind(token, TokenKind::REGISTER, failed);
+                expect_token_is_kind(
+                    diagnostics, token, TokenKind::REGISTER, failed
+                );
                 RETURN_IF_FAILED(failed);
                 const Register addr_reg = token.value.register_;
                 operands |= addr_reg << 6;
@@ -638,18 +1163,22 @@ void parse_instruction(
                     UNREACHABLE();
             }
 
-            expect_next_token(line, token, failed);
+            expect_next_token(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
-            expect_token_is_kind(token, TokenKind::REGISTER, failed);
+            expect_token_is_kind(
+                diagnostics, token, TokenKind::REGISTER, failed
+            );
             RETURN_IF_FAILED(failed);
             const Register ds_reg = token.value.register_;
             operands |= ds_reg << 9;
 
-            expect_next_token_after_comma(line, token, failed);
+            expect_next_token_after_comma(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
             if (token.kind == TokenKind::INTEGER) {
                 // 9 bits
-                expect_integer_fits_size(token.value.integer, 9, failed);
+                expect_integer_fits_size(
+                    diagnostics, token.value.integer, 9, failed
+                );
                 RETURN_IF_FAILED(failed);
                 operands |= token.value.integer.value & BITMASK_LOW_9;
             } else if (token.kind == TokenKind::LABEL) {
@@ -658,10 +1187,10 @@ void parse_instruction(
                     token.value.label,
                     word_index,
                     line_number,
-                    false
+                    ReferenceKind::PC_OFFSET9
                 );
             } else {
-                fprintf(stderr, "Invalid operand\n");
+                fprintf(diagnostics, "Invalid operand\n");
                 failed = true;
                 return;
             }
@@ -672,28 +1201,34 @@ void parse_instruction(
             opcode =
                 instruction == Instruction::LDR ? Opcode::LDR : Opcode::STR;
 
-            expect_next_token(line, token, failed);
+            expect_next_token(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
-            expect_token_is_kind(token, TokenKind::REGISTER, failed);
+            expect_token_is_kind(
+                diagnostics, token, TokenKind::REGISTER, failed
+            );
             RETURN_IF_FAILED(failed);
             const Register ds_reg = token.value.register_;
             operands |= ds_reg << 9;
 
-            expect_next_token_after_comma(line, token, failed);
+            expect_next_token_after_comma(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
-            expect_token_is_kind(token, TokenKind::REGISTER, failed);
+            expect_token_is_kind(
+                diagnostics, token, TokenKind::REGISTER, failed
+            );
             RETURN_IF_FAILED(failed);
             const Register base_reg = token.value.register_;
             operands |= base_reg << 6;
 
-            expect_next_token_after_comma(line, token, failed);
+            expect_next_token_after_comma(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
-            expect_token_is_kind(token, TokenKind::INTEGER, failed);
+            expect_token_is_kind(
+                diagnostics, token, TokenKind::INTEGER, failed
+            );
             RETURN_IF_FAILED(failed);
 
             const InitialSignWord immediate = token.value.integer;
             // 6 bits
-            expect_integer_fits_size(immediate, 6, failed);
+            expect_integer_fits_size(diagnostics, immediate, 6, failed);
             RETURN_IF_FAILED(failed);
             operands |= immediate.value & BITMASK_LOW_6;
         }; break;
@@ -701,18 +1236,22 @@ void parse_instruction(
         case Instruction::LEA: {
             opcode = Opcode::LEA;
 
-            expect_next_token(line, token, failed);
+            expect_next_token(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
-            expect_token_is_kind(token, TokenKind::REGISTER, failed);
+            expect_token_is_kind(
+                diagnostics, token, TokenKind::REGISTER, failed
+            );
             RETURN_IF_FAILED(failed);
             const Register dest_reg = token.value.register_;
             operands |= dest_reg << 9;
 
-            expect_next_token_after_comma(line, token, failed);
+            expect_next_token_after_comma(diagnostics, line, token, failed);
             RETURN_IF_FAILED(failed);
             if (token.kind == TokenKind::INTEGER) {
                 // 9 bits
-                expect_integer_fits_size(token.value.integer, 9, failed);
+                expect_integer_fits_size(
+                    diagnostics, token.value.integer, 9, failed
+                );
                 RETURN_IF_FAILED(failed);
                 operands |= token.value.integer.value & BITMASK_LOW_9;
             } else if (token.kind == TokenKind::LABEL) {
@@ -721,10 +1260,10 @@ void parse_instruction(
                     token.value.label,
                     word_index,
                     line_number,
-                    false
+                    ReferenceKind::PC_OFFSET9
                 );
             } else {
-                fprintf(stderr, "Invalid operand\n");
+                fprintf(diagnostics, "Invalid operand\n");
                 failed = true;
                 return;
             }
@@ -745,13 +1284,13 @@ void parse_instruction(
             switch (instruction) {
                 // Trap instruction with explicit code
                 case Instruction::TRAP: {
-                    expect_next_token(line, token, failed);
+                    expect_next_token(diagnostics, line, token, failed);
                     RETURN_IF_FAILED(failed);
                     // Don't allow explicit sign
                     if (token.kind != TokenKind::INTEGER ||
                         token.value.integer.is_signed) {
                         fprintf(
-                            stderr,
+                            diagnostics,
                             "Positive integer literal required after "
                             "`TRAP` instruction\n"
                         );
@@ -761,7 +1300,7 @@ void parse_instruction(
                     const InitialSignWord immediate = token.value.integer;
                     // 8 bits -- always positive
                     // This incurs a redundant sign check, this is fine
-                    expect_integer_fits_size(immediate, 8, failed);
+                    expect_integer_fits_size(diagnostics, immediate, 8, failed);
                     RETURN_IF_FAILED(failed);
                     // TODO(correctness): What happens if cast fails?
                     trap_vector = immediate.value;
@@ -783,12 +1322,13 @@ void parse_instruction(
 }
 
 void print_invalid_operand(
+    FILE *const diagnostics,
     const char *const expected,
     const TokenKind token_kind,
     Instruction instruction
 ) {
     fprintf(
-        stderr,
+        diagnostics,
         "Unexpected %s. Expected %s operand for `%s` instruction\n",
         token_kind_to_string(token_kind),
         expected,
@@ -796,26 +1336,28 @@ void print_invalid_operand(
     );
 }
 
-void expect_next_token(const char *&line, Token &token, bool &failed) {
-    take_next_token(line, token, failed);
+void expect_next_token(
+    FILE *const diagnostics, const char *&line, Token &token, bool &failed
+) {
+    take_next_token(diagnostics, line, token, failed);
     RETURN_IF_FAILED(failed);
     if (token.kind == TokenKind::EOL) {
-        fprintf(stderr, "Expected operand\n");
+        fprintf(diagnostics, "Expected operand\n");
         failed = true;
     }
 }
 
 void expect_next_token_after_comma(
-    const char *&line, Token &token, bool &failed
+    FILE *const diagnostics, const char *&line, Token &token, bool &failed
 ) {
-    take_next_token(line, token, failed);
+    take_next_token(diagnostics, line, token, failed);
     RETURN_IF_FAILED(failed);
     if (token.kind == TokenKind::COMMA) {
-        take_next_token(line, token, failed);
+        take_next_token(diagnostics, line, token, failed);
         RETURN_IF_FAILED(failed);
     }
     if (token.kind == TokenKind::EOL) {
-        fprintf(stderr, "Expected operand\n");
+        fprintf(diagnostics, "Expected operand\n");
         failed = true;
     }
 }
@@ -823,29 +1365,35 @@ void expect_next_token_after_comma(
 // TODO(refactor): Remove these wrapper functions when error handling is good
 
 void expect_token_is_kind(
-    const Token &token, const enum TokenKind kind, bool &failed
+    FILE *const diagnostics,
+    const Token &token,
+    const enum TokenKind kind,
+    bool &failed
 ) {
     if (token.kind != kind) {
-        fprintf(stderr, "Invalid operand\n");
+        fprintf(diagnostics, "Invalid operand\n");
         failed = true;
     }
 }
 
 void expect_integer_fits_size(
-    InitialSignWord integer, size_t size_bits, bool &failed
+    FILE *const diagnostics,
+    InitialSignWord integer,
+    size_t size_bits,
+    bool &failed
 ) {
     if (!does_integer_fit_size(integer, size_bits)) {
-        fprintf(stderr, "Immediate too large\n");
+        fprintf(diagnostics, "Immediate too large\n");
         failed = true;
     }
 }
 
-void expect_line_eol(const char *line, bool &failed) {
+void expect_line_eol(FILE *const diagnostics, const char *line, bool &failed) {
     Token token;
-    take_next_token(line, token, failed);
+    take_next_token(diagnostics, line, token, failed);
     RETURN_IF_FAILED(failed);
     if (token.kind != TokenKind::EOL) {
-        fprintf(stderr, "Unexpected operand after instruction\n");
+        fprintf(diagnostics, "Unexpected operand after instruction\n");
         failed = true;
     }
 }
@@ -900,9 +1448,9 @@ TrapVector get_trap_vector(const Instruction instruction) {
 void add_label_reference(
     vector<LabelReference> &references,
     const StringSlice &name,
-    const Word index,
+    const size_t index,
     const int line_number,
-    const bool is_offset11
+    const ReferenceKind kind
 ) {
     references.push_back({});
     LabelReference &ref = references.back();
@@ -910,13 +1458,13 @@ void add_label_reference(
     copy_string_slice_to_string(ref.name, name);
     ref.index = index;
     ref.line_number = line_number;
-    ref.is_offset11 = is_offset11;
+    ref.kind = kind;
 }
 
 bool find_label_definition(
     const LabelString &target,
     const vector<LabelDefinition> &definitions,
-    SignedWord &index
+    size_t &index
 ) {
     for (size_t j = 0; j < definitions.size(); ++j) {
         const LabelDefinition candidate = definitions[j];
@@ -930,7 +1478,36 @@ bool find_label_definition(
     return false;
 }
 
-char escape_character(const char ch, bool &failed) {
+bool find_external_symbol(
+    const LabelString &target,
+    const vector<ExternalSymbol> &externals,
+    Word &index
+) {
+    for (size_t i = 0; i < externals.size(); ++i) {
+        if (!strcasecmp(externals[i].name, target)) {
+            index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Either as `.EXTERNAL` or `.GLOBAL`
+bool is_link_symbol_declared(
+    const StringSlice &name, const LinkInfo &link_info
+) {
+    for (size_t i = 0; i < link_info.externals.size(); ++i) {
+        if (string_equals_slice(link_info.externals[i].name, name))
+            return true;
+    }
+    for (size_t i = 0; i < link_info.globals.size(); ++i) {
+        if (string_equals_slice(link_info.globals[i].name, name))
+            return true;
+    }
+    return false;
+}
+
+char escape_character(FILE *const diagnostics, const char ch, bool &failed) {
     switch (ch) {
         case 'n':
             return '\n';
@@ -941,7 +1518,7 @@ char escape_character(const char ch, bool &failed) {
         case '0':
             return '\0';
         default:
-            fprintf(stderr, "Invalid escape sequence '\\%c'\n", ch);
+            fprintf(diagnostics, "Invalid escape sequence '\\%c'\n", ch);
             failed = true;
             return 0x7f;
     }
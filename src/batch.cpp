@@ -0,0 +1,146 @@
+#ifndef BATCH_CPP
+#define BATCH_CPP
+
+#include <pthread.h>  // pthread_create, pthread_mutex_t, etc
+#include <unistd.h>   // sysconf
+
+#include <cstdio>   // open_memstream, fprintf, etc
+#include <cstdlib>  // free
+#include <vector>   // std::vector
+
+#include "assemble.cpp"
+#include "cli.cpp"
+#include "error.hpp"
+#include "types.hpp"
+
+using std::vector;
+
+// One input file of `assemble_all`
+typedef struct AssembleJob {
+    const char *asm_filename;
+    char obj_filename[FILENAME_MAX];
+    // Diagnostics are buffered for each file, and only printed once every job
+    // is done, so that output does not depend on thread scheduling
+    char *diagnostics;
+    size_t diagnostics_size;
+    AssemblyCache cache;  // Copy of shared config, with stats of this job only
+    Error error;
+} AssembleJob;
+
+// Shared by all worker threads
+typedef struct AssembleQueue {
+    AssembleJob *jobs;
+    size_t count;
+    size_t next;  // Index of next job to be taken by a worker
+    pthread_mutex_t lock;
+} AssembleQueue;
+
+void assemble_all(
+    const vector<const char *> &asm_filenames,
+    const int jobs,
+    AssemblyCache &cache,
+    Error &error
+);
+// Used by `assemble_all`
+void *assemble_worker(void *const queue_ptr);
+void assemble_job(AssembleJob &job);
+
+// Assemble each file to a .obj file next to it, using a pool of threads
+// `jobs` of 0 uses one thread per CPU
+// `error` is set to the error of the first failing file, in the order given
+// Cache stats of all jobs are added to `cache`
+void assemble_all(
+    const vector<const char *> &asm_filenames,
+    const int jobs,
+    AssemblyCache &cache,
+    Error &error
+) {
+    vector<AssembleJob> job_list(asm_filenames.size());
+    for (size_t i = 0; i < job_list.size(); ++i) {
+        AssembleJob &job = job_list[i];
+        job.asm_filename = asm_filenames[i];
+        copy_filename_with_extension(job.obj_filename, job.asm_filename);
+        job.diagnostics = nullptr;
+        job.diagnostics_size = 0;
+        job.cache.directory = cache.directory;
+        job.cache.max_bytes = cache.max_bytes;
+        job.error = Error::OK;
+    }
+
+    AssembleQueue queue;
+    queue.jobs = job_list.data();
+    queue.count = job_list.size();
+    queue.next = 0;
+    pthread_mutex_init(&queue.lock, nullptr);
+
+    long thread_count = jobs;
+    if (thread_count <= 0)
+        thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (thread_count < 1)
+        thread_count = 1;
+    if (thread_count > MAX_ASSEMBLE_JOBS)
+        thread_count = MAX_ASSEMBLE_JOBS;
+    if (thread_count > static_cast<long>(job_list.size()))
+        thread_count = job_list.size();
+
+    // This thread is also a worker, so spawn one less
+    pthread_t threads[MAX_ASSEMBLE_JOBS];
+    long spawned = 0;
+    for (; spawned < thread_count - 1; ++spawned) {
+        // Any jobs not taken by a thread get done by this thread instead
+        if (pthread_create(
+                &threads[spawned], nullptr, assemble_worker, &queue
+            ) != 0)
+            break;
+    }
+    assemble_worker(&queue);
+    for (long i = 0; i < spawned; ++i)
+        pthread_join(threads[i], nullptr);
+
+    pthread_mutex_destroy(&queue.lock);
+
+    for (size_t i = 0; i < job_list.size(); ++i) {
+        AssembleJob &job = job_list[i];
+        if (job.diagnostics_size > 0) {
+            fprintf(stderr, "%s:\n", job.asm_filename);
+            fwrite(job.diagnostics, 1, job.diagnostics_size, stderr);
+        }
+        free(job.diagnostics);
+        add_cache_stats(cache.stats, job.cache.stats);
+        if (error == Error::OK)
+            error = job.error;
+    }
+}
+
+void *assemble_worker(void *const queue_ptr) {
+    AssembleQueue &queue = *static_cast<AssembleQueue *>(queue_ptr);
+    while (true) {
+        pthread_mutex_lock(&queue.lock);
+        const size_t index = queue.next;
+        if (index < queue.count)
+            ++queue.next;
+        pthread_mutex_unlock(&queue.lock);
+
+        if (index >= queue.count)
+            return nullptr;
+        assemble_job(queue.jobs[index]);
+    }
+}
+
+void assemble_job(AssembleJob &job) {
+    FILE *diagnostics =
+        open_memstream(&job.diagnostics, &job.diagnostics_size);
+    // Out of memory. Diagnostics will not be grouped, but are still shown
+    if (diagnostics == nullptr)
+        diagnostics = stderr;
+
+    ObjectFile object;
+    object.kind = ObjectFile::FILE;
+    object.filename = job.obj_filename;
+    assemble(diagnostics, job.asm_filename, object, job.cache, job.error);
+
+    if (diagnostics != stderr)
+        fclose(diagnostics);  // Sets `job.diagnostics[_size]`
+}
+
+#endif
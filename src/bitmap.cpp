@@ -0,0 +1,29 @@
+#ifndef BITMAP_CPP
+#define BITMAP_CPP
+
+#include <cstdint>  // uint64_t
+
+#include "types.hpp"
+
+// One bit per word of memory (8 KiB)
+#define ADDRESS_BITMAP_SIZE (MEMORY_SIZE / 64)
+
+typedef uint64_t AddressBitmap[ADDRESS_BITMAP_SIZE];
+
+inline bool bitmap_test(const AddressBitmap bitmap, const Word addr) {
+    return (bitmap[addr >> 6] >> (addr & 63)) & 1;
+}
+
+// Returns `false` if bit already had that value
+inline bool bitmap_set(
+    AddressBitmap bitmap, const Word addr, const bool value
+) {
+    uint64_t &bits = bitmap[addr >> 6];
+    const uint64_t mask = 1ULL << (addr & 63);
+    if (((bits & mask) != 0) == value)
+        return false;
+    bits ^= mask;
+    return true;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef BYTES_CPP
+#define BYTES_CPP
+
+#include <cstdint>  // uint8_t, etc
+#include <cstdio>   // FILE, fread, fwrite
+
+// Big-endian integers, for binary files written by this program
+// Object files use big-endian words, so all other formats do too
+
+bool write_u8(FILE *const file, const uint8_t value);
+bool write_u16(FILE *const file, const uint16_t value);
+bool write_u32(FILE *const file, const uint32_t value);
+bool read_u8(FILE *const file, uint8_t &value);
+bool read_u16(FILE *const file, uint16_t &value);
+bool read_u32(FILE *const file, uint32_t &value);
+
+bool write_u8(FILE *const file, const uint8_t value) {
+    return fwrite(&value, 1, 1, file) == 1;
+}
+
+bool write_u16(FILE *const file, const uint16_t value) {
+    const uint8_t bytes[2] = {
+        static_cast<uint8_t>(value >> 8),
+        static_cast<uint8_t>(value),
+    };
+    return fwrite(bytes, 1, 2, file) == 2;
+}
+
+bool write_u32(FILE *const file, const uint32_t value) {
+    const uint8_t bytes[4] = {
+        static_cast<uint8_t>(value >> 24),
+        static_cast<uint8_t>(value >> 16),
+        static_cast<uint8_t>(value >> 8),
+        static_cast<uint8_t>(value),
+    };
+    return fwrite(bytes, 1, 4, file) == 4;
+}
+
+bool read_u8(FILE *const file, uint8_t &value) {
+    return fread(&value, 1, 1, file) == 1;
+}
+
+bool read_u16(FILE *const file, uint16_t &value) {
+    uint8_t bytes[2];
+    if (fread(bytes, 1, 2, file) != 2)
+        return false;
+    value = static_cast<uint16_t>(bytes[0] << 8 | bytes[1]);
+    return true;
+}
+
+bool read_u32(FILE *const file, uint32_t &value) {
+    uint8_t bytes[4];
+    if (fread(bytes, 1, 4, file) != 4)
+        return false;
+    value = static_cast<uint32_t>(bytes[0]) << 24 |
+            static_cast<uint32_t>(bytes[1]) << 16 |
+            static_cast<uint32_t>(bytes[2]) << 8 | bytes[3];
+    return true;
+}
+
+#endif
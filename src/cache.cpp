@@ -0,0 +1,330 @@
+#ifndef CACHE_CPP
+#define CACHE_CPP
+
+#include <dirent.h>    // opendir, readdir
+#include <sys/stat.h>  // stat, mkdir
+#include <unistd.h>    // unlink
+#include <utime.h>     // utime
+
+#include <cerrno>   // errno, EEXIST
+#include <cstdio>   // FILE, fopen, etc
+#include <cstdlib>  // qsort, mkstemp
+#include <cstring>  // strlen, strcmp
+#include <ctime>    // time_t
+#include <vector>   // std::vector
+
+#include "bytes.cpp"
+#include "debuginfo.cpp"
+#include "linkinfo.cpp"
+#include "types.hpp"
+
+using std::vector;
+
+// Cached objects are stored as `<directory>/<key>.lac`
+#define CACHE_EXTENSION ".lac"
+#define CACHE_KEY_DIGITS 16  // Hex digits of a 64-bit key
+#define CACHE_MAGIC 0x4c41'5343  // "LASC"
+
+#define CACHE_DEFAULT_MAX_KIB (64 * 1024)
+
+// Every word of memory in its own segment, after a 2-word header
+#define CACHE_MAX_WORDS (3 * MEMORY_SIZE)
+
+// Used to build cache paths. Directory names are limited by `FILENAME_MAX`
+#define MAX_CACHE_PATH (FILENAME_MAX + CACHE_KEY_DIGITS + 16)
+
+#define FNV_OFFSET_BASIS 0xcbf2'9ce4'8422'2325ULL
+#define FNV_PRIME 0x0000'0100'0000'01b3ULL
+
+typedef struct CacheStats {
+    size_t hits;
+    size_t misses;
+    size_t stores;
+    size_t evictions;
+    // Only known after `evict_cache`
+    size_t entries;
+    size_t total_bytes;
+} CacheStats;
+
+// On-disk cache of assembled objects, keyed by a hash of the source file
+// Each assembly job has its own instance, so nothing here needs locking.
+//     Concurrent jobs may share a directory: entries are written to a
+//     temporary file then renamed, so readers never see partial entries.
+typedef struct AssemblyCache {
+    const char *directory = nullptr;  // `nullptr` if cache is disabled
+    size_t max_bytes = CACHE_DEFAULT_MAX_KIB * 1024;
+    CacheStats stats = {};
+} AssemblyCache;
+
+uint64_t hash_bytes(const void *const bytes, const size_t size, uint64_t hash);
+
+bool cache_lookup(
+    AssemblyCache &cache,
+    const uint64_t key,
+    const size_t source_size,
+    vector<Word> &words,
+    DebugInfo &debug_info,
+    LinkInfo &link_info
+);
+// Used by `cache_lookup`
+bool are_cached_segments_valid(const vector<Word> &words);
+void cache_store(
+    AssemblyCache &cache,
+    const uint64_t key,
+    const size_t source_size,
+    const vector<Word> &words,
+    const DebugInfo &debug_info,
+    const LinkInfo &link_info
+);
+void evict_cache(AssemblyCache &cache);
+void add_cache_stats(CacheStats &total, const CacheStats &stats);
+void print_cache_stats(const AssemblyCache &cache);
+
+// Used by `cache_*` functions
+void cache_entry_path(
+    char *const path, const AssemblyCache &cache, const uint64_t key
+);
+
+// FNV-1a. Pass `FNV_OFFSET_BASIS` as `hash` to begin a new hash
+uint64_t hash_bytes(const void *const bytes, const size_t size, uint64_t hash) {
+    const uint8_t *const data = static_cast<const uint8_t *>(bytes);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Entry format (all integers big-endian, like .obj files):
+//     u32     magic
+//     u32     size of source file (guards against hash collisions)
+//     u32     word count
+//     u16[]   words (as in .obj file)
+//     debug info (as in .dbg file)
+//     u8      1 if relocatable, followed by link info (as in .obj file)
+bool cache_lookup(
+    AssemblyCache &cache,
+    const uint64_t key,
+    const size_t source_size,
+    vector<Word> &words,
+    DebugInfo &debug_info,
+    LinkInfo &link_info
+) {
+    char path[MAX_CACHE_PATH];
+    cache_entry_path(path, cache, key);
+
+    FILE *const file = fopen(path, "rb");
+    if (file == nullptr) {
+        ++cache.stats.misses;
+        return false;
+    }
+
+    uint32_t magic, size, count;
+    bool valid = read_u32(file, magic) && magic == CACHE_MAGIC &&
+                 read_u32(file, size) && size == source_size &&
+                 read_u32(file, count) && count <= CACHE_MAX_WORDS;
+    if (valid) {
+        words.resize(count);
+        valid = fread(words.data(), WORD_SIZE, count, file) == count;
+        for (size_t i = 0; i < words.size(); ++i)
+            words[i] = swap_endian(words[i]);
+        valid = valid && are_cached_segments_valid(words);
+    }
+    valid = valid && read_debug_info(file, debug_info);
+    uint8_t is_relocatable;
+    valid = valid && read_u8(file, is_relocatable);
+    if (valid && is_relocatable) {
+        link_info.is_relocatable = true;
+        valid = read_link_info(file, link_info);
+    }
+    fclose(file);
+
+    if (!valid) {
+        // Corrupt or truncated entry: remove it and assemble as normal
+        words.clear();
+        debug_info = DebugInfo();
+        link_info = LinkInfo();
+        unlink(path);
+        ++cache.stats.misses;
+        return false;
+    }
+
+    // Mark as recently used, for eviction
+    utime(path, nullptr);
+    ++cache.stats.hits;
+    return true;
+}
+
+// Segments (origin and size, then words) must fit in memory, and end exactly
+//     at the last word, as they are walked without bounds checks later
+bool are_cached_segments_valid(const vector<Word> &words) {
+    if (words.empty())
+        return false;
+    size_t i = 0;
+    while (i < words.size()) {
+        if (i + 1 >= words.size())
+            return false;
+        const Word origin = words[i];
+        const Word size = words[i + 1];
+        if (origin + size > MEMORY_SIZE)
+            return false;
+        i += 2 + size;
+    }
+    return i == words.size();
+}
+
+// Failing to write to the cache is never an error: the entry is just skipped
+void cache_store(
+    AssemblyCache &cache,
+    const uint64_t key,
+    const size_t source_size,
+    const vector<Word> &words,
+    const DebugInfo &debug_info,
+    const LinkInfo &link_info
+) {
+    if (mkdir(cache.directory, 0755) != 0 && errno != EEXIST)
+        return;
+
+    char path[MAX_CACHE_PATH];
+    cache_entry_path(path, cache, key);
+    char temp_path[MAX_CACHE_PATH + sizeof(".XXXXXX")];
+    snprintf(temp_path, sizeof(temp_path), "%s.XXXXXX", path);
+
+    const int fd = mkstemp(temp_path);
+    if (fd < 0)
+        return;
+    FILE *const file = fdopen(fd, "wb");
+    if (file == nullptr) {
+        close(fd);
+        unlink(temp_path);
+        return;
+    }
+
+    bool ok = write_u32(file, CACHE_MAGIC) && write_u32(file, source_size) &&
+              write_u32(file, words.size());
+    for (size_t i = 0; ok && i < words.size(); ++i) {
+        const Word word = swap_endian(words[i]);
+        ok = fwrite(&word, WORD_SIZE, 1, file) == 1;
+    }
+    ok = ok && write_debug_info(file, debug_info);
+    ok = ok && write_u8(file, link_info.is_relocatable);
+    if (link_info.is_relocatable)
+        ok = ok && write_link_info(file, link_info);
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(temp_path, path) != 0) {
+        unlink(temp_path);
+        return;
+    }
+    ++cache.stats.stores;
+}
+
+typedef struct CacheEntry {
+    char name[CACHE_KEY_DIGITS + sizeof(CACHE_EXTENSION)];
+    size_t size;
+    time_t last_used;
+} CacheEntry;
+
+int compare_cache_entries_by_age(const void *const a, const void *const b) {
+    const time_t a_time = static_cast<const CacheEntry *>(a)->last_used;
+    const time_t b_time = static_cast<const CacheEntry *>(b)->last_used;
+    return (a_time > b_time) - (a_time < b_time);
+}
+
+// Remove least-recently-used entries until cache fits in `max_bytes`
+// Should only be called once no more jobs are using the cache
+void evict_cache(AssemblyCache &cache) {
+    DIR *const dir = opendir(cache.directory);
+    if (dir == nullptr)
+        return;
+
+    vector<CacheEntry> entries;
+    size_t total_bytes = 0;
+    const size_t name_length = CACHE_KEY_DIGITS + strlen(CACHE_EXTENSION);
+
+    char path[MAX_CACHE_PATH];
+    for (dirent *item; (item = readdir(dir)) != nullptr;) {
+        // Ignore anything that is not an entry (including temporary files)
+        if (strlen(item->d_name) != name_length ||
+            strcmp(item->d_name + CACHE_KEY_DIGITS, CACHE_EXTENSION))
+            continue;
+        snprintf(path, MAX_CACHE_PATH, "%s/%s", cache.directory, item->d_name);
+        struct stat info;
+        if (stat(path, &info) != 0)
+            continue;
+
+        entries.push_back({});
+        CacheEntry &entry = entries.back();
+        strcpy(entry.name, item->d_name);
+        entry.size = info.st_size;
+        entry.last_used = info.st_mtime;
+        total_bytes += entry.size;
+    }
+    closedir(dir);
+
+    qsort(
+        entries.data(),
+        entries.size(),
+        sizeof(CacheEntry),
+        compare_cache_entries_by_age
+    );
+
+    size_t remaining = entries.size();
+    for (size_t i = 0; i < entries.size() && total_bytes > cache.max_bytes;
+         ++i) {
+        snprintf(
+            path, MAX_CACHE_PATH, "%s/%s", cache.directory, entries[i].name
+        );
+        if (unlink(path) != 0)
+            continue;
+        total_bytes -= entries[i].size;
+        --remaining;
+        ++cache.stats.evictions;
+    }
+
+    cache.stats.entries = remaining;
+    cache.stats.total_bytes = total_bytes;
+}
+
+void add_cache_stats(CacheStats &total, const CacheStats &stats) {
+    total.hits += stats.hits;
+    total.misses += stats.misses;
+    total.stores += stats.stores;
+    total.evictions += stats.evictions;
+}
+
+void print_cache_stats(const AssemblyCache &cache) {
+    const CacheStats &stats = cache.stats;
+    fprintf(
+        stderr,
+        "Cache: %zu hit%s, %zu miss%s, %zu stored, %zu evicted\n",
+        stats.hits,
+        stats.hits == 1 ? "" : "s",
+        stats.misses,
+        stats.misses == 1 ? "" : "es",
+        stats.stores,
+        stats.evictions
+    );
+    fprintf(
+        stderr,
+        "Cache: %zu entries, %zu/%zu KiB in %s\n",
+        stats.entries,
+        (stats.total_bytes + 1023) / 1024,
+        cache.max_bytes / 1024,
+        cache.directory
+    );
+}
+
+void cache_entry_path(
+    char *const path, const AssemblyCache &cache, const uint64_t key
+) {
+    snprintf(
+        path,
+        MAX_CACHE_PATH,
+        "%s/%016llx" CACHE_EXTENSION,
+        cache.directory,
+        static_cast<unsigned long long>(key)
+    );
+}
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef CACHEMODEL_CPP
+#define CACHEMODEL_CPP
+
+#include <cstdint>  // uint64_t
+#include <cstdio>   // FILE, fprintf
+#include <cstdlib>  // strtoul
+#include <cstring>  // strcasecmp
+#include <vector>   // std::vector
+
+#include "debugger.cpp"
+#include "debuginfo.cpp"
+#include "globals.hpp"
+#include "profile.cpp"
+#include "types.hpp"
+
+using std::vector;
+
+// Simulated memory cache, fed by instruction fetches and by the loads and
+//     stores of `LD`/`LDR`/`LDI`/`ST`/`STR`/`STI` (not traps)
+// Only hit or miss is modelled. Stores allocate a line, like loads
+// `simulate_cache_access` expands to nothing unless built with
+//     `LASIM_CACHE_MODEL` (`make CACHE_MODEL=1`)
+
+#ifdef LASIM_CACHE_MODEL
+#define simulate_cache_access(_address, _kind) \
+    (access_cache_model((_address), (_kind)))
+#else
+#define simulate_cache_access(_address, _kind)
+#endif
+
+#define CACHE_RANGE_SIZE 0x100  // Words in each address range of report
+#define CACHE_RANGE_COUNT (MEMORY_SIZE / CACHE_RANGE_SIZE)
+
+enum class CacheAccess {
+    FETCH,
+    LOAD,
+    STORE,
+};
+
+enum class CacheReplacement {
+    LRU,
+    FIFO,
+    RANDOM,
+};
+
+typedef struct CacheLine {
+    bool is_valid;
+    Word tag;        // Address divided by line size
+    uint64_t stamp;  // Last use (LRU), or fill (FIFO)
+} CacheLine;
+
+typedef struct CacheCounts {
+    uint64_t hits;
+    uint64_t misses;
+} CacheCounts;
+
+typedef struct CacheModel {
+    bool is_enabled = false;
+    // All powers of 2, in words
+    size_t size = 0;
+    size_t line_size = 0;
+    size_t ways = 0;
+    size_t sets = 0;
+    CacheReplacement replacement = CacheReplacement::LRU;
+    vector<CacheLine> lines;  // `ways` lines of each set, in order
+    uint64_t clock = 0;       // Accesses so far
+    uint64_t random = 0;      // State of xorshift, for random replacement
+    CacheCounts kinds[3];     // Indexed by `CacheAccess`
+    CacheCounts ranges[CACHE_RANGE_COUNT];
+    CacheCounts subroutines[MEMORY_SIZE];
+} CacheModel;
+
+static CacheModel cache_model;
+
+bool configure_cache_model(const char *const spec);
+inline void access_cache_model(const Word address, const CacheAccess kind);
+void print_cache_model(FILE *const file);
+// Used by `configure_cache_model`
+bool parse_cache_size(const char *&spec, size_t &size, const bool is_last);
+// Used by `print_cache_model`
+void print_cache_counts(FILE *const file, const CacheCounts &counts);
+
+// `spec` is `SIZE,LINE,WAYS[,POLICY]`, with sizes in words, and a policy of
+//     `lru` (default), `fifo` or `random`
+bool configure_cache_model(const char *const spec) {
+    const char *rest = spec;
+    CacheModel &cache = cache_model;
+    if (!parse_cache_size(rest, cache.size, false) ||
+        !parse_cache_size(rest, cache.line_size, false) ||
+        !parse_cache_size(rest, cache.ways, true)) {
+        fprintf(
+            stderr,
+            "Expected powers of 2 for cache model as `SIZE,LINE,WAYS`: %s\n",
+            spec
+        );
+        return false;
+    }
+    if (cache.line_size * cache.ways > cache.size ||
+        cache.size > MEMORY_SIZE) {
+        fprintf(
+            stderr,
+            "Cache model must have at least one set, and be no larger than "
+            "memory: %s\n",
+            spec
+        );
+        return false;
+    }
+
+    if (rest[0] == ',') {
+        ++rest;
+        if (!strcasecmp(rest, "lru")) {
+            cache.replacement = CacheReplacement::LRU;
+        } else if (!strcasecmp(rest, "fifo")) {
+            cache.replacement = CacheReplacement::FIFO;
+        } else if (!strcasecmp(rest, "random")) {
+            cache.replacement = CacheReplacement::RANDOM;
+        } else {
+            fprintf(
+                stderr,
+                "Expected `lru`, `fifo` or `random` for cache replacement: "
+                "%s\n",
+                rest
+            );
+            return false;
+        }
+    }
+
+    cache.sets = cache.size / (cache.line_size * cache.ways);
+    cache.lines.assign(cache.sets * cache.ways, {false, 0, 0});
+    cache.random = 0x2545'f491'4f6c'dd1d;
+    cache.is_enabled = true;
+    return true;
+}
+
+// Advances `spec` past the number, and following comma if not `is_last`
+bool parse_cache_size(const char *&spec, size_t &size, const bool is_last) {
+    char *end;
+    const unsigned long value = strtoul(spec, &end, 10);
+    if (end == spec || spec[0] == '-' || value == 0 ||
+        (value & (value - 1)) != 0)
+        return false;
+    if (is_last ? (end[0] != '\0' && end[0] != ',') : end[0] != ',')
+        return false;
+    size = value;
+    spec = is_last ? end : end + 1;
+    return true;
+}
+
+// Call stack must be enabled, to know current subroutine
+inline void access_cache_model(const Word address, const CacheAccess kind) {
+    CacheModel &cache = cache_model;
+    if (!cache.is_enabled)
+        return;
+    ++cache.clock;
+
+    const Word tag = static_cast<Word>(address / cache.line_size);
+    CacheLine *const set = &cache.lines[(tag & (cache.sets - 1)) * cache.ways];
+    CacheLine *line = nullptr;
+    for (size_t i = 0; i < cache.ways; ++i) {
+        if (set[i].is_valid && set[i].tag == tag) {
+            line = &set[i];
+            break;
+        }
+    }
+
+    const bool is_hit = line != nullptr;
+    if (is_hit) {
+        if (cache.replacement == CacheReplacement::LRU)
+            line->stamp = cache.clock;
+    } else {
+        // Empty line first, otherwise oldest, or random
+        line = &set[0];
+        for (size_t i = 0; i < cache.ways; ++i) {
+            if (!set[i].is_valid) {
+                line = &set[i];
+                break;
+            }
+            if (set[i].stamp < line->stamp)
+                line = &set[i];
+        }
+        if (line->is_valid && cache.replacement == CacheReplacement::RANDOM) {
+            cache.random ^= cache.random << 13;
+            cache.random ^= cache.random >> 7;
+            cache.random ^= cache.random << 17;
+            line = &set[cache.random & (cache.ways - 1)];
+        }
+        *line = {true, tag, cache.clock};
+    }
+
+    CacheCounts *const counts[] = {
+        &cache.kinds[static_cast<size_t>(kind)],
+        &cache.ranges[address / CACHE_RANGE_SIZE],
+        &cache.subroutines[current_subroutine()],
+    };
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i) {
+        if (is_hit)
+            ++counts[i]->hits;
+        else
+            ++counts[i]->misses;
+    }
+}
+
+void print_cache_model(FILE *const file) {
+    const CacheModel &cache = cache_model;
+    const char *const replacements[] = {"LRU", "FIFO", "random"};
+    fprintf(
+        file,
+        "\nCache model: %zu words, %zu-word lines, %zu-way, %s\n",
+        cache.size,
+        cache.line_size,
+        cache.ways,
+        replacements[static_cast<size_t>(cache.replacement)]
+    );
+    fprintf(
+        file,
+        "    %10s  %10s  %10s  %9s\n",
+        "ACCESSES",
+        "HITS",
+        "MISSES",
+        "MISS RATE"
+    );
+
+    const char *const kinds[] = {"Fetches", "Loads", "Stores"};
+    CacheCounts total = {0, 0};
+    for (size_t i = 0; i < 3; ++i) {
+        print_cache_counts(file, cache.kinds[i]);
+        fprintf(file, "%s\n", kinds[i]);
+        total.hits += cache.kinds[i].hits;
+        total.misses += cache.kinds[i].misses;
+    }
+    print_cache_counts(file, total);
+    fprintf(file, "Total\n");
+
+    fprintf(file, "Address ranges:\n");
+    for (size_t i = 0; i < CACHE_RANGE_COUNT; ++i) {
+        const CacheCounts &counts = cache.ranges[i];
+        if (counts.hits + counts.misses == 0)
+            continue;
+        print_cache_counts(file, counts);
+        fprintf(
+            file,
+            "0x%04zx-0x%04zx\n",
+            i * CACHE_RANGE_SIZE,
+            (i + 1) * CACHE_RANGE_SIZE - 1
+        );
+    }
+
+    // Most misses first. Subroutines with only hits are still listed
+    vector<uint64_t> misses(MEMORY_SIZE);
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        const CacheCounts &counts = cache.subroutines[i];
+        if (counts.hits + counts.misses != 0)
+            misses[i] = counts.misses + 1;
+    }
+    const vector<Word> subroutines = sorted_profile_addresses(misses.data());
+    fprintf(file, "Subroutines:\n");
+    for (size_t i = 0; i < subroutines.size(); ++i) {
+        print_cache_counts(file, cache.subroutines[subroutines[i]]);
+        print_symbolized_address(file, debug_info, subroutines[i]);
+        fprintf(file, "\n");
+    }
+}
+
+// Followed by name of row
+void print_cache_counts(FILE *const file, const CacheCounts &counts) {
+    const uint64_t accesses = counts.hits + counts.misses;
+    fprintf(
+        file,
+        "    %10llu  %10llu  %10llu  %8.2f%%  ",
+        static_cast<unsigned long long>(accesses),
+        static_cast<unsigned long long>(counts.hits),
+        static_cast<unsigned long long>(counts.misses),
+        accesses == 0 ? 0.0 : 100.0 * counts.misses / accesses
+    );
+}
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef CALLPROFILE_CPP
+#define CALLPROFILE_CPP
+
+#include <cstdint>  // uint32_t, uint64_t
+#include <cstdio>   // FILE, fopen, etc
+#include <cstdlib>  // qsort
+#include <vector>   // std::vector
+
+#include "debuginfo.cpp"
+#include "error.hpp"
+#include "globals.hpp"
+#include "types.hpp"
+
+using std::vector;
+
+// Instructions executed in each distinct stack of subroutine calls
+// Each stack is interned as a node of a tree, so recording an instruction is
+//     one increment, and a call only searches the children of the caller.
+//     Direct recursion stays in the same node, and is counted as a repeat of
+//     the last call, so neither the tree nor the stack grows with its depth
+// Written as folded stacks (`main;foo;bar 123`), as read by flame graph tools
+
+#define NO_CALL_NODE UINT32_MAX
+
+typedef struct CallNode {
+    Word subroutine;  // Program entry, for root node
+    uint32_t parent;
+    uint32_t first_child;
+    uint32_t next_sibling;
+    uint64_t instructions;  // Exclusive of called subroutines
+} CallNode;
+
+// Active call, and its direct recursive calls
+typedef struct CallStackEntry {
+    uint32_t node;
+    uint64_t repeats;  // Calls within the first, which have not returned
+} CallStackEntry;
+
+typedef struct CallProfile {
+    bool is_enabled = false;
+    const char *filename = nullptr;  // Of folded stacks
+    vector<CallNode> nodes;          // First is root. Parents come first
+    vector<CallStackEntry> stack;
+    uint32_t current = 0;  // Node of last entry of `stack`
+    // Program start counts as a call of its entry
+    uint64_t calls[MEMORY_SIZE];
+} CallProfile;
+
+static CallProfile call_profile;
+
+void start_call_profile(const Word entry);
+inline void record_call_profile_instruction(void);
+void enter_call_profile(const Word subroutine);
+void exit_call_profile(void);
+void finish_call_profile(Error &error);
+// Used by `finish_call_profile`
+bool write_folded_stacks(FILE *const file);
+void print_call_summary(FILE *const file);
+void print_call_name(FILE *const file, const Word subroutine);
+int compare_call_subroutines(const void *const a, const void *const b);
+
+// Inclusive counts being sorted, as `qsort` takes no context
+static const uint64_t *call_sort_inclusive = nullptr;
+
+void start_call_profile(const Word entry) {
+    call_profile.nodes.clear();
+    call_profile.nodes.push_back(
+        {entry, NO_CALL_NODE, NO_CALL_NODE, NO_CALL_NODE, 0}
+    );
+    call_profile.stack.clear();
+    call_profile.stack.push_back({0, 0});
+    call_profile.current = 0;
+    ++call_profile.calls[entry];
+}
+
+// Called before each instruction, which is counted in the caller for a call,
+//     and in the subroutine for a return
+inline void record_call_profile_instruction() {
+    ++call_profile.nodes[call_profile.current].instructions;
+}
+
+void enter_call_profile(const Word subroutine) {
+    ++call_profile.calls[subroutine];
+    vector<CallNode> &nodes = call_profile.nodes;
+    const uint32_t parent = call_profile.current;
+
+    if (nodes[parent].subroutine == subroutine) {
+        ++call_profile.stack.back().repeats;
+        return;
+    }
+    uint32_t node = nodes[parent].first_child;
+    while (node != NO_CALL_NODE && nodes[node].subroutine != subroutine)
+        node = nodes[node].next_sibling;
+    if (node == NO_CALL_NODE) {
+        node = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(
+            {subroutine, parent, NO_CALL_NODE, nodes[parent].first_child, 0}
+        );
+        nodes[parent].first_child = node;
+    }
+    call_profile.stack.push_back({node, 0});
+    call_profile.current = node;
+}
+
+// `RET` with no call (such as from a program's entry) is ignored
+void exit_call_profile() {
+    CallStackEntry &entry = call_profile.stack.back();
+    if (entry.repeats > 0) {
+        --entry.repeats;
+        return;
+    }
+    if (call_profile.stack.size() <= 1)
+        return;
+    call_profile.stack.pop_back();
+    call_profile.current = call_profile.stack.back().node;
+}
+
+void finish_call_profile(Error &error) {
+    if (call_profile.filename != nullptr) {
+        FILE *const file = fopen(call_profile.filename, "w");
+        if (file == nullptr) {
+            fprintf(
+                stderr,
+                "Failed to open call profile for writing: %s\n",
+                call_profile.filename
+            );
+            SET_ERROR(error, FILE);
+        } else {
+            const bool ok = write_folded_stacks(file);
+            if (fclose(file) != 0 || !ok) {
+                fprintf(
+                    stderr,
+                    "Failed to write call profile: %s\n",
+                    call_profile.filename
+                );
+                SET_ERROR(error, FILE);
+            }
+        }
+    }
+    print_call_summary(stderr);
+}
+
+// One line for each stack which executed any instructions itself
+bool write_folded_stacks(FILE *const file) {
+    const vector<CallNode> &nodes = call_profile.nodes;
+    vector<uint32_t> path;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].instructions == 0)
+            continue;
+        path.clear();
+        for (uint32_t node = static_cast<uint32_t>(i); node != NO_CALL_NODE;
+             node = nodes[node].parent)
+            path.push_back(node);
+        for (size_t j = path.size(); j > 0; --j) {
+            print_call_name(file, nodes[path[j - 1]].subroutine);
+            if (j > 1)
+                fputc(';', file);
+        }
+        fprintf(
+            file,
+            " %llu\n",
+            static_cast<unsigned long long>(nodes[i].instructions)
+        );
+    }
+    return !ferror(file);
+}
+
+// Inclusive count of a recursive subroutine only includes its outermost call
+void print_call_summary(FILE *const file) {
+    const vector<CallNode> &nodes = call_profile.nodes;
+    vector<uint64_t> node_inclusive(nodes.size());
+    for (size_t i = nodes.size(); i > 0; --i) {
+        const CallNode &node = nodes[i - 1];
+        node_inclusive[i - 1] += node.instructions;
+        if (node.parent != NO_CALL_NODE)
+            node_inclusive[node.parent] += node_inclusive[i - 1];
+    }
+
+    vector<uint64_t> inclusive(MEMORY_SIZE);
+    vector<uint64_t> exclusive(MEMORY_SIZE);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const Word subroutine = nodes[i].subroutine;
+        exclusive[subroutine] += nodes[i].instructions;
+        bool is_recursive = false;
+        for (uint32_t node = nodes[i].parent; node != NO_CALL_NODE;
+             node = nodes[node].parent) {
+            if (nodes[node].subroutine == subroutine) {
+                is_recursive = true;
+                break;
+            }
+        }
+        if (!is_recursive)
+            inclusive[subroutine] += node_inclusive[i];
+    }
+
+    vector<Word> subroutines;
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        if (call_profile.calls[i] != 0)
+            subroutines.push_back(static_cast<Word>(i));
+    }
+    call_sort_inclusive = inclusive.data();
+    qsort(
+        subroutines.data(),
+        subroutines.size(),
+        sizeof(Word),
+        compare_call_subroutines
+    );
+
+    fprintf(file, "\nCalls:\n");
+    fprintf(
+        file,
+        "    %10s  %10s  %10s  %s\n",
+        "CALLS",
+        "INCLUSIVE",
+        "EXCLUSIVE",
+        "SUBROUTINE"
+    );
+    for (size_t i = 0; i < subroutines.size(); ++i) {
+        const Word subroutine = subroutines[i];
+        fprintf(
+            file,
+            "    %10llu  %10llu  %10llu  ",
+            static_cast<unsigned long long>(call_profile.calls[subroutine]),
+            static_cast<unsigned long long>(inclusive[subroutine]),
+            static_cast<unsigned long long>(exclusive[subroutine])
+        );
+        print_call_name(file, subroutine);
+        fprintf(file, "\n");
+    }
+}
+
+// Label at address, if there is one
+void print_call_name(FILE *const file, const Word subroutine) {
+    const Symbol *const symbol = find_symbol_before(debug_info, subroutine);
+    if (symbol != nullptr && symbol->address == subroutine)
+        fprintf(file, "%s", symbol->name);
+    else
+        fprintf(file, "0x%04hx", subroutine);
+}
+
+// Highest inclusive count first
+int compare_call_subroutines(const void *const a, const void *const b) {
+    const Word a_address = *static_cast<const Word *>(a);
+    const Word b_address = *static_cast<const Word *>(b);
+    const uint64_t a_count = call_sort_inclusive[a_address];
+    const uint64_t b_count = call_sort_inclusive[b_address];
+    if (a_count != b_count)
+        return a_count < b_count ? 1 : -1;
+    return (a_address > b_address) - (a_address < b_address);
+}
+
+#endif
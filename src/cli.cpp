@@ -1,9 +1,11 @@
 #ifndef CLI_CPP
 #define CLI_CPP
 
+#include <cstdint>  // uint64_t
 #include <cstdio>   // fprintf, stderr
-#include <cstdlib>  // exit
+#include <cstdlib>  // exit, strtol
 #include <cstring>  // strcpy
+#include <vector>   // std::vector
 
 #include "error.hpp"
 
@@ -17,10 +19,17 @@
 #define DEFAULT_OUT_EXTENSION "obj"
 #define DEFAULT_OUT_EXTENSION_SIZE (sizeof(DEFAULT_OUT_EXTENSION))
 
+// Upper limit for `-j`
+#define MAX_ASSEMBLE_JOBS 64
+
+using std::vector;
+
 enum class Mode {
     ASSEMBLE_EXECUTE,  // (default)
     ASSEMBLE_ONLY,     // -a
     EXECUTE_ONLY,      // -x
+    LINK_ONLY,         // -l
+    DISASSEMBLE_ONLY,  // --disassemble
 };
 
 // TODO(feat): Verbose mode
@@ -30,13 +39,71 @@ struct Options {
     // Empty string (file[0]=='\0') refers to stdin/stdout respectively
     char in_filename[FILENAME_MAX];
     char out_filename[FILENAME_MAX];
+    // Every input filename, in order given (only `-a`, `-x`, and `-l` accept
+    //     more than one)
+    // Points into `argv`
+    vector<const char *> in_filenames;
+    int jobs = 0;  // Threads to assemble with. 0 means one per CPU
+    // `nullptr` if assembly cache is disabled
+    const char *cache_directory = nullptr;
+    size_t cache_max_kib = 0;  // 0 means default size
+    bool cache_stats = false;
     bool debugger = false;
     bool debugger_quiet = false;
+    // `nullptr` if debugger is interactive. Both imply `-d`
+    const char *debug_script_filename = nullptr;
+    const char *debug_commands = nullptr;
+    // TCP port or Unix socket path. Implies `-d`
+    const char *debug_server = nullptr;
+    // Undo is recorded from start, instead of from `record` command
+    bool record_undo = false;
+    // `nullptr` if not recording or replaying
+    const char *record_filename = nullptr;
+    const char *replay_filename = nullptr;
+    uint64_t max_instructions = 0;  // 0 means no limit
+    bool profile = false;
+    const char *call_profile_filename = nullptr;  // Of folded stacks
+    // 0 means not sampling. Only one can be set
+    uint64_t sample_instructions = 0;
+    uint64_t sample_microseconds = 0;
+    bool stats = false;
+    const char *stats_json_filename = nullptr;
+    // Only if built with timing model
+    bool cycles = false;
+    const char *cycle_costs_filename = nullptr;
+    // Only if built with cache model. As `SIZE,LINE,WAYS[,POLICY]`
+    const char *cache_model = nullptr;
+    const char *heatmap_filename = nullptr;  // CSV if `.csv`, else binary
+    const char *coverage_filename = nullptr;       // As `lcov` tracefile
+    const char *coverage_data_filename = nullptr;  // Bitmap, to merge runs
+    bool check_uninitialized = false;
+    bool check_self_modify = false;
+    bool strict_self_modify = false;  // Implies `check_self_modify`
 };
 
 void parse_options(
     Options &options, const int argc, const char *const *const argv
 );
+void parse_long_option(
+    Options &options,
+    const char *const name,
+    int &i,
+    const int argc,
+    const char *const *const argv
+);
+const char *expect_long_option_argument(
+    const char *const name,
+    int &i,
+    const int argc,
+    const char *const *const argv
+);
+uint64_t expect_long_option_count(
+    const char *const name,
+    const char *const description,
+    int &i,
+    const int argc,
+    const char *const *const argv
+);
 void print_usage_hint(void);
 void print_usage(void);
 void strcpy_max_size(
@@ -65,6 +132,8 @@ void parse_options(
 
         // `-` as input file for stdin
         if (arg[0] != '-' || arg[1] == '\0') {
+            // Extra input files are checked after all options are parsed
+            options.in_filenames.push_back(arg);
             if (!in_file_set) {
                 in_file_set = true;
                 if (arg[0] == '-') {
@@ -72,10 +141,6 @@ void parse_options(
                 } else {
                     strcpy_max_size(options.in_filename, arg, FILENAME_MAX - 1);
                 }
-            } else {
-                fprintf(stderr, "Unexpected argument: `%s`\n", arg);
-                print_usage_hint();
-                exit(static_cast<int>(Error::CLI));
             }
             continue;
         }
@@ -87,6 +152,11 @@ void parse_options(
             exit(static_cast<int>(Error::CLI));
         }
 
+        if (arg[0] == '-') {
+            parse_long_option(options, arg + 1, i, argc, argv);
+            continue;
+        }
+
         for (char option; (option = arg[0]) != '\0'; ++arg) {
             switch (option) {
                 // Help
@@ -124,6 +194,34 @@ void parse_options(
                     }
                 }; break;
 
+                // Jobs
+                case 'j': {
+                    if (options.jobs != 0) {
+                        fprintf(stderr, "Cannot specify `-j` more than once\n");
+                        print_usage_hint();
+                        exit(static_cast<int>(Error::CLI));
+                    }
+                    if (i + 1 >= argc) {
+                        fprintf(stderr, "Expected argument for `-j`\n");
+                        print_usage_hint();
+                        exit(static_cast<int>(Error::CLI));
+                    }
+                    const char *next_arg = argv[++i];
+                    char *end;
+                    const long jobs = strtol(next_arg, &end, 10);
+                    if (end == next_arg || end[0] != '\0' || jobs < 1 ||
+                        jobs > MAX_ASSEMBLE_JOBS) {
+                        fprintf(
+                            stderr,
+                            "Expected amount of jobs from 1 to %d for `-j`\n",
+                            MAX_ASSEMBLE_JOBS
+                        );
+                        print_usage_hint();
+                        exit(static_cast<int>(Error::CLI));
+                    }
+                    options.jobs = static_cast<int>(jobs);
+                }; break;
+
                 // Assemble
                 case 'a':
                     switch (options.mode) {
@@ -136,6 +234,17 @@ void parse_options(
                             );
                             print_usage_hint();
                             exit(static_cast<int>(Error::CLI));
+                        case Mode::DISASSEMBLE_ONLY:
+                            fprintf(
+                                stderr,
+                                "Cannot specify `-a` with `--disassemble`\n"
+                            );
+                            print_usage_hint();
+                            exit(static_cast<int>(Error::CLI));
+                        case Mode::LINK_ONLY:
+                            fprintf(stderr, "Cannot specify `-a` with `-l`\n");
+                            print_usage_hint();
+                            exit(static_cast<int>(Error::CLI));
                         default:
                             fprintf(
                                 stderr,
@@ -160,6 +269,17 @@ void parse_options(
                             );
                             print_usage_hint();
                             exit(static_cast<int>(Error::CLI));
+                        case Mode::DISASSEMBLE_ONLY:
+                            fprintf(
+                                stderr,
+                                "Cannot specify `-x` with `--disassemble`\n"
+                            );
+                            print_usage_hint();
+                            exit(static_cast<int>(Error::CLI));
+                        case Mode::LINK_ONLY:
+                            fprintf(stderr, "Cannot specify `-x` with `-l`\n");
+                            print_usage_hint();
+                            exit(static_cast<int>(Error::CLI));
                         default:
                             fprintf(
                                 stderr,
@@ -172,6 +292,35 @@ void parse_options(
                     };
                 }; break;
 
+                // Link
+                case 'l': {
+                    switch (options.mode) {
+                        case Mode::ASSEMBLE_EXECUTE:
+                            options.mode = Mode::LINK_ONLY;
+                            break;
+                        case Mode::LINK_ONLY:
+                            fprintf(
+                                stderr, "Cannot specify `-l` more than once\n"
+                            );
+                            print_usage_hint();
+                            exit(static_cast<int>(Error::CLI));
+                        case Mode::DISASSEMBLE_ONLY:
+                            fprintf(
+                                stderr,
+                                "Cannot specify `-l` with `--disassemble`\n"
+                            );
+                            print_usage_hint();
+                            exit(static_cast<int>(Error::CLI));
+                        default:
+                            fprintf(
+                                stderr,
+                                "Cannot specify `-l` with `-a` or `-x`\n"
+                            );
+                            print_usage_hint();
+                            exit(static_cast<int>(Error::CLI));
+                    };
+                }; break;
+
                 // Debugger
                 case 'd': {
                     if (options.debugger) {
@@ -206,18 +355,190 @@ void parse_options(
         exit(static_cast<int>(Error::CLI));
     }
 
+    // Nothing is assembled or executed, so no other option applies
+    if (options.mode == Mode::DISASSEMBLE_ONLY) {
+        if (options.in_filenames.size() > 1 ||
+            options.in_filename[0] == '\0') {
+            fprintf(stderr, "Expected one object file for `--disassemble`\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        if (options.jobs != 0 || options.cache_directory != nullptr ||
+            options.cache_max_kib != 0 || options.cache_stats ||
+            options.debugger || options.debugger_quiet ||
+            options.debug_script_filename != nullptr ||
+            options.debug_commands != nullptr ||
+            options.debug_server != nullptr || options.record_undo ||
+            options.record_filename != nullptr ||
+            options.replay_filename != nullptr ||
+            options.max_instructions != 0 || options.profile ||
+            options.call_profile_filename != nullptr ||
+            options.sample_instructions != 0 ||
+            options.sample_microseconds != 0 || options.stats ||
+            options.stats_json_filename != nullptr || options.cycles ||
+            options.cycle_costs_filename != nullptr ||
+            options.cache_model != nullptr ||
+            options.heatmap_filename != nullptr ||
+            options.coverage_filename != nullptr ||
+            options.coverage_data_filename != nullptr ||
+            options.check_uninitialized || options.check_self_modify ||
+            options.strict_self_modify) {
+            fprintf(
+                stderr,
+                "Cannot specify assembly or execution options with "
+                "`--disassemble`\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        // Source is written to stdout by default
+        if (!out_file_set)
+            options.out_filename[0] = '\0';
+        return;
+    }
+
+    if (options.in_filenames.size() > 1) {
+        if (options.mode == Mode::ASSEMBLE_EXECUTE) {
+            fprintf(
+                stderr,
+                "Multiple input files are only allowed with `-a`, `-x`, or "
+                "`-l`\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        if (options.mode != Mode::ASSEMBLE_ONLY && options.jobs != 0) {
+            fprintf(stderr, "Cannot specify `-j` without `-a`\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        if (options.mode == Mode::ASSEMBLE_ONLY && out_file_set) {
+            fprintf(
+                stderr, "Cannot specify output file with multiple input files\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        for (size_t i = 0; i < options.in_filenames.size(); ++i) {
+            if (!strcmp(options.in_filenames[i], "-")) {
+                fprintf(
+                    stderr, "Cannot read stdin with multiple input files\n"
+                );
+                print_usage_hint();
+                exit(static_cast<int>(Error::CLI));
+            }
+        }
+    } else if (options.jobs != 0) {
+        fprintf(stderr, "Cannot specify `-j` without multiple input files\n");
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+
+    if (options.cache_directory == nullptr) {
+        if (options.cache_max_kib != 0 || options.cache_stats) {
+            fprintf(
+                stderr,
+                "Cannot specify `--cache-size` or `--cache-stats` without "
+                "`--cache`\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+    } else if (options.mode == Mode::EXECUTE_ONLY ||
+               options.mode == Mode::LINK_ONLY) {
+        fprintf(stderr, "Cannot use assembly cache with `-x` or `-l`\n");
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+
+    if (options.record_filename != nullptr ||
+        options.replay_filename != nullptr) {
+        if (options.record_filename != nullptr &&
+            options.replay_filename != nullptr) {
+            fprintf(stderr, "Cannot specify `--record` with `--replay`\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        if (options.mode == Mode::ASSEMBLE_ONLY ||
+            options.mode == Mode::LINK_ONLY) {
+            fprintf(
+                stderr,
+                "Cannot record or replay without executing program\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+    }
+
+    if (options.max_instructions != 0 &&
+        (options.mode == Mode::ASSEMBLE_ONLY ||
+         options.mode == Mode::LINK_ONLY)) {
+        fprintf(
+            stderr, "Cannot specify `--max-instructions` without executing\n"
+        );
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+
+    if ((options.profile || options.call_profile_filename != nullptr ||
+         options.sample_instructions != 0 ||
+         options.sample_microseconds != 0 || options.stats ||
+         options.stats_json_filename != nullptr || options.cycles ||
+         options.cycle_costs_filename != nullptr ||
+         options.cache_model != nullptr ||
+         options.heatmap_filename != nullptr ||
+         options.coverage_filename != nullptr ||
+         options.coverage_data_filename != nullptr ||
+         options.check_uninitialized || options.check_self_modify ||
+         options.strict_self_modify) &&
+        (options.mode == Mode::ASSEMBLE_ONLY ||
+         options.mode == Mode::LINK_ONLY)) {
+        fprintf(stderr, "Cannot specify profiling options without executing\n");
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+
+    if (options.debug_server != nullptr &&
+        (options.debug_script_filename != nullptr ||
+         options.debug_commands != nullptr)) {
+        fprintf(
+            stderr,
+            "Cannot specify `--debug-server` with a debugger script\n"
+        );
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+
+    if (options.debug_script_filename != nullptr ||
+        options.debug_commands != nullptr || options.debug_server != nullptr)
+        options.debugger = true;
+    if (options.cycle_costs_filename != nullptr)
+        options.cycles = true;
+    if (options.strict_self_modify)
+        options.check_self_modify = true;
+
     if (options.debugger) {
         if (options.mode == Mode::ASSEMBLE_ONLY) {
             fprintf(stderr, "Cannot use debugger in assemble-only mode\n");
             print_usage_hint();
             exit(static_cast<int>(Error::CLI));
         }
+        if (options.mode == Mode::LINK_ONLY) {
+            fprintf(stderr, "Cannot use debugger in link-only mode\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
     } else {
         if (options.debugger_quiet) {
             fprintf(stderr, "Cannot specify `-q` without `-d`.\n");
             print_usage_hint();
             exit(static_cast<int>(Error::CLI));
         }
+        if (options.record_undo) {
+            fprintf(stderr, "Cannot specify `--record-undo` without `-d`\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
     }
 
     if (options.mode == Mode::EXECUTE_ONLY) {
@@ -226,6 +547,13 @@ void parse_options(
             print_usage_hint();
             exit(static_cast<int>(Error::CLI));
         }
+    } else if (options.mode == Mode::LINK_ONLY) {
+        // Default name would overwrite first input
+        if (!out_file_set) {
+            fprintf(stderr, "Expected output file for `-l`\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
     } else if (!out_file_set) {
         // Mode is a|ax, but no output file was specified
         // Default output filename based on input filename
@@ -245,6 +573,381 @@ void parse_options(
     }
 }
 
+// `name` does not include leading `--`
+void parse_long_option(
+    Options &options,
+    const char *const name,
+    int &i,
+    const int argc,
+    const char *const *const argv
+) {
+    // TODO(feat): Parse arguments raw after `--`
+    if (name[0] == '\0') {
+        fprintf(stderr, "Expected option name after `--`\n");
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+
+    // Assembly cache
+    if (!strcmp(name, "cache")) {
+        if (options.cache_directory != nullptr) {
+            fprintf(stderr, "Cannot specify `--cache` more than once\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.cache_directory =
+            expect_long_option_argument(name, i, argc, argv);
+        if (strlen(options.cache_directory) >= FILENAME_MAX) {
+            fprintf(stderr, "Cache directory name is too long\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        return;
+    }
+    if (!strcmp(name, "cache-size")) {
+        if (options.cache_max_kib != 0) {
+            fprintf(stderr, "Cannot specify `--cache-size` more than once\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        const char *size_arg = expect_long_option_argument(name, i, argc, argv);
+        char *end;
+        const long long size = strtoll(size_arg, &end, 10);
+        if (end == size_arg || end[0] != '\0' || size < 1) {
+            fprintf(
+                stderr, "Expected positive size in KiB for `--cache-size`\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.cache_max_kib = size;
+        return;
+    }
+    // Debugger script
+    if (!strcmp(name, "debug-script") || !strcmp(name, "debug-commands")) {
+        if (options.debug_script_filename != nullptr ||
+            options.debug_commands != nullptr) {
+            fprintf(
+                stderr,
+                "Cannot specify `--debug-script` or `--debug-commands` more "
+                "than once\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        const char *const argument =
+            expect_long_option_argument(name, i, argc, argv);
+        if (!strcmp(name, "debug-script"))
+            options.debug_script_filename = argument;
+        else
+            options.debug_commands = argument;
+        return;
+    }
+
+    // Disassemble
+    if (!strcmp(name, "disassemble")) {
+        if (options.mode != Mode::ASSEMBLE_EXECUTE) {
+            fprintf(
+                stderr,
+                "Cannot specify `--disassemble` more than once, or with "
+                "`-a`, `-x`, or `-l`\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.mode = Mode::DISASSEMBLE_ONLY;
+        return;
+    }
+
+    // Remote debugging
+    if (!strcmp(name, "debug-server")) {
+        if (options.debug_server != nullptr) {
+            fprintf(
+                stderr, "Cannot specify `--debug-server` more than once\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.debug_server = expect_long_option_argument(name, i, argc, argv);
+        return;
+    }
+
+    if (!strcmp(name, "record-undo")) {
+        if (options.record_undo) {
+            fprintf(stderr, "Cannot specify `--record-undo` more than once\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.record_undo = true;
+        return;
+    }
+
+    // Record/replay
+    if (!strcmp(name, "record") || !strcmp(name, "replay")) {
+        const bool is_record = !strcmp(name, "record");
+        const char *&filename =
+            is_record ? options.record_filename : options.replay_filename;
+        if (filename != nullptr) {
+            fprintf(stderr, "Cannot specify `--%s` more than once\n", name);
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        filename = expect_long_option_argument(name, i, argc, argv);
+        return;
+    }
+    // Instruction budget
+    if (!strcmp(name, "max-instructions")) {
+        if (options.max_instructions != 0) {
+            fprintf(
+                stderr, "Cannot specify `--max-instructions` more than once\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.max_instructions = expect_long_option_count(
+            name, "instruction count", i, argc, argv
+        );
+        return;
+    }
+    if (!strcmp(name, "profile")) {
+        if (options.profile) {
+            fprintf(stderr, "Cannot specify `--profile` more than once\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.profile = true;
+        return;
+    }
+    if (!strcmp(name, "call-profile")) {
+        if (options.call_profile_filename != nullptr) {
+            fprintf(
+                stderr, "Cannot specify `--call-profile` more than once\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.call_profile_filename =
+            expect_long_option_argument(name, i, argc, argv);
+        return;
+    }
+    // Sampling profile
+    if (!strcmp(name, "sample") || !strcmp(name, "sample-timer")) {
+        if (options.sample_instructions != 0 ||
+            options.sample_microseconds != 0) {
+            fprintf(
+                stderr,
+                "Cannot specify `--sample` or `--sample-timer` more than "
+                "once\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        if (!strcmp(name, "sample"))
+            options.sample_instructions = expect_long_option_count(
+                name, "instruction count", i, argc, argv
+            );
+        else
+            options.sample_microseconds = expect_long_option_count(
+                name, "interval", i, argc, argv
+            );
+        return;
+    }
+    // Execution statistics
+    if (!strcmp(name, "stats")) {
+        if (options.stats) {
+            fprintf(stderr, "Cannot specify `--stats` more than once\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.stats = true;
+        return;
+    }
+    if (!strcmp(name, "stats-json")) {
+        if (options.stats_json_filename != nullptr) {
+            fprintf(stderr, "Cannot specify `--stats-json` more than once\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.stats_json_filename =
+            expect_long_option_argument(name, i, argc, argv);
+        return;
+    }
+    // Timing model
+    if (!strcmp(name, "cycles") || !strcmp(name, "cycle-costs")) {
+#ifndef LASIM_TIMING
+        fprintf(
+            stderr,
+            "Cannot specify `--%s`, as timing model was not built (use "
+            "`make TIMING=1`)\n",
+            name
+        );
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+#endif
+        if (!strcmp(name, "cycles")) {
+            if (options.cycles) {
+                fprintf(stderr, "Cannot specify `--cycles` more than once\n");
+                print_usage_hint();
+                exit(static_cast<int>(Error::CLI));
+            }
+            options.cycles = true;
+            return;
+        }
+        if (options.cycle_costs_filename != nullptr) {
+            fprintf(
+                stderr, "Cannot specify `--cycle-costs` more than once\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.cycle_costs_filename =
+            expect_long_option_argument(name, i, argc, argv);
+        return;
+    }
+    // Cache model
+    if (!strcmp(name, "cache-model")) {
+#ifndef LASIM_CACHE_MODEL
+        fprintf(
+            stderr,
+            "Cannot specify `--cache-model`, as cache model was not built "
+            "(use `make CACHE_MODEL=1`)\n"
+        );
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+#endif
+        if (options.cache_model != nullptr) {
+            fprintf(
+                stderr, "Cannot specify `--cache-model` more than once\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.cache_model = expect_long_option_argument(name, i, argc, argv);
+        return;
+    }
+    // Memory heatmap
+    if (!strcmp(name, "heatmap")) {
+        if (options.heatmap_filename != nullptr) {
+            fprintf(stderr, "Cannot specify `--heatmap` more than once\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.heatmap_filename =
+            expect_long_option_argument(name, i, argc, argv);
+        return;
+    }
+    // Line coverage
+    if (!strcmp(name, "coverage")) {
+        if (options.coverage_filename != nullptr) {
+            fprintf(stderr, "Cannot specify `--coverage` more than once\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.coverage_filename =
+            expect_long_option_argument(name, i, argc, argv);
+        return;
+    }
+    if (!strcmp(name, "coverage-data")) {
+        if (options.coverage_data_filename != nullptr) {
+            fprintf(
+                stderr, "Cannot specify `--coverage-data` more than once\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.coverage_data_filename =
+            expect_long_option_argument(name, i, argc, argv);
+        return;
+    }
+    // Uninitialized memory
+    if (!strcmp(name, "check-uninitialized")) {
+        if (options.check_uninitialized) {
+            fprintf(
+                stderr,
+                "Cannot specify `--check-uninitialized` more than once\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.check_uninitialized = true;
+        return;
+    }
+    // Self-modifying code
+    if (!strcmp(name, "check-self-modify")) {
+        if (options.check_self_modify) {
+            fprintf(
+                stderr, "Cannot specify `--check-self-modify` more than once\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.check_self_modify = true;
+        return;
+    }
+    if (!strcmp(name, "strict-self-modify")) {
+        if (options.strict_self_modify) {
+            fprintf(
+                stderr,
+                "Cannot specify `--strict-self-modify` more than once\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.strict_self_modify = true;
+        return;
+    }
+    if (!strcmp(name, "cache-stats")) {
+        if (options.cache_stats) {
+            fprintf(stderr, "Cannot specify `--cache-stats` more than once\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.cache_stats = true;
+        return;
+    }
+
+    fprintf(stderr, "Invalid option: `--%s`\n", name);
+    print_usage_hint();
+    exit(static_cast<int>(Error::CLI));
+}
+
+const char *expect_long_option_argument(
+    const char *const name,
+    int &i,
+    const int argc,
+    const char *const *const argv
+) {
+    if (i + 1 >= argc || argv[i + 1][0] == '\0') {
+        fprintf(stderr, "Expected argument for `--%s`\n", name);
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+    return argv[++i];
+}
+
+// Exits if argument is not a positive integer
+uint64_t expect_long_option_count(
+    const char *const name,
+    const char *const description,
+    int &i,
+    const int argc,
+    const char *const *const argv
+) {
+    const char *const argument =
+        expect_long_option_argument(name, i, argc, argv);
+    char *end;
+    const unsigned long long count = strtoull(argument, &end, 10);
+    if (end == argument || end[0] != '\0' || argument[0] == '-' ||
+        count < 1) {
+        fprintf(
+            stderr, "Expected positive %s for `--%s`\n", description, name
+        );
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+    return count;
+}
+
 void print_usage_hint() {
     fprintf(stderr, "Use `" PROGRAM_NAME " -h` to show usage\n");
 }
@@ -257,17 +960,99 @@ void print_usage() {
         "USAGE:\n"
         "    " PROGRAM_NAME
         " -h [-ax] [INPUT] [-o OUTPUT]\n"
+        "    " PROGRAM_NAME
+        " -a [-j JOBS] [INPUT...]\n"
+        "    " PROGRAM_NAME
+        " -l [INPUT...] -o OUTPUT\n"
+        "    " PROGRAM_NAME
+        " --disassemble [INPUT] [-o OUTPUT]\n"
         "MODE:\n"
         "    (default)      Assemble + Execute\n"
         "    -a             Assembly only\n"
         "    -x             Execute only\n"
+        "    -l             Link only\n"
+        "    --disassemble  Print source of an object file\n"
         "ARGUMENTS:\n"
         "        [INPUT]    Input filename (.asm, or .obj for -x)\n"
         "                   Use '-' to read input from stdin\n"
+        "                   Multiple files can be given with -a; each is\n"
+        "                   written to a .obj file next to its source\n"
+        "                   Multiple .obj files can be given with -x or -l;\n"
+        "                   they are linked into one program\n"
         "    -o [OUTPUT]    Output filename\n"
         "                   Use '-' to write output to stdout (with -a)\n"
         "    -d             Debug program execution\n"
-        "    -q             Minimize debugger output"
+        "    -q             Minimize debugger output\n"
+        "    --debug-script [FILE]\n"
+        "                   Run debugger commands from FILE, without a\n"
+        "                   terminal, printing machine-readable output\n"
+        "    --debug-commands [LIST]\n"
+        "                   Like --debug-script, with commands separated\n"
+        "                   by commas\n"
+        "    --debug-server [PORT|PATH]\n"
+        "                   Wait for a GDB remote protocol client on a\n"
+        "                   localhost TCP port, or a Unix socket path\n"
+        "    --record-undo  Record instructions from start, so they can be\n"
+        "                   undone (otherwise, from `record` command)\n"
+        "    -j [JOBS]      Threads to assemble multiple files with\n"
+        "                   (default: one per CPU)\n"
+        "    --cache [DIR]  Reuse objects of unchanged source files, stored\n"
+        "                   in DIR\n"
+        "    --cache-size [KIB]\n"
+        "                   Maximum size of cache (default: 64 MiB)\n"
+        "    --cache-stats  Print cache hits, misses and size\n"
+        "    --record [FILE]\n"
+        "                   Write program input and output to FILE\n"
+        "    --replay [FILE]\n"
+        "                   Read program input from FILE, and check output\n"
+        "                   matches it\n"
+        "    --max-instructions [COUNT]\n"
+        "                   Stop program after COUNT instructions\n"
+        "                   Recent instructions are printed when execution\n"
+        "                   fails, is interrupted or reaches this limit\n"
+        "    --profile      Print most executed addresses, loops and labels\n"
+        "                   when program ends\n"
+        "    --call-profile [FILE]\n"
+        "                   Write instructions executed in each stack of\n"
+        "                   subroutine calls to FILE, as folded stacks for\n"
+        "                   flame graphs, and print totals of each\n"
+        "                   subroutine\n"
+        "    --sample [COUNT]\n"
+        "                   Sample address and subroutine every COUNT\n"
+        "                   instructions, printing the most common ones\n"
+        "    --sample-timer [MICROSECONDS]\n"
+        "                   Like --sample, but on a timer of CPU time\n"
+        "    --stats        Print instruction, memory, branch and character\n"
+        "                   counts, time and speed when program ends\n"
+        "    --stats-json [FILE]\n"
+        "                   Write the same statistics to FILE as JSON\n"
+        "    --cycles       Print cycles the program would take on the LC-3\n"
+        "                   microarchitecture, for each subroutine\n"
+        "                   (only if built with `make TIMING=1`)\n"
+        "    --cycle-costs [FILE]\n"
+        "                   Like --cycles, with costs read from FILE\n"
+        "    --cache-model [SIZE,LINE,WAYS[,POLICY]]\n"
+        "                   Print hits and misses of a memory cache, with\n"
+        "                   sizes in words, and lru, fifo or random policy\n"
+        "                   (only if built with `make CACHE_MODEL=1`)\n"
+        "    --heatmap [FILE]\n"
+        "                   Write reads and writes of each memory word to\n"
+        "                   FILE (CSV if it ends with .csv, otherwise\n"
+        "                   binary), and print the most accessed words\n"
+        "    --coverage [FILE]\n"
+        "                   Write source lines executed to FILE, as an lcov\n"
+        "                   tracefile, and print lines not executed\n"
+        "    --coverage-data [FILE]\n"
+        "                   Merge addresses executed into FILE, so that\n"
+        "                   coverage includes all runs which share it\n"
+        "    --check-uninitialized\n"
+        "                   Warn when the program reads memory which was\n"
+        "                   never written, such as from .BLKW\n"
+        "    --check-self-modify\n"
+        "                   Warn when the program stores to an address it\n"
+        "                   has already executed, and count such stores\n"
+        "    --strict-self-modify\n"
+        "                   Like --check-self-modify, but fail instead\n"
         "OPTIONS:\n"
         "    -h             Print usage\n"
         ""
@@ -0,0 +1,410 @@
+#ifndef CONDITION_CPP
+#define CONDITION_CPP
+
+#include <cctype>   // isspace, tolower
+#include <cstdint>  // uint8_t
+#include <cstdio>   // FILE, fprintf
+
+#include "debuginfo.cpp"
+#include "globals.hpp"
+#include "slice.cpp"
+#include "token.cpp"
+#include "types.hpp"
+
+// Conditions of breakpoints and watchpoints, like `r3 == 0 && mem[x4000] > 10`
+// Parsed once into a small stack-based program, so evaluating on every hit is
+//     a tight loop with no parsing or allocation.
+//
+// Grammar (lowest precedence first):
+//     or          and ( `||` and )*
+//     and         compare ( `&&` compare )*
+//     compare     sum ( ( `==` | `!=` | `<` | `<=` | `>` | `>=` ) sum )?
+//     sum         unary ( ( `+` | `-` | `&` ) unary )*
+//     unary       ( `!` | `-` ) unary | primary
+//     primary     integer | r0-r7 | pc | n | z | p | mem[ or ] | label
+//                 | ( or )
+// Comparisons are signed. `n`, `z` and `p` are 1 if that condition flag is set.
+//     A label is its address.
+
+#define MAX_CONDITION_OPS 32
+#define MAX_CONDITION_STACK 8
+
+enum class ConditionOpcode : uint8_t {
+    // Push a value
+    CONSTANT,
+    REGISTER,
+    PROGRAM_COUNTER,
+    FLAG,  // Operand is a mask of `ConditionCode`
+    // Replace top value
+    MEMORY,
+    NOT,
+    NEGATE,
+    // Replace top two values
+    ADD,
+    SUBTRACT,
+    BIT_AND,
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    LOGICAL_AND,
+    LOGICAL_OR,
+};
+
+typedef struct ConditionOp {
+    ConditionOpcode opcode;
+    Word operand;
+} ConditionOp;
+
+// An empty condition is always true
+typedef struct Condition {
+    ConditionOp ops[MAX_CONDITION_OPS];
+    uint8_t length = 0;
+} Condition;
+
+// Used while compiling
+typedef struct ConditionCompiler {
+    FILE *diagnostics;
+    const char *line;
+    Condition &condition;
+    size_t depth;  // Of stack when evaluated
+    bool is_syntax_only;  // Labels are not resolved
+    bool failed;
+} ConditionCompiler;
+
+bool compile_condition(
+    FILE *const diagnostics, const char *const source, Condition &condition
+);
+bool check_condition_syntax(FILE *const diagnostics, const char *const source);
+inline bool evaluate_condition(const Condition &condition);
+// Used by `compile_condition` and `check_condition_syntax`
+bool run_condition_compiler(ConditionCompiler &compiler);
+void compile_or(ConditionCompiler &compiler);
+void compile_and(ConditionCompiler &compiler);
+void compile_compare(ConditionCompiler &compiler);
+void compile_sum(ConditionCompiler &compiler);
+void compile_unary(ConditionCompiler &compiler);
+void compile_primary(ConditionCompiler &compiler);
+void emit_condition_op(
+    ConditionCompiler &compiler,
+    const ConditionOpcode opcode,
+    const Word operand
+);
+bool take_condition_operator(ConditionCompiler &compiler, const char *const op);
+
+// Whole of `source` must be a valid expression
+bool compile_condition(
+    FILE *const diagnostics, const char *const source, Condition &condition
+) {
+    ConditionCompiler compiler = {
+        diagnostics, source, condition, 0, false, false
+    };
+    return run_condition_compiler(compiler);
+}
+
+// Labels are accepted without being resolved, as debug info may not be
+//     loaded yet
+bool check_condition_syntax(
+    FILE *const diagnostics, const char *const source
+) {
+    Condition condition;
+    ConditionCompiler compiler = {
+        diagnostics, source, condition, 0, true, false
+    };
+    return run_condition_compiler(compiler);
+}
+
+bool run_condition_compiler(ConditionCompiler &compiler) {
+    Condition &condition = compiler.condition;
+    condition.length = 0;
+    compile_or(compiler);
+    while (isspace(compiler.line[0]))
+        ++compiler.line;
+    if (!compiler.failed && compiler.line[0] != '\0') {
+        fprintf(
+            compiler.diagnostics, "Unexpected characters in condition\n"
+        );
+        compiler.failed = true;
+    }
+    if (compiler.failed)
+        condition.length = 0;
+    return !compiler.failed;
+}
+
+// Values are only pushed within bounds, which was checked when compiling
+inline bool evaluate_condition(const Condition &condition) {
+    if (condition.length == 0)
+        return true;
+
+    Word stack[MAX_CONDITION_STACK];
+    size_t top = 0;  // Count of values
+    for (size_t i = 0; i < condition.length; ++i) {
+        const ConditionOp &op = condition.ops[i];
+        switch (op.opcode) {
+            case ConditionOpcode::CONSTANT:
+                stack[top++] = op.operand;
+                continue;
+            case ConditionOpcode::REGISTER:
+                stack[top++] = registers.general_purpose[op.operand];
+                continue;
+            case ConditionOpcode::PROGRAM_COUNTER:
+                stack[top++] = registers.program_counter;
+                continue;
+            case ConditionOpcode::FLAG:
+                stack[top++] =
+                    (static_cast<Word>(registers.condition) & op.operand) != 0;
+                continue;
+
+            case ConditionOpcode::MEMORY:
+                stack[top - 1] = memory[stack[top - 1]];
+                continue;
+            case ConditionOpcode::NOT:
+                stack[top - 1] = !stack[top - 1];
+                continue;
+            case ConditionOpcode::NEGATE:
+                stack[top - 1] = -stack[top - 1];
+                continue;
+
+            default:
+                break;
+        }
+
+        --top;
+        Word &a = stack[top - 1];
+        const Word b = stack[top];
+        const SignedWord a_signed = static_cast<SignedWord>(a);
+        const SignedWord b_signed = static_cast<SignedWord>(b);
+        switch (op.opcode) {
+            case ConditionOpcode::ADD:
+                a += b;
+                break;
+            case ConditionOpcode::SUBTRACT:
+                a -= b;
+                break;
+            case ConditionOpcode::BIT_AND:
+                a &= b;
+                break;
+            case ConditionOpcode::EQUAL:
+                a = a == b;
+                break;
+            case ConditionOpcode::NOT_EQUAL:
+                a = a != b;
+                break;
+            case ConditionOpcode::LESS:
+                a = a_signed < b_signed;
+                break;
+            case ConditionOpcode::LESS_EQUAL:
+                a = a_signed <= b_signed;
+                break;
+            case ConditionOpcode::GREATER:
+                a = a_signed > b_signed;
+                break;
+            case ConditionOpcode::GREATER_EQUAL:
+                a = a_signed >= b_signed;
+                break;
+            case ConditionOpcode::LOGICAL_AND:
+                a = a && b;
+                break;
+            case ConditionOpcode::LOGICAL_OR:
+                a = a || b;
+                break;
+            default:
+                break;
+        }
+    }
+    return stack[0] != 0;
+}
+
+void compile_or(ConditionCompiler &compiler) {
+    compile_and(compiler);
+    while (!compiler.failed && take_condition_operator(compiler, "||")) {
+        compile_and(compiler);
+        emit_condition_op(compiler, ConditionOpcode::LOGICAL_OR, 0);
+    }
+}
+
+void compile_and(ConditionCompiler &compiler) {
+    compile_compare(compiler);
+    while (!compiler.failed && take_condition_operator(compiler, "&&")) {
+        compile_compare(compiler);
+        emit_condition_op(compiler, ConditionOpcode::LOGICAL_AND, 0);
+    }
+}
+
+void compile_compare(ConditionCompiler &compiler) {
+    compile_sum(compiler);
+    RETURN_IF_FAILED(compiler.failed);
+
+    // Longer operators must be checked first
+    ConditionOpcode opcode;
+    if (take_condition_operator(compiler, "=="))
+        opcode = ConditionOpcode::EQUAL;
+    else if (take_condition_operator(compiler, "!="))
+        opcode = ConditionOpcode::NOT_EQUAL;
+    else if (take_condition_operator(compiler, "<="))
+        opcode = ConditionOpcode::LESS_EQUAL;
+    else if (take_condition_operator(compiler, ">="))
+        opcode = ConditionOpcode::GREATER_EQUAL;
+    else if (take_condition_operator(compiler, "<"))
+        opcode = ConditionOpcode::LESS;
+    else if (take_condition_operator(compiler, ">"))
+        opcode = ConditionOpcode::GREATER;
+    else
+        return;
+
+    compile_sum(compiler);
+    emit_condition_op(compiler, opcode, 0);
+}
+
+void compile_sum(ConditionCompiler &compiler) {
+    compile_unary(compiler);
+    while (!compiler.failed) {
+        ConditionOpcode opcode;
+        // Don't take first character of `&&`
+        if (take_condition_operator(compiler, "+"))
+            opcode = ConditionOpcode::ADD;
+        else if (take_condition_operator(compiler, "-"))
+            opcode = ConditionOpcode::SUBTRACT;
+        else if (compiler.line[0] == '&' && compiler.line[1] != '&' &&
+                 take_condition_operator(compiler, "&"))
+            opcode = ConditionOpcode::BIT_AND;
+        else
+            return;
+        compile_unary(compiler);
+        emit_condition_op(compiler, opcode, 0);
+    }
+}
+
+void compile_unary(ConditionCompiler &compiler) {
+    ConditionOpcode opcode;
+    // Don't take `!=`, which is never at the start of an operand anyway
+    if (take_condition_operator(compiler, "!")) {
+        opcode = ConditionOpcode::NOT;
+    } else if (compiler.line[0] == '-' && !isdigit(compiler.line[1]) &&
+               take_condition_operator(compiler, "-")) {
+        // Negative integers are parsed as one literal
+        opcode = ConditionOpcode::NEGATE;
+    } else {
+        compile_primary(compiler);
+        return;
+    }
+    compile_unary(compiler);
+    emit_condition_op(compiler, opcode, 0);
+}
+
+void compile_primary(ConditionCompiler &compiler) {
+    const char *&line = compiler.line;
+    while (isspace(line[0]))
+        ++line;
+
+    if (take_condition_operator(compiler, "(")) {
+        compile_or(compiler);
+        RETURN_IF_FAILED(compiler.failed);
+        if (!take_condition_operator(compiler, ")")) {
+            fprintf(compiler.diagnostics, "Expected `)` in condition\n");
+            compiler.failed = true;
+        }
+        return;
+    }
+
+    InitialSignWord integer;
+    const int result = take_integer(compiler.diagnostics, line, integer);
+    if (result == 1) {
+        emit_condition_op(compiler, ConditionOpcode::CONSTANT, integer.value);
+        return;
+    }
+    if (result < 0 || !is_char_valid_identifier_start(line[0])) {
+        fprintf(compiler.diagnostics, "Expected operand in condition\n");
+        compiler.failed = true;
+        return;
+    }
+
+    StringSlice name;
+    name.pointer = line;
+    while (is_char_valid_in_identifier(tolower(line[0])))
+        ++line;
+    name.length = line - name.pointer;
+
+    if (name.length == 2 && tolower(name.pointer[0]) == 'r' &&
+        name.pointer[1] >= '0' && name.pointer[1] < '0' + GP_REGISTER_COUNT) {
+        const Word reg = name.pointer[1] - '0';
+        emit_condition_op(compiler, ConditionOpcode::REGISTER, reg);
+    } else if (string_equals_slice("pc", name)) {
+        emit_condition_op(compiler, ConditionOpcode::PROGRAM_COUNTER, 0);
+    } else if (string_equals_slice("n", name)) {
+        const Word mask = static_cast<Word>(ConditionCode::NEGATIVE);
+        emit_condition_op(compiler, ConditionOpcode::FLAG, mask);
+    } else if (string_equals_slice("z", name)) {
+        const Word mask = static_cast<Word>(ConditionCode::ZERO);
+        emit_condition_op(compiler, ConditionOpcode::FLAG, mask);
+    } else if (string_equals_slice("p", name)) {
+        const Word mask = static_cast<Word>(ConditionCode::POSITIVE);
+        emit_condition_op(compiler, ConditionOpcode::FLAG, mask);
+    } else if (string_equals_slice("mem", name)) {
+        if (!take_condition_operator(compiler, "[")) {
+            fprintf(compiler.diagnostics, "Expected `[` after `mem`\n");
+            compiler.failed = true;
+            return;
+        }
+        compile_or(compiler);
+        RETURN_IF_FAILED(compiler.failed);
+        if (!take_condition_operator(compiler, "]")) {
+            fprintf(compiler.diagnostics, "Expected `]` in condition\n");
+            compiler.failed = true;
+            return;
+        }
+        emit_condition_op(compiler, ConditionOpcode::MEMORY, 0);
+    } else if (compiler.is_syntax_only) {
+        emit_condition_op(compiler, ConditionOpcode::CONSTANT, 0);
+    } else {
+        const Symbol *const symbol = find_symbol_by_name(debug_info, name);
+        if (symbol == nullptr) {
+            fprintf(compiler.diagnostics, "Unknown label in condition\n");
+            compiler.failed = true;
+            return;
+        }
+        emit_condition_op(compiler, ConditionOpcode::CONSTANT, symbol->address);
+    }
+}
+
+// Tracks stack depth, so evaluation never needs to check bounds
+void emit_condition_op(
+    ConditionCompiler &compiler,
+    const ConditionOpcode opcode,
+    const Word operand
+) {
+    RETURN_IF_FAILED(compiler.failed);
+    Condition &condition = compiler.condition;
+    if (opcode <= ConditionOpcode::FLAG)
+        ++compiler.depth;
+    else if (opcode >= ConditionOpcode::ADD)
+        --compiler.depth;
+    if (condition.length >= MAX_CONDITION_OPS ||
+        compiler.depth > MAX_CONDITION_STACK) {
+        fprintf(compiler.diagnostics, "Condition is too complex\n");
+        compiler.failed = true;
+        return;
+    }
+    condition.ops[condition.length] = {opcode, operand};
+    ++condition.length;
+}
+
+// Skips leading whitespace
+bool take_condition_operator(
+    ConditionCompiler &compiler, const char *const op
+) {
+    const char *&line = compiler.line;
+    while (isspace(line[0]))
+        ++line;
+    size_t i = 0;
+    for (; op[i] != '\0'; ++i) {
+        if (line[i] != op[i])
+            return false;
+    }
+    line += i;
+    return true;
+}
+
+#endif
@@ -0,0 +1,260 @@
+#ifndef COVERAGE_CPP
+#define COVERAGE_CPP
+
+#include <fcntl.h>     // open
+#include <sys/file.h>  // flock
+#include <unistd.h>    // close
+
+#include <cstdint>  // uint8_t, uint64_t
+#include <cstdio>   // FILE, fopen, etc
+#include <cstring>  // memset
+
+#include "bitmap.cpp"
+#include "bytes.cpp"
+#include "cache.cpp"
+#include "debuginfo.cpp"
+#include "error.hpp"
+#include "globals.hpp"
+#include "types.hpp"
+
+// Source lines executed by a program, from a bitmap of executed addresses
+// Only instruction lines are counted. Data lines are never executed
+// The bitmap can be kept in a data file, which each run merges into (with
+//     OR), so that coverage of many runs with different input is reported
+//     by the last one
+// Executed addresses are also recorded for `--check-self-modify`, without
+//     coverage being reported
+
+#define COVERAGE_MAGIC 0x4c41'4356  // "LACV"
+#define COVERAGE_VERSION 1
+#define COVERAGE_BITMAP_SIZE (MEMORY_SIZE / 8)
+
+typedef struct Coverage {
+    bool is_enabled = false;
+    const char *lcov_filename = nullptr;  // Not written if `nullptr`
+    const char *data_filename = nullptr;  // Not merged if `nullptr`
+    char source_filename[FILENAME_MAX];   // Empty if not known
+    uint64_t program_hash = 0;            // Of words loaded into memory
+    AddressBitmap executed;  // Set before each instruction is executed
+} Coverage;
+
+static Coverage coverage;
+
+void start_coverage(void);
+inline void record_coverage(const Word program_counter);
+void finish_coverage(Error &error);
+// Used by `finish_coverage`
+bool merge_coverage_data_file(const char *const filename);
+bool write_coverage_lcov_file(const char *const filename);
+void print_coverage_summary(FILE *const file);
+bool is_line_executed(const size_t index);
+// Used by `merge_coverage_data_file`
+void get_coverage_bytes(uint8_t *const bytes);
+void merge_coverage_bytes(const uint8_t *const bytes);
+
+// Must be called after program is loaded, and before it modifies itself
+void start_coverage() {
+    memset(coverage.executed, 0, sizeof(coverage.executed));
+    const Word size =
+        static_cast<Word>(memory_file_bounds.end - memory_file_bounds.start);
+    coverage.program_hash = hash_bytes(
+        &memory[memory_file_bounds.start], size * WORD_SIZE, FNV_OFFSET_BASIS
+    );
+}
+
+// Called before instruction is executed, so it may modify itself
+inline void record_coverage(const Word program_counter) {
+    bitmap_set(coverage.executed, program_counter, true);
+}
+
+// Summary is printed even if files fail
+void finish_coverage(Error &error) {
+    if (coverage.data_filename != nullptr &&
+        !merge_coverage_data_file(coverage.data_filename))
+        SET_ERROR(error, FILE);
+    if (coverage.lcov_filename != nullptr &&
+        !write_coverage_lcov_file(coverage.lcov_filename))
+        SET_ERROR(error, FILE);
+    print_coverage_summary(stderr);
+}
+
+// File format (integers big-endian):
+//     u32     magic
+//     u32     version
+//     u32[2]  hash of program (high, then low half)
+//     u8[]    bitmap. Bit `n % 8` of byte `n / 8` is set if address `n` was
+//             executed
+// Created if it does not exist. Locked while merging, so that many runs can
+//     share a file at once
+bool merge_coverage_data_file(const char *const filename) {
+    const int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open coverage data: %s\n", filename);
+        return false;
+    }
+    FILE *const file = fdopen(fd, "r+b");
+    if (file == nullptr) {
+        close(fd);
+        fprintf(stderr, "Failed to open coverage data: %s\n", filename);
+        return false;
+    }
+    flock(fd, LOCK_EX);  // Released when closed
+
+    uint32_t magic, version, hash_high, hash_low;
+    if (read_u32(file, magic)) {
+        uint8_t previous[COVERAGE_BITMAP_SIZE];
+        const bool ok =
+            magic == COVERAGE_MAGIC && read_u32(file, version) &&
+            version == COVERAGE_VERSION && read_u32(file, hash_high) &&
+            read_u32(file, hash_low) &&
+            fread(previous, 1, sizeof(previous), file) == sizeof(previous);
+        if (!ok) {
+            fprintf(stderr, "Invalid coverage data: %s\n", filename);
+            fclose(file);
+            return false;
+        }
+        const uint64_t hash =
+            (static_cast<uint64_t>(hash_high) << 32) | hash_low;
+        if (hash != coverage.program_hash) {
+            fprintf(
+                stderr,
+                "Coverage data is of a different program: %s\n",
+                filename
+            );
+            fclose(file);
+            return false;
+        }
+        merge_coverage_bytes(previous);
+    }
+
+    uint8_t bytes[COVERAGE_BITMAP_SIZE];
+    get_coverage_bytes(bytes);
+    rewind(file);
+    bool ok =
+        write_u32(file, COVERAGE_MAGIC) && write_u32(file, COVERAGE_VERSION) &&
+        write_u32(file, static_cast<uint32_t>(coverage.program_hash >> 32)) &&
+        write_u32(file, static_cast<uint32_t>(coverage.program_hash)) &&
+        fwrite(bytes, 1, COVERAGE_BITMAP_SIZE, file) == COVERAGE_BITMAP_SIZE;
+    ok = fclose(file) == 0 && ok;
+    if (!ok)
+        fprintf(stderr, "Failed to write coverage data: %s\n", filename);
+    return ok;
+}
+
+// Bitmap of data file, independent of host byte order
+void get_coverage_bytes(uint8_t *const bytes) {
+    for (size_t i = 0; i < COVERAGE_BITMAP_SIZE; ++i) {
+        bytes[i] =
+            static_cast<uint8_t>(coverage.executed[i / 8] >> (i % 8 * 8));
+    }
+}
+
+void merge_coverage_bytes(const uint8_t *const bytes) {
+    for (size_t i = 0; i < COVERAGE_BITMAP_SIZE; ++i) {
+        coverage.executed[i / 8] |=
+            static_cast<uint64_t>(bytes[i]) << (i % 8 * 8);
+    }
+}
+
+// Tracefile format of `lcov`, with one source file
+bool write_coverage_lcov_file(const char *const filename) {
+    FILE *const file = fopen(filename, "w");
+    if (file == nullptr) {
+        fprintf(stderr, "Failed to open coverage for writing: %s\n", filename);
+        return false;
+    }
+
+    fprintf(file, "TN:\n");
+    fprintf(file, "SF:%s\n", coverage.source_filename);
+    size_t found = 0;
+    size_t hit = 0;
+    const vector<LineEntry> &lines = debug_info.lines;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (lines[i].kind != LineKind::CODE || lines[i].line == 0)
+            continue;
+        const bool is_executed = is_line_executed(i);
+        fprintf(file, "DA:%u,%d\n", lines[i].line, is_executed ? 1 : 0);
+        ++found;
+        if (is_executed)
+            ++hit;
+    }
+    fprintf(file, "LF:%zu\n", found);
+    fprintf(file, "LH:%zu\n", hit);
+    fprintf(file, "end_of_record\n");
+
+    const bool failed = ferror(file) != 0;
+    if (fclose(file) != 0 || failed) {
+        fprintf(stderr, "Failed to write coverage: %s\n", filename);
+        return false;
+    }
+    return true;
+}
+
+// Consecutive lines which were not executed are listed together
+void print_coverage_summary(FILE *const file) {
+    const vector<LineEntry> &lines = debug_info.lines;
+    size_t found = 0;
+    size_t hit = 0;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (lines[i].kind != LineKind::CODE || lines[i].line == 0)
+            continue;
+        ++found;
+        if (is_line_executed(i))
+            ++hit;
+    }
+
+    if (found == 0) {
+        size_t words = 0;
+        for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+            if (bitmap_test(coverage.executed, static_cast<Word>(i)))
+                ++words;
+        }
+        fprintf(
+            file,
+            "\nCoverage: %zu addresses executed (no line information)\n",
+            words
+        );
+        return;
+    }
+
+    fprintf(
+        file,
+        "\nCoverage: %zu of %zu lines (%.1f%%)\n",
+        hit,
+        found,
+        100.0 * hit / found
+    );
+    if (hit == found)
+        return;
+    fprintf(file, "Not executed:\n");
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (lines[i].kind != LineKind::CODE || lines[i].line == 0 ||
+            is_line_executed(i))
+            continue;
+        size_t last = i;
+        while (last + 1 < lines.size() &&
+               lines[last + 1].kind == LineKind::CODE &&
+               lines[last + 1].line != 0 && !is_line_executed(last + 1))
+            ++last;
+        fprintf(file, "    ");
+        print_symbolized_address(file, debug_info, lines[i].address);
+        if (last > i)
+            fprintf(file, " to line %u", lines[last].line);
+        fprintf(file, "\n");
+        i = last;
+    }
+}
+
+// Whether any address of line entry `index` was executed
+bool is_line_executed(const size_t index) {
+    const vector<LineEntry> &lines = debug_info.lines;
+    const size_t end = index + 1 < lines.size() ? lines[index + 1].address
+                                                : MEMORY_SIZE;
+    for (size_t address = lines[index].address; address < end; ++address) {
+        if (bitmap_test(coverage.executed, static_cast<Word>(address)))
+            return true;
+    }
+    return false;
+}
+
+#endif
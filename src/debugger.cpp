@@ -1,8 +1,17 @@
 #ifndef DEBUGGER_CPP
 #define DEBUGGER_CPP
 
-#include <cstdio>  // fprintf, getchar
+#include <cstdint>  // uint64_t
+#include <cstdio>   // fprintf, getchar
+#include <cstring>  // memcpy, strcpy
+#include <vector>   // std::vector
 
+#include "bitmap.cpp"
+#include "bitmasks.hpp"
+#include "condition.cpp"
+#include "debuginfo.cpp"
+#include "disassemble.cpp"
+#include "error.hpp"
 #include "globals.hpp"
 #include "slice.cpp"
 #include "token.cpp"
@@ -22,24 +31,18 @@
 //    trap t        simulate trap
 //    halt          simulate HALT
 //    step n        execute next instruction
-//    next          execute next instruction or subroutine
 //    continue      continue till next HALT or breakpoint
-//    finish        execute to end of current subroutine
 //    quit          quit debugger, continue execution
 //    exit          quit debugger and executor
-// TODO(feat): How would these debugger commands work?
-//    break?     set/remove breakpoint
-
-// TODO(feat): Keep track of labels for debugger
-//     Maybe make label_definitions list global/static
-//     A symbol table file seems more hassle than it's worth
 
 // TODO(refactor): Create header file for execute.cpp or extract functions
 void print_on_new_line(void);
 static char *halfbyte_string(const Word word);
+bool is_call_stack_required(void);
 
-#define MAX_DEBUGGER_COMMAND 20  // Includes '\0'
+#define MAX_DEBUGGER_COMMAND 64  // Includes '\0'
 #define MAX_DEBUGGER_HISTORY 4
+#define DEBUGGER_LIST_COUNT 10  // Instructions shown by `list`
 
 #define stddbg stderr
 
@@ -69,15 +72,247 @@ static char *halfbyte_string(const Word word);
         fprintf(stddbg, __VA_ARGS__); \
         fflush(stddbg);               \
     }
+// Machine-readable event, only printed when running a debugger script
+#define dprintf_script(...)               \
+    {                                     \
+        if (debugger_script.is_enabled) { \
+            fprintf(stddbg, __VA_ARGS__); \
+            fflush(stddbg);               \
+        }                                 \
+    }
+// Invalid debugger command. Always printed when running a debugger script
+#define dprintfc_error(...)                     \
+    {                                           \
+        if (debugger_script.is_enabled) {       \
+            fprintf(stddbg, "error ");          \
+            fprintf(stddbg, __VA_ARGS__);       \
+            fflush(stddbg);                     \
+        } else {                                \
+            dprintfc(__VA_ARGS__);              \
+        }                                       \
+    }
 
 // TODO(refactor): Move to state object, when that's implemented
 // TODO(refactor): Maybe make all debugger state in a separate static object
 static bool debugger_quiet = false;
 
+// Source is kept for listing
+typedef struct BreakpointCondition {
+    Word address;
+    Condition condition;
+    char source[MAX_DEBUGGER_COMMAND];
+} BreakpointCondition;
+
+// One bit per address, so checking for a breakpoint is a single bit test
+typedef struct Breakpoints {
+    AddressBitmap bits;
+    AddressBitmap conditional;  // Only these have an entry in `conditions`
+    size_t count;
+    std::vector<BreakpointCondition> conditions;
+} Breakpoints;
+
+static Breakpoints breakpoints;
+
+inline bool is_breakpoint(const Word addr) {
+    return bitmap_test(breakpoints.bits, addr);
+}
+
+// First watched access by an instruction
+typedef struct WatchpointHit {
+    bool is_write;
+    Word program_counter;  // Of instruction
+    Word address;
+    Word old_value;
+    Word new_value;  // Same as `old_value` for reads
+} WatchpointHit;
+
+// Condition of a range of watchpoints of one kind
+// An empty condition overrides conditions of older ranges
+typedef struct WatchpointCondition {
+    bool is_write;
+    Word start;
+    Word end;  // Inclusive
+    Condition condition;
+    char source[MAX_DEBUGGER_COMMAND];
+} WatchpointCondition;
+
+// Checked by loads and stores, and by traps which read strings
+typedef struct Watchpoints {
+    AddressBitmap reads;
+    AddressBitmap writes;
+    size_t count;    // Of set bits in both bitmaps. Nothing is checked if 0
+    bool triggered;  // Cleared when hit is reported
+    WatchpointHit hit;
+    std::vector<WatchpointCondition> conditions;  // Newest last
+} Watchpoints;
+
+static Watchpoints watchpoints;
+
+#define UNDO_LOG_SIZE (1 << 18)  // Entries. Must be a power of 2
+#define UNDO_NO_REGISTER 0xFF
+
+// Bits of `UndoEntry::flags`, above the condition code
+#define UNDO_MEMORY 0x08  // Memory word was written
+#define UNDO_INPUT 0x10   // Character was read
+#define UNDO_CALL 0x20    // Call frame was pushed
+#define UNDO_RETURN 0x40  // Call frame was popped, and is kept in `memory_*`
+
+// What an instruction overwrote, so it can be reverted (10 bytes)
+// An instruction writes at most one register and one memory word
+typedef struct UndoEntry {
+    Word program_counter;
+    Word register_value;
+    Word memory_address;  // Or call site of popped frame
+    Word memory_value;    // Or subroutine of popped frame
+    uint8_t register_index;
+    uint8_t flags;  // Condition code in low 3 bits, then `UNDO_*` bits
+} UndoEntry;
+
+// Ring buffer of the most recent instructions executed while debugging
+// Nothing is allocated while recording
+typedef struct UndoLog {
+    bool is_enabled;
+    UndoEntry entries[UNDO_LOG_SIZE];
+    size_t next;   // Index of next entry, before wrapping
+    size_t count;  // Of entries which can be undone
+    size_t redo_count;  // Of undone instructions which are not executed again
+    UndoEntry current;  // Of instruction being executed
+    // Characters read by undone instructions, to be read again (newest first)
+    std::vector<char> unread_input;
+} UndoLog;
+
+static UndoLog undo_log;
+
+// Register which instruction may write, or `UNDO_NO_REGISTER`
+// Traps may write R0 (`GETC`/`IN`). Saving it when unchanged is harmless
+inline uint8_t written_register(const Word instr) {
+    switch (static_cast<Opcode>(instr >> 12)) {
+        case Opcode::ADD:
+        case Opcode::AND:
+        case Opcode::NOT:
+        case Opcode::LD:
+        case Opcode::LDI:
+        case Opcode::LDR:
+        case Opcode::LEA:
+            return bits_9_11(instr);
+        case Opcode::JSR_JSRR:
+            return 7;
+        case Opcode::TRAP:
+            return 0;
+        default:
+            return UNDO_NO_REGISTER;
+    }
+}
+
+// Register is saved before instruction runs, decoded from instruction, so
+//     that instruction handlers do nothing for undo
+inline void begin_undo_entry() {
+    UndoEntry &entry = undo_log.current;
+    entry.program_counter = registers.program_counter;
+    entry.flags = static_cast<uint8_t>(registers.condition);
+    entry.register_index =
+        written_register(memory[registers.program_counter]);
+    if (entry.register_index != UNDO_NO_REGISTER)
+        entry.register_value = registers.general_purpose[entry.register_index];
+}
+
+inline void end_undo_entry() {
+    const UndoEntry &entry = undo_log.current;
+    if (undo_log.redo_count > 0)
+        --undo_log.redo_count;
+    undo_log.entries[undo_log.next & (UNDO_LOG_SIZE - 1)] = entry;
+    ++undo_log.next;
+    if (undo_log.count < UNDO_LOG_SIZE)
+        ++undo_log.count;
+}
+
+inline void record_undo_memory(const Word addr, const Word old_value) {
+    undo_log.current.memory_address = addr;
+    undo_log.current.memory_value = old_value;
+    undo_log.current.flags |= UNDO_MEMORY;
+}
+
+#define MAX_CALL_STACK 1024
+#define NO_STOP_DEPTH SIZE_MAX
+// Return from a call made before call stack was enabled
+#define OUTER_STOP_DEPTH (SIZE_MAX - 1)
+
+typedef struct CallFrame {
+    Word call_site;  // Address of `JSR`/`JSRR` instruction
+    Word subroutine;
+} CallFrame;
+
+// Shadow of subroutine calls, pushed by `JSR`/`JSRR` and popped by `RET`
+// Only the outermost `MAX_CALL_STACK` frames are recorded, but depth is
+//     always tracked, so `next` and `finish` work with any recursion
+// The debugger only enables it when `next`, `finish` or `bt` is first used
+typedef struct CallStack {
+    bool is_enabled;
+    bool is_partial;  // Enabled after program started, so calls are missing
+    CallFrame frames[MAX_CALL_STACK];
+    size_t depth;
+    size_t stop_depth;  // Return to this depth suspends execution
+    bool returned;      // Cleared when execution is suspended
+} CallStack;
+
+static CallStack call_stack = {false, false, {}, 0, NO_STOP_DEPTH, false};
+
+inline void push_call_frame(const Word call_site, const Word subroutine) {
+    if (call_stack.depth < MAX_CALL_STACK)
+        call_stack.frames[call_stack.depth] = {call_site, subroutine};
+    ++call_stack.depth;
+    if (undo_log.is_enabled)
+        undo_log.current.flags |= UNDO_CALL;
+}
+
+// Program entry, if not in a subroutine
+// Calls nested past `MAX_CALL_STACK` give the innermost recorded subroutine
+inline Word current_subroutine() {
+    if (call_stack.depth == 0)
+        return memory_file_bounds.entry;
+    const size_t depth =
+        call_stack.depth < MAX_CALL_STACK ? call_stack.depth : MAX_CALL_STACK;
+    return call_stack.frames[depth - 1].subroutine;
+}
+
+// `RET` with no frame (such as from a program's entry) is ignored, unless it
+//     completes a `finish` of a call which was not tracked
+inline void pop_call_frame() {
+    if (call_stack.depth == 0) {
+        if (call_stack.stop_depth == OUTER_STOP_DEPTH)
+            call_stack.returned = true;
+        return;
+    }
+    --call_stack.depth;
+    if (call_stack.depth == call_stack.stop_depth)
+        call_stack.returned = true;
+    // Frame may be overwritten by a later call
+    // Depth is restored by undo even if frame was not recorded
+    if (undo_log.is_enabled) {
+        if (call_stack.depth < MAX_CALL_STACK) {
+            const CallFrame &frame = call_stack.frames[call_stack.depth];
+            undo_log.current.memory_address = frame.call_site;
+            undo_log.current.memory_value = frame.subroutine;
+        }
+        undo_log.current.flags |= UNDO_RETURN;
+    }
+}
+
+// Calls made before now are not known
+void enable_call_stack() {
+    if (call_stack.is_enabled)
+        return;
+    call_stack.is_enabled = true;
+    call_stack.is_partial = instruction_count > 0;
+    call_stack.depth = 0;
+}
+
 // Only for debugger commands which affect program control-flow
 enum class DebuggerAction {
     NONE,      // No control-flow action taken
     STEP,      // Execute next instruction
+    NEXT,      // Execute next instruction, or subroutine called by it
+    FINISH,    // Continue until current subroutine returns
     CONTINUE,  // Continue until breakpoint or HALT
     QUIT,      // Quit debugger and simulator
     STOP,      // Stop debugger, continue simulator
@@ -100,13 +335,43 @@ enum class DebuggerCommand {
     UNKNOWN,
     REGISTERS,
     STEP,
+    NEXT,
+    FINISH,
+    BACKTRACE,
+    LIST,
+    RECORD,
+    REVERSE_STEP,
+    REVERSE_CONTINUE,
     CONTINUE,
     MEMORY_GET,
     MEMORY_SET,
+    BREAK_ADD,
+    BREAK_REMOVE,
+    BREAK_LIST,
+    WATCH_WRITE,
+    WATCH_READ,
+    WATCH_REMOVE,
+    WATCH_LIST,
     QUIT,
     STOP,
 };
 
+// Command of `--debug-script` or `--debug-commands`
+typedef struct ScriptCommand {
+    DebuggerCommand command;
+    Command arguments;
+} ScriptCommand;
+
+// Commands are parsed before execution, and run without any terminal I/O
+// Output is as with `-q`, with events and errors printed as single lines
+typedef struct DebuggerScript {
+    bool is_enabled = false;
+    std::vector<ScriptCommand> commands;
+    size_t next = 0;
+} DebuggerScript;
+
+static DebuggerScript debugger_script;
+
 // TODO(refactor): Create function prototypes
 // TODO(lint): Use `void` param for prototypes of these functions
 // TODO(refactor): Rename functions
@@ -114,6 +379,19 @@ enum class DebuggerCommand {
 
 void print_registers(FILE *const file);
 char condition_char(ConditionCode condition);
+DebuggerCommand take_command(const char *&line);
+void print_disassembly(const Word start, const Word count);
+DebuggerAction run_debugger_command(
+    const DebuggerCommand command, const char *line
+);
+bool set_breakpoint_condition(
+    const Word addr,
+    const Condition *const condition,
+    const char *const source
+);
+// Defined in remote.cpp
+bool is_remote_connected(void);
+DebuggerAction ask_remote_command(void);
 
 void push_history(const char *const buffer) {
     if (history.length >= MAX_DEBUGGER_HISTORY) {
@@ -245,6 +523,33 @@ DebuggerCommand take_command(const char *&line) {
         string_equals_slice("step", command)) {
         return DebuggerCommand::STEP;
     }
+    if (string_equals_slice("n", command) ||
+        string_equals_slice("next", command)) {
+        return DebuggerCommand::NEXT;
+    }
+    if (string_equals_slice("fin", command) ||
+        string_equals_slice("finish", command)) {
+        return DebuggerCommand::FINISH;
+    }
+    if (string_equals_slice("rs", command) ||
+        string_equals_slice("reverse-step", command)) {
+        return DebuggerCommand::REVERSE_STEP;
+    }
+    if (string_equals_slice("record", command)) {
+        return DebuggerCommand::RECORD;
+    }
+    if (string_equals_slice("rc", command) ||
+        string_equals_slice("reverse-continue", command)) {
+        return DebuggerCommand::REVERSE_CONTINUE;
+    }
+    if (string_equals_slice("bt", command) ||
+        string_equals_slice("backtrace", command)) {
+        return DebuggerCommand::BACKTRACE;
+    }
+    if (string_equals_slice("l", command) ||
+        string_equals_slice("list", command)) {
+        return DebuggerCommand::LIST;
+    }
     if (string_equals_slice("c", command) ||
         string_equals_slice("cont", command) ||
         string_equals_slice("continue", command)) {
@@ -264,6 +569,34 @@ DebuggerCommand take_command(const char *&line) {
         string_equals_slice("memoryset", command)) {
         return DebuggerCommand::MEMORY_SET;
     }
+    if (string_equals_slice("b", command) ||
+        string_equals_slice("break", command)) {
+        return DebuggerCommand::BREAK_ADD;
+    }
+    if (string_equals_slice("bd", command) ||
+        string_equals_slice("delete", command)) {
+        return DebuggerCommand::BREAK_REMOVE;
+    }
+    if (string_equals_slice("bl", command) ||
+        string_equals_slice("breakpoints", command)) {
+        return DebuggerCommand::BREAK_LIST;
+    }
+    if (string_equals_slice("w", command) ||
+        string_equals_slice("watch", command)) {
+        return DebuggerCommand::WATCH_WRITE;
+    }
+    if (string_equals_slice("wr", command) ||
+        string_equals_slice("rwatch", command)) {
+        return DebuggerCommand::WATCH_READ;
+    }
+    if (string_equals_slice("wd", command) ||
+        string_equals_slice("unwatch", command)) {
+        return DebuggerCommand::WATCH_REMOVE;
+    }
+    if (string_equals_slice("wl", command) ||
+        string_equals_slice("watchpoints", command)) {
+        return DebuggerCommand::WATCH_LIST;
+    }
     if (string_equals_slice("q", command) ||
         string_equals_slice("quit", command)) {
         return DebuggerCommand::QUIT;
@@ -274,27 +607,88 @@ DebuggerCommand take_command(const char *&line) {
     return DebuggerCommand::UNKNOWN;
 }
 
+// Address may be given as an integer or a label (if debug info is loaded)
 bool expect_address(const char *&line, Word &addr) {
     take_whitespace(line);
     InitialSignWord integer;
-    if (take_integer(line, integer) != 1 || integer.is_signed) {
-        dprintfc("Expected address argument\n");
+    const int result = take_integer(stddbg, line, integer);
+    if (result == 0 && is_char_valid_identifier_start(line[0])) {
+        StringSlice name;
+        name.pointer = line;
+        while (is_char_valid_in_identifier(tolower(line[0])))
+            ++line;
+        name.length = line - name.pointer;
+        const Symbol *const symbol = find_symbol_by_name(debug_info, name);
+        if (symbol == nullptr) {
+            dprintfc_error("Unknown label\n");
+            return false;
+        }
+        addr = symbol->address;
+    } else if (result != 1 || integer.is_signed) {
+        dprintfc_error("Expected address argument\n");
         return false;
+    } else {
+        addr = integer.value;
     }
-    addr = integer.value;
     // Reflects `memory_checked`
     if (addr < memory_file_bounds.start || addr > MEMORY_USER_MAX) {
-        dprintfc("Memory address is out of bounds\n");
+        dprintfc_error("Memory address is out of bounds\n");
+        return false;
+    }
+    return true;
+}
+
+// Start of `if` and condition, following an address
+bool is_condition_keyword(const char *const line) {
+    return tolower(line[0]) == 'i' && tolower(line[1]) == 'f' &&
+           (line[2] == '\0' || isspace(line[2]));
+}
+
+// End address is optional, and defaults to start address
+bool expect_address_range(const char *&line, Word &start, Word &end) {
+    if (!expect_address(line, start))
+        return false;
+    take_whitespace(line);
+    if (line[0] == '\0' || is_condition_keyword(line)) {
+        end = start;
+        return true;
+    }
+    if (!expect_address(line, end))
+        return false;
+    if (end < start) {
+        dprintfc_error("End address is before start address\n");
         return false;
     }
     return true;
 }
 
+// Optional `if CONDITION`, at end of command
+// `source` must have space for `MAX_DEBUGGER_COMMAND` characters
+bool take_condition(
+    const char *&line, Condition &condition, char *const source
+) {
+    take_whitespace(line);
+    condition.length = 0;
+    source[0] = '\0';
+    if (line[0] == '\0')
+        return true;
+    if (!is_condition_keyword(line)) {
+        dprintfc_error("Expected `if` and condition\n");
+        return false;
+    }
+    line += 2;
+    take_whitespace(line);
+    if (!compile_condition(stddbg, line, condition))
+        return false;
+    strcpy(source, line);
+    return true;
+}
+
 bool expect_integer(const char *&line, Word &value) {
     take_whitespace(line);
     InitialSignWord integer;
-    if (take_integer(line, integer) != 1) {
-        dprintfc("Expected integer argument\n");
+    if (take_integer(stddbg, line, integer) != 1) {
+        dprintfc_error("Expected integer argument\n");
         return false;
     }
     value = integer.value;
@@ -302,6 +696,396 @@ bool expect_integer(const char *&line, Word &value) {
     return true;
 }
 
+// Includes label and source line, if debug info is loaded
+void print_debugger_location(const Word address) {
+    dprintf_script("stop pc=0x%04hx\n", address);
+    if (debugger_quiet)
+        return;
+    char text[MAX_DISASSEMBLY];
+    format_instruction(
+        text, decode_cached(address, memory[address]), address, debug_info,
+        false
+    );
+    fprintf(stddbg, DEBUGGER_COLOR "PC: ");
+    print_symbolized_address(stddbg, debug_info, address);
+    fprintf(stddbg, "  %s\x1b[0m\n", text);
+    fflush(stddbg);
+}
+
+// Returns `false` if breakpoint was already set
+bool set_breakpoint(const Word addr, const bool is_set) {
+    if (!bitmap_set(breakpoints.bits, addr, is_set))
+        return false;
+    if (is_set) {
+        ++breakpoints.count;
+    } else {
+        --breakpoints.count;
+        set_breakpoint_condition(addr, nullptr, "");
+    }
+    return true;
+}
+
+BreakpointCondition *find_breakpoint_condition(const Word addr) {
+    // Few breakpoints have conditions, so a linear search is fine
+    for (size_t i = 0; i < breakpoints.conditions.size(); ++i) {
+        if (breakpoints.conditions[i].address == addr)
+            return &breakpoints.conditions[i];
+    }
+    return nullptr;
+}
+
+// Pass `nullptr` to make breakpoint unconditional
+// Returns `false` if breakpoint did not have a condition
+bool set_breakpoint_condition(
+    const Word addr,
+    const Condition *const condition,
+    const char *const source
+) {
+    BreakpointCondition *existing = find_breakpoint_condition(addr);
+    const bool had_condition = existing != nullptr;
+    if (condition == nullptr) {
+        if (existing != nullptr) {
+            *existing = breakpoints.conditions.back();
+            breakpoints.conditions.pop_back();
+        }
+        bitmap_set(breakpoints.conditional, addr, false);
+        return had_condition;
+    }
+    if (existing == nullptr) {
+        breakpoints.conditions.push_back({});
+        existing = &breakpoints.conditions.back();
+    }
+    existing->address = addr;
+    existing->condition = *condition;
+    strcpy(existing->source, source);
+    bitmap_set(breakpoints.conditional, addr, true);
+    return had_condition;
+}
+
+// Checked before every instruction while debugging
+inline bool is_breakpoint_hit(const Word addr) {
+    if (!bitmap_test(breakpoints.bits, addr))
+        return false;
+    if (!bitmap_test(breakpoints.conditional, addr))
+        return true;
+    return evaluate_condition(find_breakpoint_condition(addr)->condition);
+}
+
+// In order of address
+void print_breakpoints() {
+    if (breakpoints.count == 0) {
+        dprintfc("No breakpoints\n");
+        return;
+    }
+    for (size_t i = 0; i < MEMORY_SIZE / 64; ++i) {
+        // Only visit set bits
+        for (uint64_t bits = breakpoints.bits[i]; bits != 0;
+             bits &= bits - 1) {
+            const Word addr = i * 64 + __builtin_ctzll(bits);
+            const BreakpointCondition *const condition =
+                bitmap_test(breakpoints.conditional, addr)
+                    ? find_breakpoint_condition(addr)
+                    : nullptr;
+            if (debugger_quiet) {
+                dprintfc_always("0x%04hx", addr);
+                if (condition != nullptr)
+                    dprintfc_always(" if %s", condition->source);
+                dprintfc_always("\n");
+            } else {
+                fprintf(stddbg, DEBUGGER_COLOR "    ");
+                print_symbolized_address(stddbg, debug_info, addr);
+                if (condition != nullptr)
+                    fprintf(stddbg, " if %s", condition->source);
+                fprintf(stddbg, "\x1b[0m\n");
+            }
+        }
+    }
+}
+
+// Returns number of addresses which were changed
+size_t set_watchpoints(
+    AddressBitmap bitmap, const Word start, const Word end, const bool is_set
+) {
+    size_t changed = 0;
+    for (size_t addr = start; addr <= end; ++addr) {
+        if (bitmap_set(bitmap, addr, is_set))
+            ++changed;
+    }
+    if (is_set)
+        watchpoints.count += changed;
+    else
+        watchpoints.count -= changed;
+    return changed;
+}
+
+// Called by memory accesses of the program, only if any watchpoints are set
+inline void check_watchpoint(
+    const bool is_write,
+    const Word addr,
+    const Word old_value,
+    const Word new_value
+) {
+    if (watchpoints.triggered ||
+        !bitmap_test(is_write ? watchpoints.writes : watchpoints.reads, addr))
+        return;
+    watchpoints.triggered = true;
+    WatchpointHit &hit = watchpoints.hit;
+    hit.is_write = is_write;
+    // Already incremented
+    hit.program_counter = registers.program_counter - 1;
+    hit.address = addr;
+    hit.old_value = old_value;
+    hit.new_value = new_value;
+}
+
+// Newest condition of a range containing address of hit is used
+// Checked after the instruction which triggered the watchpoint
+bool is_watchpoint_hit() {
+    const WatchpointHit &hit = watchpoints.hit;
+    for (size_t i = watchpoints.conditions.size(); i > 0; --i) {
+        const WatchpointCondition &entry = watchpoints.conditions[i - 1];
+        if (entry.is_write == hit.is_write && hit.address >= entry.start &&
+            hit.address <= entry.end)
+            return evaluate_condition(entry.condition);
+    }
+    return true;
+}
+
+// Removes conditions of ranges which are entirely within `start` to `end`
+void remove_watchpoint_conditions(const Word start, const Word end) {
+    std::vector<WatchpointCondition> &conditions = watchpoints.conditions;
+    size_t kept = 0;
+    for (size_t i = 0; i < conditions.size(); ++i) {
+        if (conditions[i].start >= start && conditions[i].end <= end)
+            continue;
+        conditions[kept] = conditions[i];
+        ++kept;
+    }
+    conditions.resize(kept);
+}
+
+void add_watchpoint_condition(
+    const bool is_write,
+    const Word start,
+    const Word end,
+    const Condition &condition,
+    const char *const source
+) {
+    // Unconditional range only needs an entry to override older conditions
+    if (condition.length == 0) {
+        bool overlaps = false;
+        for (size_t i = 0; i < watchpoints.conditions.size(); ++i) {
+            const WatchpointCondition &entry = watchpoints.conditions[i];
+            if (entry.is_write == is_write && entry.start <= end &&
+                entry.end >= start)
+                overlaps = true;
+        }
+        if (!overlaps)
+            return;
+    }
+    watchpoints.conditions.push_back({});
+    WatchpointCondition &entry = watchpoints.conditions.back();
+    entry.is_write = is_write;
+    entry.start = start;
+    entry.end = end;
+    entry.condition = condition;
+    strcpy(entry.source, source);
+}
+
+void print_watchpoint_hit() {
+    const WatchpointHit &hit = watchpoints.hit;
+    dprintf_script(
+        "watch kind=%s addr=0x%04hx pc=0x%04hx old=0x%04hx new=0x%04hx\n",
+        hit.is_write ? "write" : "read",
+        hit.address,
+        hit.program_counter,
+        hit.old_value,
+        hit.new_value
+    );
+    if (debugger_quiet)
+        return;
+    fprintf(stddbg, DEBUGGER_COLOR "\n");
+    fprintf(stddbg, "Watchpoint: %s ", hit.is_write ? "write to" : "read of");
+    print_symbolized_address(stddbg, debug_info, hit.address);
+    fprintf(stddbg, "\n    by PC ");
+    print_symbolized_address(stddbg, debug_info, hit.program_counter);
+    if (hit.is_write) {
+        fprintf(
+            stddbg, "\n    0x%04hx -> 0x%04hx", hit.old_value, hit.new_value
+        );
+    } else {
+        fprintf(stddbg, "\n    value 0x%04hx", hit.old_value);
+    }
+    fprintf(stddbg, "\x1b[0m\n");
+    fflush(stddbg);
+}
+
+// Contiguous addresses with the same kinds of watchpoint are shown as a range
+void print_watchpoints() {
+    if (watchpoints.count == 0) {
+        dprintfc("No watchpoints\n");
+        return;
+    }
+    size_t addr = 0;
+    while (addr < MEMORY_SIZE) {
+        const bool is_read = bitmap_test(watchpoints.reads, addr);
+        const bool is_write = bitmap_test(watchpoints.writes, addr);
+        if (!is_read && !is_write) {
+            ++addr;
+            continue;
+        }
+        const size_t start = addr;
+        while (addr + 1 < MEMORY_SIZE &&
+               bitmap_test(watchpoints.reads, addr + 1) == is_read &&
+               bitmap_test(watchpoints.writes, addr + 1) == is_write)
+            ++addr;
+        const char *const kind = is_read && is_write ? "read, write"
+                                 : is_read           ? "read"
+                                                     : "write";
+        if (debugger_quiet) {
+            dprintfc_always("0x%04zx 0x%04zx %s\n", start, addr, kind);
+        } else {
+            fprintf(stddbg, DEBUGGER_COLOR "    ");
+            print_symbolized_address(stddbg, debug_info, start);
+            if (addr != start)
+                fprintf(stddbg, " - 0x%04zx", addr);
+            fprintf(stddbg, ": %s\x1b[0m\n", kind);
+        }
+        ++addr;
+    }
+
+    for (size_t i = 0; i < watchpoints.conditions.size(); ++i) {
+        const WatchpointCondition &entry = watchpoints.conditions[i];
+        if (entry.source[0] == '\0')
+            continue;
+        const char *const kind = entry.is_write ? "write" : "read";
+        if (debugger_quiet) {
+            dprintfc_always(
+                "0x%04hx 0x%04hx %s if %s\n",
+                entry.start,
+                entry.end,
+                kind,
+                entry.source
+            );
+        } else {
+            fprintf(
+                stddbg,
+                DEBUGGER_COLOR "    0x%04hx - 0x%04hx: %s if %s\x1b[0m\n",
+                entry.start,
+                entry.end,
+                kind,
+                entry.source
+            );
+        }
+    }
+}
+
+// Restore state from before the most recent instruction
+// Returns `false` if there is no recorded instruction to undo
+bool undo_instruction() {
+    if (undo_log.count == 0)
+        return false;
+    --undo_log.count;
+    --undo_log.next;
+    ++undo_log.redo_count;
+    --instruction_count;
+    const UndoEntry &entry =
+        undo_log.entries[undo_log.next & (UNDO_LOG_SIZE - 1)];
+
+    // Register still has the value which was read
+    if (entry.flags & UNDO_INPUT) {
+        const char input = registers.general_purpose[0] & BITMASK_LOW_8;
+        undo_log.unread_input.push_back(input);
+    }
+    if (entry.register_index != UNDO_NO_REGISTER)
+        registers.general_purpose[entry.register_index] = entry.register_value;
+    if (entry.flags & UNDO_MEMORY)
+        memory[entry.memory_address] = entry.memory_value;
+    if (entry.flags & UNDO_CALL)
+        --call_stack.depth;
+    if (entry.flags & UNDO_RETURN) {
+        if (call_stack.depth < MAX_CALL_STACK) {
+            call_stack.frames[call_stack.depth] = {
+                entry.memory_address, entry.memory_value
+            };
+        }
+        ++call_stack.depth;
+    }
+    registers.condition = static_cast<ConditionCode>(entry.flags & 0b111);
+    registers.program_counter = entry.program_counter;
+    return true;
+}
+
+// Undo until a breakpoint is reached, or a watched address is restored
+// Returns `false` if start of recorded history was reached
+bool undo_until_breakpoint() {
+    while (undo_log.count > 0) {
+        const UndoEntry &entry =
+            undo_log.entries[(undo_log.next - 1) & (UNDO_LOG_SIZE - 1)];
+        const bool is_watched =
+            (entry.flags & UNDO_MEMORY) &&
+            bitmap_test(watchpoints.writes, entry.memory_address);
+        undo_instruction();
+        if (is_watched || is_breakpoint_hit(registers.program_counter))
+            return true;
+    }
+    return false;
+}
+
+// Innermost first, starting at current instruction
+void print_backtrace() {
+    const size_t recorded = call_stack.depth < MAX_CALL_STACK
+                                ? call_stack.depth
+                                : MAX_CALL_STACK;
+    if (call_stack.depth > recorded) {
+        dprintfc(
+            "(%zu innermost frames were not recorded)\n",
+            call_stack.depth - recorded
+        );
+    }
+    for (size_t i = 0; i <= recorded; ++i) {
+        // Frame 0 is the current location, then each call site
+        const Word addr = i == 0 ? registers.program_counter
+                                 : call_stack.frames[recorded - i].call_site;
+        if (debugger_quiet) {
+            dprintfc_always("0x%04hx\n", addr);
+        } else {
+            fprintf(stddbg, DEBUGGER_COLOR "    #%-3zu ", i);
+            print_symbolized_address(stddbg, debug_info, addr);
+            fprintf(stddbg, "\x1b[0m\n");
+        }
+    }
+    if (call_stack.is_partial)
+        dprintfc("(Calls made before debugger tracked calls are not shown)\n");
+}
+
+// Labels are printed before their address
+// Program counter is marked with `>`, and breakpoints with `*`
+void print_disassembly(const Word start, const Word count) {
+    for (size_t addr = start; addr < start + count; ++addr) {
+        if (addr > MEMORY_USER_MAX)
+            break;
+        char text[MAX_DISASSEMBLY];
+        format_instruction(
+            text, decode_cached(addr, memory[addr]), addr, debug_info, false
+        );
+        if (debugger_quiet) {
+            dprintfc_always("0x%04zx %s\n", addr, text);
+            continue;
+        }
+        const Symbol *const symbol = find_symbol_at(debug_info, addr);
+        if (symbol != nullptr)
+            dprintfc("%s:\n", symbol->name);
+        dprintfc(
+            "%c%c 0x%04zx  %s\n",
+            addr == registers.program_counter ? '>' : ' ',
+            is_breakpoint(addr) ? '*' : ' ',
+            addr,
+            text
+        );
+    }
+}
+
 void print_integer_value(Word value) {
     // TODO(refactor): Combine functionality with `print_registers`
     // TODO(feat): Show ascii repr. if applicable
@@ -314,11 +1098,177 @@ void print_integer_value(Word value) {
     }
 }
 
+// Syntax of script arguments is checked before the program is loaded, so
+//     labels are not resolved and addresses are not bounds-checked here
+bool check_address_syntax(const char *&line) {
+    take_whitespace(line);
+    InitialSignWord integer;
+    const int result = take_integer(stderr, line, integer);
+    if (result == 0 && is_char_valid_identifier_start(line[0])) {
+        while (is_char_valid_in_identifier(tolower(line[0])))
+            ++line;
+        return true;
+    }
+    return result == 1 && !integer.is_signed;
+}
+
+bool check_address_range_syntax(const char *&line) {
+    if (!check_address_syntax(line))
+        return false;
+    take_whitespace(line);
+    if (line[0] == '\0' || is_condition_keyword(line))
+        return true;
+    return check_address_syntax(line);
+}
+
+// Condition is the rest of the line
+bool check_condition_keyword_syntax(const char *&line) {
+    take_whitespace(line);
+    if (line[0] == '\0')
+        return true;
+    if (!is_condition_keyword(line))
+        return false;
+    line += 2;
+    if (!check_condition_syntax(stderr, line))
+        return false;
+    line += strlen(line);
+    return true;
+}
+
+bool check_script_arguments(const DebuggerCommand command, const char *line) {
+    switch (command) {
+        case DebuggerCommand::MEMORY_GET:
+        case DebuggerCommand::BREAK_REMOVE:
+            if (!check_address_syntax(line))
+                return false;
+            break;
+        case DebuggerCommand::MEMORY_SET: {
+            if (!check_address_syntax(line))
+                return false;
+            take_whitespace(line);
+            InitialSignWord integer;
+            if (take_integer(stderr, line, integer) != 1)
+                return false;
+        }; break;
+        case DebuggerCommand::BREAK_ADD:
+            if (!check_address_syntax(line) ||
+                !check_condition_keyword_syntax(line))
+                return false;
+            break;
+        case DebuggerCommand::WATCH_WRITE:
+        case DebuggerCommand::WATCH_READ:
+            if (!check_address_range_syntax(line) ||
+                !check_condition_keyword_syntax(line))
+                return false;
+            break;
+        case DebuggerCommand::WATCH_REMOVE:
+            if (!check_address_range_syntax(line))
+                return false;
+            break;
+        case DebuggerCommand::LIST:
+            take_whitespace(line);
+            if (line[0] != '\0' && !check_address_syntax(line))
+                return false;
+            break;
+        default:
+            break;
+    }
+    take_whitespace(line);
+    return line[0] == '\0';
+}
+
+// Returns `false` if a command is invalid
+// Commands are separated by newlines or commas, like when read from terminal
+bool add_debugger_script_commands(const char *text) {
+    while (text[0] != '\0') {
+        while (isspace(text[0]) || text[0] == ',')
+            ++text;
+        // Comments continue to end of line, and may contain commas
+        if (text[0] == '#') {
+            while (text[0] != '\0' && text[0] != '\n')
+                ++text;
+            continue;
+        }
+        const char *const start = text;
+        while (text[0] != '\0' && text[0] != '\n' && text[0] != ',')
+            ++text;
+        size_t length = text - start;
+        while (length > 0 && isspace(start[length - 1]))
+            --length;
+        if (length == 0)
+            continue;
+
+        if (length >= MAX_DEBUGGER_COMMAND) {
+            fprintf(
+                stderr,
+                "Debugger command is too long: %.*s\n",
+                static_cast<int>(length),
+                start
+            );
+            return false;
+        }
+        Command line_buf;
+        memcpy(line_buf, start, length);
+        line_buf[length] = '\0';
+
+        const char *line = line_buf;
+        const DebuggerCommand command = take_command(line);
+        if (command == DebuggerCommand::UNKNOWN) {
+            fprintf(stderr, "Unknown debugger command: %s\n", line_buf);
+            return false;
+        }
+        if (!check_script_arguments(command, line)) {
+            fprintf(
+                stderr, "Invalid arguments for debugger command: %s\n", line_buf
+            );
+            return false;
+        }
+        debugger_script.commands.push_back({});
+        ScriptCommand &script_command = debugger_script.commands.back();
+        script_command.command = command;
+        strcpy(script_command.arguments, line);
+    }
+    debugger_script.is_enabled = true;
+    return true;
+}
+
+void load_debugger_script_file(const char *const filename, Error &error) {
+    FILE *const file = fopen(filename, "r");
+    if (file == nullptr) {
+        fprintf(stderr, "Could not open debugger script %s\n", filename);
+        error = Error::FILE;
+        return;
+    }
+    std::vector<char> text;
+    char buffer[4096];
+    for (size_t count; (count = fread(buffer, 1, sizeof(buffer), file)) > 0;)
+        text.insert(text.end(), buffer, buffer + count);
+    fclose(file);
+    text.push_back('\0');
+    if (!add_debugger_script_commands(text.data()))
+        error = Error::CLI;
+}
+
 DebuggerAction ask_debugger_command() {
+    if (debugger_script.is_enabled) {
+        // Continue without debugger once script has finished
+        if (debugger_script.next >= debugger_script.commands.size())
+            return DebuggerAction::STOP;
+        const ScriptCommand &script_command =
+            debugger_script.commands[debugger_script.next];
+        ++debugger_script.next;
+        return run_debugger_command(
+            script_command.command, script_command.arguments
+        );
+    }
+    if (is_remote_connected())
+        return ask_remote_command();
+
     const char *line = nullptr;
+    // Conditions are copied from the line after parsing, so keep it in scope
+    Command line_buf;
 
     while (true) {
-        Command line_buf;
         line = line_buf;
         // On EOF, continue without debugger
         if (!read_line(line_buf))
@@ -328,7 +1278,12 @@ DebuggerAction ask_debugger_command() {
     }
 
     DebuggerCommand command = take_command(line);
+    return run_debugger_command(command, line);
+}
 
+DebuggerAction run_debugger_command(
+    const DebuggerCommand command, const char *line
+) {
     // TODO(feat): Check for trailing operands
 
     switch (command) {
@@ -336,6 +1291,18 @@ DebuggerAction ask_debugger_command() {
             if (!debugger_quiet) {
                 dprintf(DEBUGGER_COLOR);
                 print_registers(stddbg);
+            } else {
+                dprintfc_always(
+                    "pc=0x%04hx cc=%c",
+                    registers.program_counter,
+                    condition_char(registers.condition)
+                );
+                for (int reg = 0; reg < GP_REGISTER_COUNT; ++reg) {
+                    dprintfc_always(
+                        " r%d=0x%04hx", reg, registers.general_purpose[reg]
+                    );
+                }
+                dprintfc_always("\n");
             }
         }; break;
         case DebuggerCommand::MEMORY_GET: {
@@ -355,9 +1322,148 @@ DebuggerAction ask_debugger_command() {
             memory[addr] = value;
             dprintfc("Modified value at address 0x%04hx\n", addr);
         }; break;
+        case DebuggerCommand::BREAK_ADD: {
+            Word addr;
+            if (!expect_address(line, addr))
+                return DebuggerAction::NONE;
+            Condition condition;
+            char source[MAX_DEBUGGER_COMMAND];
+            if (!take_condition(line, condition, source))
+                return DebuggerAction::NONE;
+            const bool is_new = set_breakpoint(addr, true);
+            const bool had_condition = set_breakpoint_condition(
+                addr, condition.length > 0 ? &condition : nullptr, source
+            );
+            if (is_new) {
+                dprintfc("Added breakpoint at 0x%04hx\n", addr);
+            } else if (condition.length > 0) {
+                dprintfc("Set condition of breakpoint at 0x%04hx\n", addr);
+            } else if (had_condition) {
+                dprintfc("Removed condition of breakpoint at 0x%04hx\n", addr);
+            } else {
+                dprintfc("Breakpoint is already set at 0x%04hx\n", addr);
+            }
+        }; break;
+        case DebuggerCommand::BREAK_REMOVE: {
+            Word addr;
+            if (!expect_address(line, addr))
+                return DebuggerAction::NONE;
+            if (set_breakpoint(addr, false)) {
+                dprintfc("Removed breakpoint at 0x%04hx\n", addr);
+            } else {
+                dprintfc("No breakpoint is set at 0x%04hx\n", addr);
+            }
+        }; break;
+        case DebuggerCommand::BREAK_LIST:
+            print_breakpoints();
+            break;
+        case DebuggerCommand::WATCH_WRITE:
+        case DebuggerCommand::WATCH_READ: {
+            Word start, end;
+            if (!expect_address_range(line, start, end))
+                return DebuggerAction::NONE;
+            Condition condition;
+            char source[MAX_DEBUGGER_COMMAND];
+            if (!take_condition(line, condition, source))
+                return DebuggerAction::NONE;
+            const bool is_write = command == DebuggerCommand::WATCH_WRITE;
+            set_watchpoints(
+                is_write ? watchpoints.writes : watchpoints.reads,
+                start,
+                end,
+                true
+            );
+            add_watchpoint_condition(is_write, start, end, condition, source);
+            dprintfc(
+                "Watching %s of 0x%04hx-0x%04hx\n",
+                is_write ? "writes" : "reads",
+                start,
+                end
+            );
+        }; break;
+        case DebuggerCommand::WATCH_REMOVE: {
+            Word start, end;
+            if (!expect_address_range(line, start, end))
+                return DebuggerAction::NONE;
+            const size_t removed =
+                set_watchpoints(watchpoints.reads, start, end, false) +
+                set_watchpoints(watchpoints.writes, start, end, false);
+            remove_watchpoint_conditions(start, end);
+            if (removed > 0) {
+                dprintfc(
+                    "Removed watchpoints in 0x%04hx-0x%04hx\n", start, end
+                );
+            } else {
+                dprintfc(
+                    "No watchpoints are set in 0x%04hx-0x%04hx\n", start, end
+                );
+            }
+        }; break;
+        case DebuggerCommand::WATCH_LIST:
+            print_watchpoints();
+            break;
+        case DebuggerCommand::BACKTRACE:
+            enable_call_stack();
+            print_backtrace();
+            break;
+        case DebuggerCommand::LIST: {
+            Word addr = registers.program_counter;
+            take_whitespace(line);
+            if (line[0] != '\0' && !expect_address(line, addr))
+                return DebuggerAction::NONE;
+            print_disassembly(addr, DEBUGGER_LIST_COUNT);
+        }; break;
+        case DebuggerCommand::RECORD:
+            if (undo_log.is_enabled) {
+                dprintfc("Instructions are already recorded\n");
+                break;
+            }
+            undo_log.is_enabled = true;
+            dprintfc("Recording instructions, so they can be undone\n");
+            break;
+        case DebuggerCommand::REVERSE_STEP:
+            if (!undo_log.is_enabled && undo_log.count == 0) {
+                dprintfc_error(
+                    "Instructions are not recorded (use `record`)\n"
+                );
+                break;
+            }
+            if (!undo_instruction()) {
+                dprintfc_error("No earlier instruction was recorded\n");
+                break;
+            }
+            print_debugger_location(registers.program_counter);
+            break;
+        case DebuggerCommand::REVERSE_CONTINUE:
+            if (!undo_log.is_enabled && undo_log.count == 0) {
+                dprintfc_error(
+                    "Instructions are not recorded (use `record`)\n"
+                );
+                break;
+            }
+            if (undo_until_breakpoint()) {
+                dprintfc("Breakpoint reached. Suspending reverse execution.\n");
+            } else {
+                dprintfc("Reached start of recorded history.\n");
+            }
+            print_debugger_location(registers.program_counter);
+            break;
         case DebuggerCommand::STEP:
             return DebuggerAction::STEP;
             break;
+        case DebuggerCommand::NEXT:
+            enable_call_stack();
+            return DebuggerAction::NEXT;
+            break;
+        case DebuggerCommand::FINISH:
+            enable_call_stack();
+            // Subroutine may have been called before calls were tracked
+            if (call_stack.depth == 0 && !call_stack.is_partial) {
+                dprintfc_error("Not in a subroutine\n");
+                return DebuggerAction::NONE;
+            }
+            return DebuggerAction::FINISH;
+            break;
         case DebuggerCommand::CONTINUE:
             return DebuggerAction::CONTINUE;
             break;
@@ -367,13 +1473,34 @@ DebuggerAction ask_debugger_command() {
         case DebuggerCommand::STOP:
             return DebuggerAction::STOP;
         default:
+            if (debugger_script.is_enabled) {
+                dprintfc_error("Unknown command\n");
+                break;
+            }
             dprintfc(
                 "    h      Print usage\n"
                 "    r      Print registers\n"
                 "    s      Execute next instruction\n"
+                "    n      Execute next instruction, stepping over "
+                "subroutines\n"
+                "    fin    Continue until current subroutine returns\n"
+                "    bt     Print subroutine call stack\n"
+                "    record Record instructions from here, so they can be "
+                "undone\n"
+                "    rs     Undo last instruction (output is not undone)\n"
+                "    rc     Undo instructions until breakpoint\n"
                 "    c      Continue execution until breakpoint or HALT\n"
                 "    mg     Print value at memory address\n"
                 "    ms     Set value at memory location\n"
+                "    b      Add breakpoint at address or label\n"
+                "           (ADDR [if COND])\n"
+                "    bd     Remove breakpoint at address or label\n"
+                "    bl     List breakpoints\n"
+                "    w      Watch writes to address or range\n"
+                "           (START [END] [if COND])\n"
+                "    wr     Watch reads of address or range\n"
+                "    wd     Remove watchpoints in address or range\n"
+                "    wl     List watchpoints\n"
                 /* "    rg     Print value of a register\n" */
                 /* "    rs     Set value of a register\n" */
                 "    q      Quit all execution\n"
@@ -388,11 +1515,33 @@ DebuggerAction ask_debugger_command() {
 void run_all_debugger_commands(
     bool &do_halt, bool &do_prompt, bool &do_debugger
 ) {
+    // Cancel `next` or `finish` which was interrupted by a breakpoint
+    call_stack.stop_depth = NO_STOP_DEPTH;
+    call_stack.returned = false;
+
     while (true) {
         switch (ask_debugger_command()) {
             case DebuggerAction::STEP:
                 return;
 
+            case DebuggerAction::NEXT: {
+                const Word instr = memory[registers.program_counter];
+                const Opcode opcode = static_cast<Opcode>(instr >> 12);
+                // Otherwise, same as step
+                if (opcode == Opcode::JSR_JSRR) {
+                    call_stack.stop_depth = call_stack.depth;
+                    do_prompt = false;
+                }
+                return;
+            }
+
+            case DebuggerAction::FINISH:
+                call_stack.stop_depth = call_stack.depth == 0
+                                            ? OUTER_STOP_DEPTH
+                                            : call_stack.depth - 1;
+                do_prompt = false;
+                return;
+
             case DebuggerAction::CONTINUE:
                 do_prompt = false;
                 return;
@@ -403,6 +1552,10 @@ void run_all_debugger_commands(
 
             case DebuggerAction::STOP:
                 do_debugger = false;
+                // Nothing can suspend execution now
+                watchpoints.count = 0;
+                call_stack.is_enabled = is_call_stack_required();
+                undo_log.is_enabled = false;
                 return;
 
             case DebuggerAction::NONE:
@@ -0,0 +1,379 @@
+#ifndef DEBUGINFO_CPP
+#define DEBUGINFO_CPP
+
+#include <cstdio>   // FILE, fopen, etc
+#include <cstdlib>  // qsort
+#include <cstring>  // strcasecmp, strcpy
+#include <vector>   // std::vector
+
+#include "bytes.cpp"
+#include "error.hpp"
+#include "slice.cpp"
+#include "token.cpp"
+#include "types.hpp"
+
+using std::vector;
+
+// Symbols and address-to-line table of an assembled program
+// Written next to each object file (`foo.obj` -> `foo.dbg`), and read with it
+//     if present. Kept in memory when assembling and executing in one step.
+
+#define DEBUG_INFO_EXTENSION "dbg"
+#define DEBUG_INFO_MAGIC 0x4c41'4442  // "LADB"
+#define DEBUG_INFO_VERSION 2
+
+typedef struct Symbol {
+    LabelString name;
+    Word address;
+} Symbol;
+
+// What the words of a line are
+enum class LineKind {
+    CODE,      // Instruction
+    DATA,      // `.FILL` or `.STRINGZ`
+    RESERVED,  // `.BLKW`, or no source
+};
+
+// Maps `address`, and all following addresses up to the next entry, to a line
+typedef struct LineEntry {
+    Word address;
+    uint32_t line;  // 0 for addresses with no source (after end of program)
+    LineKind kind;
+} LineEntry;
+
+typedef struct DebugInfo {
+    vector<Symbol> symbols;            // Sorted by address
+    vector<uint16_t> symbols_by_name;  // Indexes of `symbols`, sorted by name
+    vector<LineEntry> lines;           // Sorted by address
+} DebugInfo;
+
+// Of the program currently in memory. Empty if none is available
+static DebugInfo debug_info;
+
+void add_debug_symbol(
+    DebugInfo &info, const char *const name, const Word address
+);
+void add_debug_line(
+    DebugInfo &info,
+    const Word address,
+    const uint32_t line,
+    const LineKind kind
+);
+void sort_debug_info(DebugInfo &info);
+
+const Symbol *find_symbol_by_name(
+    const DebugInfo &info, const StringSlice &name
+);
+const Symbol *find_symbol_before(const DebugInfo &info, const Word address);
+uint32_t find_source_line(const DebugInfo &info, const Word address);
+void print_symbolized_address(
+    FILE *const file, const DebugInfo &info, const Word address
+);
+
+bool write_debug_info(FILE *const file, const DebugInfo &info);
+bool read_debug_info(FILE *const file, DebugInfo &info);
+void write_debug_info_file(
+    FILE *const diagnostics,
+    const char *const obj_filename,
+    const DebugInfo &info,
+    Error &error
+);
+void read_debug_info_file(const char *const obj_filename, DebugInfo &info);
+void debug_info_filename(char *const dest, const char *const obj_filename);
+void replace_filename_extension(
+    char *const dest, const char *const filename, const char *const extension
+);
+
+void add_debug_symbol(
+    DebugInfo &info, const char *const name, const Word address
+) {
+    info.symbols.push_back({});
+    Symbol &symbol = info.symbols.back();
+    strcpy(symbol.name, name);  // Length has already been checked
+    symbol.address = address;
+}
+
+void add_debug_line(
+    DebugInfo &info,
+    const Word address,
+    const uint32_t line,
+    const LineKind kind
+) {
+    info.lines.push_back({address, line, kind});
+}
+
+int compare_symbols_by_address(const void *const a, const void *const b) {
+    const Word a_address = static_cast<const Symbol *>(a)->address;
+    const Word b_address = static_cast<const Symbol *>(b)->address;
+    return (a_address > b_address) - (a_address < b_address);
+}
+
+int compare_symbols_by_name(const void *const a, const void *const b) {
+    return strcasecmp(
+        (*static_cast<const Symbol *const *>(a))->name,
+        (*static_cast<const Symbol *const *>(b))->name
+    );
+}
+
+int compare_lines_by_address(const void *const a, const void *const b) {
+    const LineEntry &a_entry = *static_cast<const LineEntry *>(a);
+    const LineEntry &b_entry = *static_cast<const LineEntry *>(b);
+    if (a_entry.address != b_entry.address)
+        return (a_entry.address > b_entry.address) ? 1 : -1;
+    // End of one block of code comes before start of another at same address
+    return (a_entry.line > b_entry.line) - (a_entry.line < b_entry.line);
+}
+
+// Must be called after adding all symbols and lines, before any lookups
+// Not needed after `read_debug_info`, as the file is already sorted
+void sort_debug_info(DebugInfo &info) {
+    qsort(
+        info.symbols.data(),
+        info.symbols.size(),
+        sizeof(Symbol),
+        compare_symbols_by_address
+    );
+    qsort(
+        info.lines.data(),
+        info.lines.size(),
+        sizeof(LineEntry),
+        compare_lines_by_address
+    );
+
+    vector<const Symbol *> by_name(info.symbols.size());
+    for (size_t i = 0; i < by_name.size(); ++i)
+        by_name[i] = &info.symbols[i];
+    qsort(
+        by_name.data(),
+        by_name.size(),
+        sizeof(const Symbol *),
+        compare_symbols_by_name
+    );
+    info.symbols_by_name.resize(by_name.size());
+    for (size_t i = 0; i < by_name.size(); ++i)
+        info.symbols_by_name[i] = by_name[i] - info.symbols.data();
+}
+
+// Case-insensitive, like labels in assembly
+const Symbol *find_symbol_by_name(
+    const DebugInfo &info, const StringSlice &name
+) {
+    if (name.length >= MAX_LABEL)
+        return nullptr;
+    LabelString target;
+    copy_string_slice_to_string(target, name);
+
+    size_t low = 0;
+    size_t high = info.symbols_by_name.size();
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        const Symbol &symbol = info.symbols[info.symbols_by_name[middle]];
+        const int order = strcasecmp(symbol.name, target);
+        if (order == 0)
+            return &symbol;
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return nullptr;
+}
+
+// Closest symbol at or before `address`, or `nullptr` if there is none
+const Symbol *find_symbol_before(const DebugInfo &info, const Word address) {
+    size_t low = 0;
+    size_t high = info.symbols.size();
+    // Find first symbol after address
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (info.symbols[middle].address <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == 0)
+        return nullptr;
+    return &info.symbols[low - 1];
+}
+
+// Returns 0 if address does not correspond to a line
+uint32_t find_source_line(const DebugInfo &info, const Word address) {
+    size_t low = 0;
+    size_t high = info.lines.size();
+    // Find first entry after address
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (info.lines[middle].address <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == 0)
+        return 0;
+    return info.lines[low - 1].line;
+}
+
+// Prints `0x3004 <LOOP+2> (line 12)`, omitting what is not known
+void print_symbolized_address(
+    FILE *const file, const DebugInfo &info, const Word address
+) {
+    fprintf(file, "0x%04hx", address);
+    const Symbol *const symbol = find_symbol_before(info, address);
+    if (symbol != nullptr) {
+        if (symbol->address == address)
+            fprintf(file, " <%s>", symbol->name);
+        else
+            fprintf(file, " <%s+%d>", symbol->name, address - symbol->address);
+    }
+    const uint32_t line = find_source_line(info, address);
+    if (line != 0)
+        fprintf(file, " (line %u)", line);
+}
+
+// File format (all integers big-endian):
+//     u32     magic
+//     u32     version
+//     u32     symbol count
+//     u32     line entry count
+//     symbols, sorted by address:
+//         u16     address
+//         u8      name length
+//         u8[]    name (no NUL)
+//     u16[]   symbol indexes, sorted by name
+//     line entries, sorted by address:
+//         u16     address
+//         u32     line
+//         u8      kind (`LineKind`)
+bool write_debug_info(FILE *const file, const DebugInfo &info) {
+    bool ok = write_u32(file, DEBUG_INFO_MAGIC) &&
+              write_u32(file, DEBUG_INFO_VERSION) &&
+              write_u32(file, info.symbols.size()) &&
+              write_u32(file, info.lines.size());
+
+    for (size_t i = 0; ok && i < info.symbols.size(); ++i) {
+        const Symbol &symbol = info.symbols[i];
+        const uint8_t length = strlen(symbol.name);
+        ok = write_u16(file, symbol.address) && write_u8(file, length) &&
+             fwrite(symbol.name, 1, length, file) == length;
+    }
+    for (size_t i = 0; ok && i < info.symbols_by_name.size(); ++i)
+        ok = write_u16(file, info.symbols_by_name[i]);
+    for (size_t i = 0; ok && i < info.lines.size(); ++i) {
+        ok = write_u16(file, info.lines[i].address) &&
+             write_u32(file, info.lines[i].line) &&
+             write_u8(file, static_cast<uint8_t>(info.lines[i].kind));
+    }
+    return ok;
+}
+
+// Clears `info` on failure
+bool read_debug_info(FILE *const file, DebugInfo &info) {
+    uint32_t magic, version, symbol_count, line_count;
+    bool ok = read_u32(file, magic) && magic == DEBUG_INFO_MAGIC &&
+              read_u32(file, version) && version == DEBUG_INFO_VERSION &&
+              read_u32(file, symbol_count) && symbol_count <= MEMORY_SIZE &&
+              read_u32(file, line_count) && line_count <= 2 * MEMORY_SIZE;
+
+    if (ok) {
+        info.symbols.resize(symbol_count);
+        info.symbols_by_name.resize(symbol_count);
+        info.lines.resize(line_count);
+    }
+
+    for (size_t i = 0; ok && i < symbol_count; ++i) {
+        Symbol &symbol = info.symbols[i];
+        uint8_t length;
+        ok = read_u16(file, symbol.address) && read_u8(file, length) &&
+             length < MAX_LABEL &&
+             fread(symbol.name, 1, length, file) == length;
+        if (ok)
+            symbol.name[length] = '\0';
+    }
+    for (size_t i = 0; ok && i < symbol_count; ++i) {
+        ok = read_u16(file, info.symbols_by_name[i]) &&
+             info.symbols_by_name[i] < symbol_count;
+    }
+    for (size_t i = 0; ok && i < line_count; ++i) {
+        uint8_t kind;
+        ok = read_u16(file, info.lines[i].address) &&
+             read_u32(file, info.lines[i].line) && read_u8(file, kind) &&
+             kind <= static_cast<uint8_t>(LineKind::RESERVED);
+        info.lines[i].kind = static_cast<LineKind>(kind);
+    }
+
+    if (!ok) {
+        info.symbols.clear();
+        info.symbols_by_name.clear();
+        info.lines.clear();
+    }
+    return ok;
+}
+
+void write_debug_info_file(
+    FILE *const diagnostics,
+    const char *const obj_filename,
+    const DebugInfo &info,
+    Error &error
+) {
+    char filename[FILENAME_MAX];
+    debug_info_filename(filename, obj_filename);
+
+    FILE *const file = fopen(filename, "wb");
+    if (file == nullptr) {
+        fprintf(
+            diagnostics,
+            "Failed to open debug info file for writing: %s\n",
+            filename
+        );
+        SET_ERROR(error, FILE);
+        return;
+    }
+    if (!write_debug_info(file, info))
+        SET_ERROR(error, FILE);
+    fclose(file);
+}
+
+// Debug info is optional, so a missing or invalid file is ignored
+void read_debug_info_file(const char *const obj_filename, DebugInfo &info) {
+    char filename[FILENAME_MAX];
+    debug_info_filename(filename, obj_filename);
+
+    FILE *const file = fopen(filename, "rb");
+    if (file == nullptr)
+        return;
+    if (!read_debug_info(file, info))
+        fprintf(stderr, "Ignoring invalid debug info file: %s\n", filename);
+    fclose(file);
+}
+
+void debug_info_filename(char *const dest, const char *const obj_filename) {
+    replace_filename_extension(dest, obj_filename, DEBUG_INFO_EXTENSION);
+}
+
+// Replace extension of filename (if any)
+void replace_filename_extension(
+    char *const dest, const char *const filename, const char *const extension
+) {
+    size_t period = 0;  // Index of `.`, or 0 if none
+    size_t i = 0;
+    for (; i < FILENAME_MAX - 1; ++i) {
+        const char ch = filename[i];
+        if (ch == '\0')
+            break;
+        dest[i] = ch;
+        if (ch == '.' && i > 0)
+            period = i;
+        // Directory names may contain periods too
+        if (ch == '/')
+            period = 0;
+    }
+    if (period == 0)
+        period = i;
+    const size_t size = strlen(extension) + 1;
+    if (period + size >= FILENAME_MAX)
+        period = FILENAME_MAX - 1 - size;
+    dest[period] = '.';
+    strcpy(dest + period + 1, extension);
+}
+
+#endif
@@ -0,0 +1,512 @@
+#ifndef DISASSEMBLE_CPP
+#define DISASSEMBLE_CPP
+
+#include <cstdint>  // uint8_t
+#include <cstdio>   // FILE, snprintf, etc
+#include <vector>   // std::vector
+
+#include "bitmap.cpp"
+#include "bitmasks.hpp"
+#include "debuginfo.cpp"
+#include "error.hpp"
+#include "link.cpp"
+#include "token.cpp"
+#include "types.hpp"
+
+using std::vector;
+
+#define MAX_DISASSEMBLY 48  // Includes '\0'
+
+enum class DecodedOperandKind : uint8_t {
+    REGISTER,
+    IMMEDIATE,    // Signed
+    TARGET,       // Address of PC-relative operand
+    TRAP_VECTOR,  // Only for vectors without their own instruction
+};
+
+typedef struct DecodedOperand {
+    DecodedOperandKind kind;
+    Word value;
+} DecodedOperand;
+
+// Any word which would not be assembled to the same value is invalid, so
+//     valid instructions can always be printed as source
+typedef struct DecodedInstruction {
+    Word word;          // Which was decoded
+    bool is_decoded;    // Only used by cache
+    bool is_valid;      // Otherwise, printed as `.FILL`
+    Instruction instruction;
+    uint8_t operand_count;
+    DecodedOperand operands[3];
+} DecodedInstruction;
+
+// Shared by the debugger and `--disassemble`, so each address is only decoded
+//     again if the word there changes
+static DecodedInstruction decode_cache[MEMORY_SIZE];
+
+void decode_instruction(
+    const Word address, const Word word, DecodedInstruction &decoded
+);
+const DecodedInstruction &decode_cached(const Word address, const Word word);
+void format_instruction(
+    char *const buffer,
+    const DecodedInstruction &decoded,
+    const Word address,
+    const DebugInfo &labels,
+    const bool is_source
+);
+const Symbol *find_symbol_at(const DebugInfo &info, const Word address);
+
+void disassemble_file(
+    FILE *const diagnostics,
+    const char *const obj_filename,
+    const char *const out_filename,
+    Error &error
+);
+// Used by `disassemble_file`
+void recover_labels(const vector<Word> &words, DebugInfo &labels);
+void print_segment_source(
+    FILE *const file,
+    const Word origin,
+    const Word *const words,
+    const Word size,
+    const DebugInfo &labels
+);
+size_t string_length_at(
+    const Word *const words,
+    const size_t start,
+    const size_t size,
+    const Word origin,
+    const DebugInfo &labels
+);
+
+// Used by `decode_instruction`
+#define add_operand(_kind, _value)                                     \
+    {                                                                  \
+        DecodedOperand &operand = decoded.operands[decoded.operand_count]; \
+        operand.kind = (_kind);                                        \
+        operand.value = static_cast<Word>(_value);                     \
+        ++decoded.operand_count;                                       \
+    }
+#define sext(_value, _size) \
+    static_cast<Word>(((_value) ^ _sign_bit(_size)) - _sign_bit(_size))
+#define _sign_bit(_size) (1U << ((_size) - 1))
+
+// `address` is only used for PC-relative operands
+void decode_instruction(
+    const Word address, const Word word, DecodedInstruction &decoded
+) {
+    decoded.word = word;
+    decoded.is_decoded = true;
+    decoded.is_valid = false;
+    decoded.operand_count = 0;
+
+    const Word next = address + 1;
+    const Register reg_a = bits_9_11(word);
+    const Register reg_b = bits_6_8(word);
+
+    switch (static_cast<Opcode>(bits_12_15(word))) {
+        case Opcode::ADD:
+        case Opcode::AND:
+            decoded.instruction =
+                bits_12_15(word) == static_cast<Word>(Opcode::ADD)
+                    ? Instruction::ADD
+                    : Instruction::AND;
+            add_operand(DecodedOperandKind::REGISTER, reg_a);
+            add_operand(DecodedOperandKind::REGISTER, reg_b);
+            if (bit_5(word)) {
+                add_operand(
+                    DecodedOperandKind::IMMEDIATE,
+                    sext(word & BITMASK_LOW_5, 5)
+                );
+            } else if (bits_3_4(word) == 0) {
+                add_operand(DecodedOperandKind::REGISTER, bits_0_2(word));
+            } else {
+                return;
+            }
+            break;
+
+        case Opcode::NOT:
+            if ((word & BITMASK_LOW_6) != BITMASK_LOW_6)
+                return;
+            decoded.instruction = Instruction::NOT;
+            add_operand(DecodedOperandKind::REGISTER, reg_a);
+            add_operand(DecodedOperandKind::REGISTER, reg_b);
+            break;
+
+        case Opcode::BR: {
+            // Matches `get_branch_condition_code`
+            static const Instruction BRANCHES[] = {
+                Instruction::BR,  // Never taken, so not valid
+                Instruction::BRP,
+                Instruction::BRZ,
+                Instruction::BRZP,
+                Instruction::BRN,
+                Instruction::BRNP,
+                Instruction::BRNZ,
+                Instruction::BR,
+            };
+            if (reg_a == 0)
+                return;
+            decoded.instruction = BRANCHES[reg_a];
+            add_operand(
+                DecodedOperandKind::TARGET,
+                next + sext(word & BITMASK_LOW_9, 9)
+            );
+        }; break;
+
+        case Opcode::JMP_RET:
+            if ((word & 0x0e3f) != 0)
+                return;
+            if (reg_b == 7) {
+                decoded.instruction = Instruction::RET;
+            } else {
+                decoded.instruction = Instruction::JMP;
+                add_operand(DecodedOperandKind::REGISTER, reg_b);
+            }
+            break;
+
+        case Opcode::JSR_JSRR:
+            if (bit_11(word)) {
+                decoded.instruction = Instruction::JSR;
+                add_operand(
+                    DecodedOperandKind::TARGET,
+                    next + sext(word & BITMASK_LOW_11, 11)
+                );
+            } else {
+                if ((word & 0x063f) != 0)
+                    return;
+                decoded.instruction = Instruction::JSRR;
+                add_operand(DecodedOperandKind::REGISTER, reg_b);
+            }
+            break;
+
+        case Opcode::LD:
+        case Opcode::ST:
+        case Opcode::LDI:
+        case Opcode::STI:
+        case Opcode::LEA: {
+            switch (static_cast<Opcode>(bits_12_15(word))) {
+                case Opcode::LD:
+                    decoded.instruction = Instruction::LD;
+                    break;
+                case Opcode::ST:
+                    decoded.instruction = Instruction::ST;
+                    break;
+                case Opcode::LDI:
+                    decoded.instruction = Instruction::LDI;
+                    break;
+                case Opcode::STI:
+                    decoded.instruction = Instruction::STI;
+                    break;
+                default:
+                    decoded.instruction = Instruction::LEA;
+                    break;
+            }
+            add_operand(DecodedOperandKind::REGISTER, reg_a);
+            add_operand(
+                DecodedOperandKind::TARGET,
+                next + sext(word & BITMASK_LOW_9, 9)
+            );
+        }; break;
+
+        case Opcode::LDR:
+        case Opcode::STR:
+            decoded.instruction =
+                bits_12_15(word) == static_cast<Word>(Opcode::LDR)
+                    ? Instruction::LDR
+                    : Instruction::STR;
+            add_operand(DecodedOperandKind::REGISTER, reg_a);
+            add_operand(DecodedOperandKind::REGISTER, reg_b);
+            add_operand(
+                DecodedOperandKind::IMMEDIATE, sext(word & BITMASK_LOW_6, 6)
+            );
+            break;
+
+        case Opcode::TRAP: {
+            if ((word & 0x0f00) != 0)
+                return;
+            const Word vector = word & BITMASK_LOW_8;
+            switch (static_cast<TrapVector>(vector)) {
+                case TrapVector::GETC:
+                    decoded.instruction = Instruction::GETC;
+                    break;
+                case TrapVector::OUT:
+                    decoded.instruction = Instruction::OUT;
+                    break;
+                case TrapVector::PUTS:
+                    decoded.instruction = Instruction::PUTS;
+                    break;
+                case TrapVector::IN:
+                    decoded.instruction = Instruction::IN;
+                    break;
+                case TrapVector::PUTSP:
+                    decoded.instruction = Instruction::PUTSP;
+                    break;
+                case TrapVector::HALT:
+                    decoded.instruction = Instruction::HALT;
+                    break;
+                case TrapVector::REG:
+                    decoded.instruction = Instruction::REG;
+                    break;
+                case TrapVector::DEBUG:
+                    decoded.instruction = Instruction::DEBUG;
+                    break;
+                default:
+                    decoded.instruction = Instruction::TRAP;
+                    add_operand(DecodedOperandKind::TRAP_VECTOR, vector);
+                    break;
+            }
+        }; break;
+
+        case Opcode::RTI:
+            if ((word & 0x0fff) != 0)
+                return;
+            decoded.instruction = Instruction::RTI;
+            break;
+
+        case Opcode::RESERVED:
+            return;
+    }
+    decoded.is_valid = true;
+}
+
+#undef add_operand
+#undef sext
+#undef _sign_bit
+
+// Decoded again only if word has changed (such as by self-modifying code)
+const DecodedInstruction &decode_cached(const Word address, const Word word) {
+    DecodedInstruction &decoded = decode_cache[address];
+    if (!decoded.is_decoded || decoded.word != word)
+        decode_instruction(address, word, decoded);
+    return decoded;
+}
+
+// Target is printed as a label at that address, if there is one
+// Otherwise, as an address, or an offset if `is_source` (so output can be
+//     assembled again)
+// `buffer` must have space for `MAX_DISASSEMBLY` characters
+void format_instruction(
+    char *const buffer,
+    const DecodedInstruction &decoded,
+    const Word address,
+    const DebugInfo &labels,
+    const bool is_source
+) {
+    if (!decoded.is_valid) {
+        snprintf(buffer, MAX_DISASSEMBLY, ".FILL x%04hx", decoded.word);
+        return;
+    }
+    const char *const name = instruction_to_string(decoded.instruction);
+    size_t length = snprintf(buffer, MAX_DISASSEMBLY, "%s", name);
+    for (uint8_t i = 0; i < decoded.operand_count; ++i) {
+        const DecodedOperand &operand = decoded.operands[i];
+        char *const end = buffer + length;
+        const size_t space = MAX_DISASSEMBLY - length;
+        const char *const separator = i == 0 ? " " : ", ";
+        switch (operand.kind) {
+            case DecodedOperandKind::REGISTER:
+                length +=
+                    snprintf(end, space, "%sR%hu", separator, operand.value);
+                break;
+            case DecodedOperandKind::IMMEDIATE:
+                length += snprintf(
+                    end,
+                    space,
+                    "%s#%d",
+                    separator,
+                    static_cast<SignedWord>(operand.value)
+                );
+                break;
+            case DecodedOperandKind::TARGET: {
+                const Symbol *const symbol =
+                    find_symbol_at(labels, operand.value);
+                if (symbol != nullptr) {
+                    length +=
+                        snprintf(end, space, "%s%s", separator, symbol->name);
+                } else if (!is_source) {
+                    length += snprintf(
+                        end, space, "%s0x%04hx", separator, operand.value
+                    );
+                } else {
+                    length += snprintf(
+                        end,
+                        space,
+                        "%s#%d",
+                        separator,
+                        static_cast<SignedWord>(operand.value - address - 1)
+                    );
+                }
+            }; break;
+            case DecodedOperandKind::TRAP_VECTOR:
+                length +=
+                    snprintf(end, space, "%sx%02hx", separator, operand.value);
+                break;
+        }
+    }
+}
+
+// Label defined at exactly `address`, or `nullptr`
+const Symbol *find_symbol_at(const DebugInfo &info, const Word address) {
+    const Symbol *const symbol = find_symbol_before(info, address);
+    if (symbol == nullptr || symbol->address != address)
+        return nullptr;
+    return symbol;
+}
+
+// Source is written to `out_filename`, or stdout if it is empty
+// Labels are read from debug info, if present, and created for any other
+//     address in the program which an instruction refers to
+void disassemble_file(
+    FILE *const diagnostics,
+    const char *const obj_filename,
+    const char *const out_filename,
+    Error &error
+) {
+    vector<Word> words;
+    LinkInfo link_info;
+    read_obj_file_to_words(diagnostics, obj_filename, words, link_info, error);
+    OK_OR_RETURN(error);
+
+    DebugInfo labels;
+    read_debug_info_file(obj_filename, labels);
+    recover_labels(words, labels);
+
+    FILE *const file =
+        out_filename[0] == '\0' ? stdout : fopen(out_filename, "w");
+    if (file == nullptr) {
+        fprintf(diagnostics, "Could not open file %s\n", out_filename);
+        SET_ERROR(error, FILE);
+        return;
+    }
+
+    fprintf(file, "; Disassembled from %s\n", obj_filename);
+    if (link_info.is_relocatable) {
+        fprintf(
+            file,
+            "; Relocatable object: fixups, .GLOBAL and .EXTERNAL labels are "
+            "not recovered\n"
+        );
+    }
+    for (size_t i = 0; i < words.size(); i += 2 + words[i + 1]) {
+        fprintf(file, "\n");
+        print_segment_source(
+            file, words[i], &words[i + 2], words[i + 1], labels
+        );
+    }
+
+    if (file != stdout && fclose(file) != 0) {
+        fprintf(diagnostics, "Could not write file %s\n", out_filename);
+        SET_ERROR(error, FILE);
+    }
+}
+
+// Only targets which are inside a segment can be referred to with a label
+void recover_labels(const vector<Word> &words, DebugInfo &labels) {
+    AddressBitmap in_program = {};
+    for (size_t i = 0; i < words.size(); i += 2 + words[i + 1]) {
+        for (Word j = 0; j < words[i + 1]; ++j)
+            bitmap_set(in_program, words[i] + j, true);
+    }
+
+    // Existing labels are found by address, so must be sorted first
+    sort_debug_info(labels);
+    AddressBitmap has_label = {};
+    for (size_t i = 0; i < labels.symbols.size(); ++i)
+        bitmap_set(has_label, labels.symbols[i].address, true);
+
+    for (size_t i = 0; i < words.size(); i += 2 + words[i + 1]) {
+        const Word origin = words[i];
+        for (Word j = 0; j < words[i + 1]; ++j) {
+            const DecodedInstruction &decoded =
+                decode_cached(origin + j, words[i + 2 + j]);
+            if (!decoded.is_valid)
+                continue;
+            for (uint8_t k = 0; k < decoded.operand_count; ++k) {
+                const DecodedOperand &operand = decoded.operands[k];
+                if (operand.kind != DecodedOperandKind::TARGET ||
+                    !bitmap_test(in_program, operand.value) ||
+                    !bitmap_set(has_label, operand.value, true))
+                    continue;
+                char name[sizeof("L0000")];
+                snprintf(name, sizeof(name), "L%04hx", operand.value);
+                add_debug_symbol(labels, name, operand.value);
+            }
+        }
+    }
+    sort_debug_info(labels);
+}
+
+void print_segment_source(
+    FILE *const file,
+    const Word origin,
+    const Word *const words,
+    const Word size,
+    const DebugInfo &labels
+) {
+    fprintf(file, ".ORIG x%04hx\n", origin);
+    for (size_t i = 0; i < size;) {
+        const Word address = origin + i;
+        const Symbol *const symbol = find_symbol_at(labels, address);
+        if (symbol != nullptr)
+            fprintf(file, "%s\n", symbol->name);
+
+        // Strings and blocks of zeros cannot contain a label
+        const size_t string_length =
+            string_length_at(words, i, size, origin, labels);
+        if (string_length > 0) {
+            fprintf(file, "    .STRINGZ \"");
+            for (size_t j = 0; j < string_length; ++j)
+                fprintf(file, "%c", static_cast<char>(words[i + j]));
+            fprintf(file, "\"\n");
+            i += string_length + 1;
+            continue;
+        }
+        size_t zeros = 0;
+        while (i + zeros < size && words[i + zeros] == 0x0000 &&
+               (zeros == 0 ||
+                find_symbol_at(labels, address + zeros) == nullptr))
+            ++zeros;
+        if (zeros > 1) {
+            fprintf(file, "    .BLKW %zu\n", zeros);
+            i += zeros;
+            continue;
+        }
+
+        char text[MAX_DISASSEMBLY];
+        format_instruction(
+            text, decode_cached(address, words[i]), address, labels, true
+        );
+        fprintf(file, "    %s\n", text);
+        ++i;
+    }
+    fprintf(file, ".END\n");
+}
+
+// Length of string at `start` (excluding terminator), or 0 if there is none
+// Printable characters which need no escaping are never valid instructions,
+//     so are always assumed to be a string when followed by a terminator
+size_t string_length_at(
+    const Word *const words,
+    const size_t start,
+    const size_t size,
+    const Word origin,
+    const DebugInfo &labels
+) {
+    size_t i = start;
+    for (; i < size; ++i) {
+        const Word word = words[i];
+        if (i > start && find_symbol_at(labels, origin + i) != nullptr)
+            return 0;
+        if (word == 0x0000)
+            break;
+        if (word < ' ' || word > '~' || word == '"' || word == '\\')
+            return 0;
+    }
+    if (i >= size)
+        return 0;
+    return i - start;
+}
+
+#endif
@@ -29,6 +29,7 @@ enum class Error {
     FILE = 0x20,           // Opening/reading file
     ASSEMBLE = 0x30,       // Parsing/assembling .asm
     EXECUTE = 0x40,        // Executing .obj
+    LINK = 0x50,           // Linking .obj files
     UNIMPLEMENTED = 0x80,  // Feature not implemented
     UNREACHABLE = 0xff,    // Unreachable code was reached
 };
@@ -5,11 +5,23 @@
 #include <cstring>  // memset
 
 #include "bitmasks.hpp"
+#include "cachemodel.cpp"
+#include "callprofile.cpp"
+#include "coverage.cpp"
 #include "debugger.cpp"
 #include "error.hpp"
 #include "globals.hpp"
+#include "heatmap.cpp"
+#include "profile.cpp"
+#include "remote.cpp"
+#include "replay.cpp"
+#include "sample.cpp"
+#include "selfmodify.cpp"
+#include "timing.cpp"
+#include "trace.cpp"
 #include "tty.cpp"
 #include "types.hpp"
+#include "uninitialized.cpp"
 
 #define _to_sext_word(_value, _size) \
     (sign_extend(static_cast<SignedWord>(_value), (_size)))
@@ -21,20 +33,65 @@
 // Prompt for `IN` trap
 #define TRAP_IN_PROMPT "Input a character: "
 
+// Bits of `execution_hooks`, for optional work done by the run loop and
+//     memory accesses. Each group is tested once, so that programs run
+//     without any cost while no option needs them
+#define HOOK_PROFILE 0x01
+#define HOOK_CALL_PROFILE 0x02
+#define HOOK_EXECUTED 0x04  // For coverage and self-modify
+#define HOOK_SELF_MODIFY 0x08
+#define HOOK_UNDO 0x10
+#define HOOK_WATCHPOINTS 0x20
+#define HOOK_HEATMAP 0x40
+#define HOOK_UNINITIALIZED 0x80
+
+#define HOOKS_INSTRUCTION \
+    (HOOK_PROFILE | HOOK_CALL_PROFILE | HOOK_EXECUTED | HOOK_UNDO)
+#define HOOKS_READ (HOOK_WATCHPOINTS | HOOK_HEATMAP | HOOK_UNINITIALIZED)
+#define HOOKS_WRITE \
+    (HOOK_WATCHPOINTS | HOOK_HEATMAP | HOOK_UNINITIALIZED | HOOK_SELF_MODIFY | \
+     HOOK_UNDO)
+
+static unsigned execution_hooks = 0;
+
 // TODO(refactor): Re-order functions
 
 void execute(const ObjectFile &input, bool debugger, Error &error);
 void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error);
+void execute_hooked_instruction(
+    bool &do_halt, bool &do_breakpoint, Error &error
+);
+void update_execution_hooks(void);
+bool is_call_stack_required(void);
 void execute_trap_instruction(
     const Word instr, bool &do_halt, bool &do_breakpoint, Error &error
 );
 
 void read_obj_filename_to_memory(const char *const obj_filename, Error &error);
+// Used by `read_obj_filename_to_memory`
+void read_obj_segments_to_memory(
+    FILE *const obj_file, const char *const obj_filename, Error &error
+);
+size_t read_obj_words_to_memory(
+    FILE *const obj_file,
+    const char *const obj_filename,
+    const Word origin,
+    const size_t max_words,
+    Error &error
+);
 
 Word &memory_checked(Word addr, Error &error);
+inline Word memory_read(const Word addr, Error &error);
+inline void memory_write(const Word addr, const Word value, Error &error);
+// Used by `memory_read` and `memory_write`
+void run_read_hooks(const Word addr, const Word value);
+void run_write_hooks(
+    const Word addr, Word &word, const Word value, Error &error
+);
 
 SignedWord sign_extend(SignedWord value, const size_t size);
 void set_condition_codes(const SignedWord result);
+char read_input_char(void);
 void print_char(char ch);
 void print_on_new_line(void);
 
@@ -46,26 +103,60 @@ void execute(const ObjectFile &input, bool debugger, Error &error) {
     if (input.kind == ObjectFile::FILE) {
         read_obj_filename_to_memory(input.filename, error);
         OK_OR_RETURN(error);
+        if (input.filename[0] != '\0')
+            read_debug_info_file(input.filename, debug_info);
     }
 
     // TODO(feat/debugger): Loop the whole program until debugger quit
 
     // GP and condition registers are already initialized to 0
-    registers.program_counter = memory_file_bounds.start;
+    registers.program_counter = memory_file_bounds.entry;
+    // Debugger enables it when first needed
+    call_stack.is_enabled = is_call_stack_required();
+    if (call_profile.is_enabled)
+        start_call_profile(registers.program_counter);
+    // Self-modify uses executed addresses of coverage
+    if (coverage.is_enabled || self_modify.is_enabled)
+        start_coverage();
+    if (defined_memory.is_enabled)
+        start_defined_memory();
+    if (self_modify.is_enabled)
+        start_self_modify();
+    update_execution_hooks();
+
+    // Debugger suspends execution on interrupt, instead of ending it
+    struct sigaction previous_interrupt;
+    catch_interrupts(previous_interrupt, debugger);
+    // Also sets `instruction_stop` if not sampling
+    struct sigaction previous_sample_timer;
+    start_sampling(previous_sample_timer);
 
     // Loop until `true` is returned, indicating a HALT (TRAP 0x25)
     bool do_halt = false;
     bool do_debugger_prompt = true;
     while (!do_halt) {
         if (debugger) {
+            if (remote.fd >= 0 && !do_debugger_prompt &&
+                (instruction_count & (REMOTE_POLL_INTERVAL - 1)) == 0)
+                poll_remote_interrupt();
+            // Not checked when stepping, as prompt is shown anyway
+            if (!do_debugger_prompt &&
+                is_breakpoint_hit(registers.program_counter)) {
+                dprintfc("\n");
+                dprintfc("Breakpoint reached. Suspending execution.\n");
+                dprintf_script("break pc=0x%04hx\n", registers.program_counter);
+                do_debugger_prompt = true;
+            }
             if (do_debugger_prompt) {
                 // TODO(feat): Print value at PC with `print_integer_value`
                 dprintf("\n");
-                dprintfc("PC: 0x%04hx\n", registers.program_counter);
+                print_debugger_location(registers.program_counter);
                 // TODO(refactor): Probably inline this (switch statement)
                 run_all_debugger_commands(
                     do_halt, do_debugger_prompt, debugger
                 );
+                // Watchpoints and undo may have changed
+                update_execution_hooks();
                 if (do_halt)
                     break;
                 dprintf("\x1b[2m");
@@ -74,10 +165,64 @@ void execute(const ObjectFile &input, bool debugger, Error &error) {
         }
 
         bool do_breakpoint = false;
-        execute_next_instrution(do_halt, do_breakpoint, error);
+#ifdef LASIM_TIMING
+        // Call stack is changed by `JSR` and `RET`
+        const Word program_counter = registers.program_counter;
+        const Word subroutine = current_subroutine();
+#endif
+        if ((execution_hooks & HOOKS_INSTRUCTION) == 0)
+            execute_next_instrution(do_halt, do_breakpoint, error);
+        else
+            execute_hooked_instruction(do_halt, do_breakpoint, error);
+        ++instruction_count;
         if (error != Error::OK) {
             fprintf(stderr, "Execution failed.\n");
-            return;
+            print_trace(stderr);
+            break;
+        }
+#ifdef LASIM_TIMING
+        record_cycles(program_counter, subroutine);
+#endif
+
+        // Only one test, whether a sample is due or not
+        // `returned` is set by `RET` which completes a `next` or `finish`
+        if ((is_interrupted | is_sample_due | call_stack.returned) != 0 ||
+            instruction_count >= instruction_stop) {
+            take_due_sample();
+            if (call_stack.returned)
+                do_debugger_prompt = true;
+            if (is_interrupted || instruction_count >= instruction_limit) {
+                if (debugger && is_interrupted) {
+                    is_interrupted = 0;
+                    dprintfc("\n");
+                    dprintfc("Interrupted. Suspending execution.\n");
+                    dprintf_script(
+                        "interrupt pc=0x%04hx\n", registers.program_counter
+                    );
+                    do_debugger_prompt = true;
+                } else {
+                    print_on_new_line();
+                    if (is_interrupted)
+                        fprintf(stderr, "Execution interrupted.\n");
+                    else
+                        fprintf(stderr, "Instruction limit reached.\n");
+                    print_trace(stderr);
+                    SET_ERROR(error, EXECUTE);
+                    break;
+                }
+            }
+        }
+
+        // Watchpoints can only be set with debugger
+        if (debugger && watchpoints.triggered) {
+            watchpoints.triggered = false;
+            if (is_watchpoint_hit()) {
+                print_watchpoint_hit();
+                if (!do_debugger_prompt) {
+                    dprintfc("Watchpoint triggered. Suspending execution.\n");
+                    do_debugger_prompt = true;
+                }
+            }
         }
 
         if (do_breakpoint) {
@@ -88,16 +233,83 @@ void execute(const ObjectFile &input, bool debugger, Error &error) {
                 } else {
                     dprintfc("\n");
                     dprintfc("Breakpoint encountered. Suspending execution.\n");
+                    dprintf_script(
+                        "break pc=0x%04hx\n", registers.program_counter
+                    );
                     do_debugger_prompt = true;
                 }
             }
         }
     }
 
+    restore_interrupts(previous_interrupt);
+    stop_sampling(previous_sample_timer);
+    // Also printed if program failed, as far as it got
+    if (sampler.mode != SampleMode::NONE)
+        print_samples(stderr);
+    OK_OR_RETURN(error);
+
     print_on_new_line();
 
     if (debugger)
         dprintfc("\nProgram completed\n")
+    // Script may have finished before program
+    dprintf_script(
+        "halt instructions=%llu\n",
+        static_cast<unsigned long long>(instruction_count)
+    );
+}
+
+// Same as `execute_next_instrution`, with each enabled instruction hook
+void execute_hooked_instruction(
+    bool &do_halt, bool &do_breakpoint, Error &error
+) {
+    const unsigned hooks = execution_hooks;
+    const Word program_counter = registers.program_counter;
+    if (hooks & HOOK_CALL_PROFILE)
+        record_call_profile_instruction();
+    if (hooks & HOOK_EXECUTED)
+        record_coverage(program_counter);
+    if (hooks & HOOK_UNDO)
+        begin_undo_entry();
+    execute_next_instrution(do_halt, do_breakpoint, error);
+    if (hooks & HOOK_UNDO)
+        end_undo_entry();
+    if (hooks & HOOK_PROFILE)
+        record_profile(program_counter);
+}
+
+// Whether anything besides the debugger needs the call stack
+bool is_call_stack_required() {
+#ifdef LASIM_TIMING
+    // Cycles are counted for each subroutine
+    return true;
+#else
+    // Samples and cache model include current subroutine
+    return sampler.mode != SampleMode::NONE || cache_model.is_enabled;
+#endif
+}
+
+// Must be called whenever a hook is enabled or disabled
+void update_execution_hooks() {
+    unsigned hooks = 0;
+    if (profile.is_enabled)
+        hooks |= HOOK_PROFILE;
+    if (call_profile.is_enabled)
+        hooks |= HOOK_CALL_PROFILE;
+    if (coverage.is_enabled || self_modify.is_enabled)
+        hooks |= HOOK_EXECUTED;
+    if (self_modify.is_enabled)
+        hooks |= HOOK_SELF_MODIFY;
+    if (undo_log.is_enabled)
+        hooks |= HOOK_UNDO;
+    if (watchpoints.count > 0)
+        hooks |= HOOK_WATCHPOINTS;
+    if (heatmap.is_enabled)
+        hooks |= HOOK_HEATMAP;
+    if (defined_memory.is_enabled)
+        hooks |= HOOK_UNINITIALIZED;
+    execution_hooks = hooks;
 }
 
 // `true` return value indicates that program should end
@@ -106,11 +318,14 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
     OK_OR_RETURN(error);
 
     const Word instr = memory[registers.program_counter];
+    record_trace(registers.program_counter, instr);
+    simulate_cache_access(registers.program_counter, CacheAccess::FETCH);
     ++registers.program_counter;
 
     // May be invalid enum variant
     // Handled in default switch branch
     const Opcode opcode = static_cast<Opcode>(bits_12_15(instr));
+    ++execution_stats.opcodes[bits_12_15(instr)];
 
     switch (opcode) {
         // ADD*
@@ -217,6 +432,9 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             if ((static_cast<uint8_t>(condition) &
                  static_cast<uint8_t>(registers.condition)) != 0b000) {
                 registers.program_counter += offset;
+                ++execution_stats.branches_taken;
+            } else {
+                ++execution_stats.branches_not_taken;
             }
         }; break;
 
@@ -246,6 +464,10 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             const Register base_reg = bits_6_8(instr);
             const Word base = registers.general_purpose[base_reg];
             registers.program_counter = base;
+            if (call_stack.is_enabled && base_reg == 7)
+                pop_call_frame();
+            if (call_profile.is_enabled && base_reg == 7)
+                exit_call_profile();
         }; break;
 
         // JSR/JSRR
@@ -275,15 +497,23 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
                 const Word base = registers.general_purpose[base_reg];
                 registers.program_counter = base;
             }
+            if (call_stack.is_enabled) {
+                const Word call_site = registers.general_purpose[7] - 1;
+                push_call_frame(call_site, registers.program_counter);
+            }
+            if (call_profile.is_enabled)
+                enter_call_profile(registers.program_counter);
         }; break;
 
         // LD*
         case Opcode::LD: {
             const Register dest_reg = bits_9_11(instr);
             const SignedWord offset = low_9_bits_sext(instr);
+            ++execution_stats.loads;
 
-            const Word value =
-                memory_checked(registers.program_counter + offset, error);
+            const Word addr = registers.program_counter + offset;
+            simulate_cache_access(addr, CacheAccess::LOAD);
+            const Word value = memory_read(addr, error);
             OK_OR_RETURN(error);
             registers.general_purpose[dest_reg] = value;
             set_condition_codes(value);
@@ -293,9 +523,12 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
         case Opcode::ST: {
             const Register src_reg = bits_9_11(instr);
             const SignedWord offset = low_9_bits_sext(instr);
+            ++execution_stats.stores;
 
             const Word value = registers.general_purpose[src_reg];
-            memory_checked(registers.program_counter + offset, error) = value;
+            const Word addr = registers.program_counter + offset;
+            simulate_cache_access(addr, CacheAccess::STORE);
+            memory_write(addr, value, error);
             OK_OR_RETURN(error);
         }; break;
 
@@ -304,9 +537,11 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             const Register dest_reg = bits_9_11(instr);
             const Register base_reg = bits_6_8(instr);
             const SignedWord offset = low_6_bits_sext(instr);
+            ++execution_stats.loads;
 
             const Word base = registers.general_purpose[base_reg];
-            const Word value = memory_checked(base + offset, error);
+            simulate_cache_access(base + offset, CacheAccess::LOAD);
+            const Word value = memory_read(base + offset, error);
             OK_OR_RETURN(error);
 
             registers.general_purpose[dest_reg] = value;
@@ -318,11 +553,13 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             const Register src_reg = bits_9_11(instr);
             const Register base_reg = bits_6_8(instr);
             const SignedWord offset = low_6_bits_sext(instr);
+            ++execution_stats.stores;
 
             const Word base = registers.general_purpose[base_reg];
             const Word value = registers.general_purpose[src_reg];
 
-            memory_checked(base + offset, error) = value;
+            simulate_cache_access(base + offset, CacheAccess::STORE);
+            memory_write(base + offset, value, error);
             OK_OR_RETURN(error);
         }; break;
 
@@ -330,11 +567,14 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
         case Opcode::LDI: {
             const Register dest_reg = bits_9_11(instr);
             const SignedWord offset = low_9_bits_sext(instr);
+            execution_stats.loads += 2;
 
-            const Word pointer =
-                memory_checked(registers.program_counter + offset, error);
+            const Word addr = registers.program_counter + offset;
+            simulate_cache_access(addr, CacheAccess::LOAD);
+            const Word pointer = memory_read(addr, error);
             OK_OR_RETURN(error);
-            const Word value = memory_checked(pointer, error);
+            simulate_cache_access(pointer, CacheAccess::LOAD);
+            const Word value = memory_read(pointer, error);
             OK_OR_RETURN(error);
 
             registers.general_purpose[dest_reg] = value;
@@ -345,13 +585,17 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
         case Opcode::STI: {
             const Register src_reg = bits_9_11(instr);
             const SignedWord offset = low_9_bits_sext(instr);
+            ++execution_stats.loads;
+            ++execution_stats.stores;
 
-            const Word pointer =
-                memory_checked(registers.program_counter + offset, error);
+            const Word addr = registers.program_counter + offset;
+            simulate_cache_access(addr, CacheAccess::LOAD);
+            const Word pointer = memory_read(addr, error);
             OK_OR_RETURN(error);
             const Word value = registers.general_purpose[src_reg];
 
-            memory_checked(pointer, error) = value;
+            simulate_cache_access(pointer, CacheAccess::STORE);
+            memory_write(pointer, value, error);
             OK_OR_RETURN(error);
         }; break;
 
@@ -369,6 +613,8 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
         case Opcode::TRAP: {
             execute_trap_instruction(instr, do_halt, do_breakpoint, error);
             OK_OR_RETURN(error);
+            if (replay_log.diverged)
+                SET_ERROR(error, EXECUTE);
         }; break;
 
         // RTI (supervisor-only)
@@ -409,21 +655,18 @@ void execute_trap_instruction(
     // May be invalid enum variant
     // Handled in default switch branch
     const TrapVector trap_vector = static_cast<TrapVector>(bits_0_8(instr));
+    ++execution_stats.traps[bits_0_8(instr)];
 
     switch (trap_vector) {
         case TrapVector::GETC: {
-            tty_nobuffer_noecho();                         // Disable echo
-            const char input = getchar() & BITMASK_LOW_8;  // Zero high 8 bits
-            tty_restore();
+            const char input = read_input_char();
             registers.general_purpose[0] = input;
         }; break;
 
         case TrapVector::IN: {
             print_on_new_line();
             printf(TRAP_IN_PROMPT);
-            tty_nobuffer_noecho();
-            const char input = getchar() & BITMASK_LOW_8;  // Zero high 8 bits
-            tty_restore();
+            const char input = read_input_char();
             print_char(input);
             print_on_new_line();
             registers.general_purpose[0] = input;
@@ -439,7 +682,7 @@ void execute_trap_instruction(
 
         case TrapVector::PUTS: {
             for (Word i = registers.general_purpose[0];; ++i) {
-                const Word word = memory_checked(i, error);
+                const Word word = memory_read(i, error);
                 OK_OR_RETURN(error);
 
                 if (word == 0x0000)
@@ -454,7 +697,7 @@ void execute_trap_instruction(
             // Loop over words, then split into bytes
             // This is done to ensure the memory check is sound
             for (Word i = registers.general_purpose[0];; ++i) {
-                const Word word = memory_checked(i, error);
+                const Word word = memory_read(i, error);
                 OK_OR_RETURN(error);
 
                 const char high = static_cast<char>(bits_high(word));
@@ -470,6 +713,8 @@ void execute_trap_instruction(
         }; break;
 
         case TrapVector::HALT:
+            if (replay_log.mode != ReplayMode::NONE)
+                replay_halt();
             do_halt = true;
             return;
 
@@ -523,42 +768,136 @@ void read_obj_filename_to_memory(const char *const obj_filename, Error &error) {
         return;
     }
 
-    Word start = swap_endian(origin);
+    const Word start = swap_endian(origin);
+
+    // Memory outside of segments is left as-is (zero, as it is static)
+    memory_file_bounds.start = MEMORY_USER_MAX;
+    memory_file_bounds.end = 0;
+
+    if (start == OBJECT_EXTENDED_MARKER) {
+        read_obj_segments_to_memory(obj_file, obj_filename, error);
+        OK_OR_RETURN(error);
+    } else {
+        // Rest of file is a single segment
+        memory_file_bounds.entry = start;
+        read_obj_words_to_memory(
+            obj_file, obj_filename, start, MEMORY_SIZE - start, error
+        );
+        OK_OR_RETURN(error);
+        if (fgetc(obj_file) != EOF) {
+            fprintf(stderr, "File is too long %s\n", obj_filename);
+            SET_ERROR(error, EXECUTE);
+            return;
+        }
+    }
+
+    fclose(obj_file);
+}
+
+// Body of a segmented object file, after the marker
+void read_obj_segments_to_memory(
+    FILE *const obj_file, const char *const obj_filename, Error &error
+) {
+    Word kind;
+    if (fread(&kind, WORD_SIZE, 1, obj_file) < 1) {
+        fprintf(stderr, "File is too short %s\n", obj_filename);
+        SET_ERROR(error, EXECUTE);
+        return;
+    }
+    kind = swap_endian(kind);
+    if (kind == static_cast<Word>(ObjectKind::RELOCATABLE)) {
+        fprintf(
+            stderr,
+            "Relocatable object file must be linked (with `-l`, or by giving "
+            "all modules to `-x`) %s\n",
+            obj_filename
+        );
+        SET_ERROR(error, EXECUTE);
+        return;
+    }
+    if (kind != static_cast<Word>(ObjectKind::SEGMENTED)) {
+        fprintf(stderr, "Unsupported object file format %s\n", obj_filename);
+        SET_ERROR(error, EXECUTE);
+        return;
+    }
+
+    bool is_first = true;
+    Word header[2];
+    size_t header_read;
+    while ((header_read = fread(header, WORD_SIZE, 2, obj_file)) == 2) {
+        const Word origin = swap_endian(header[0]);
+        const Word size = swap_endian(header[1]);
+        if (origin + size > MEMORY_SIZE) {
+            fprintf(
+                stderr,
+                "Segment at 0x%04hx does not fit in memory %s\n",
+                origin,
+                obj_filename
+            );
+            SET_ERROR(error, EXECUTE);
+            return;
+        }
+
+        const size_t words_read = read_obj_words_to_memory(
+            obj_file, obj_filename, origin, size, error
+        );
+        OK_OR_RETURN(error);
+        if (words_read < size) {
+            fprintf(stderr, "File is too short %s\n", obj_filename);
+            SET_ERROR(error, EXECUTE);
+            return;
+        }
 
-    char *const memory_at_file = reinterpret_cast<char *>(memory + start);
-    // TODO(fix): Shouldn't this count be in words ?
-    const size_t max_file_bytes = (MEMORY_SIZE - start) * WORD_SIZE;
-    words_read = fread(memory_at_file, WORD_SIZE, max_file_bytes, obj_file);
+        if (is_first)
+            memory_file_bounds.entry = origin;
+        is_first = false;
+    }
 
     if (ferror(obj_file)) {
         fprintf(stderr, "Could not read file %s\n", obj_filename);
         SET_ERROR(error, EXECUTE);
         return;
     }
-    if (words_read < 1) {
+    // Partial segment header, or no segments
+    if (header_read > 0 || is_first) {
         fprintf(stderr, "File is too short %s\n", obj_filename);
         SET_ERROR(error, EXECUTE);
         return;
     }
-    if (!feof(obj_file)) {
-        fprintf(stderr, "File is too long %s\n", obj_filename);
+}
+
+// Reads up to `max_words` words, and extends `memory_file_bounds` to them
+// Returns amount of words read, which is never 0 unless `error` is set
+size_t read_obj_words_to_memory(
+    FILE *const obj_file,
+    const char *const obj_filename,
+    const Word origin,
+    const size_t max_words,
+    Error &error
+) {
+    const size_t words_read =
+        fread(memory + origin, WORD_SIZE, max_words, obj_file);
+
+    if (ferror(obj_file)) {
+        fprintf(stderr, "Could not read file %s\n", obj_filename);
         SET_ERROR(error, EXECUTE);
-        return;
+        return 0;
+    }
+    if (words_read < 1) {
+        fprintf(stderr, "File is too short %s\n", obj_filename);
+        SET_ERROR(error, EXECUTE);
+        return 0;
     }
 
-    Word end = start + words_read;
-
-    for (size_t i = 0; i < start; ++i)
-        memory[i] = 0;
-    for (size_t i = start; i < end; ++i)
+    const size_t end = origin + words_read;
+    for (size_t i = origin; i < end; ++i)
         memory[i] = swap_endian(memory[i]);
-    for (size_t i = end; i < MEMORY_SIZE; ++i)
-        memory[i] = 0;
-
-    memory_file_bounds.start = start;
-    memory_file_bounds.end = end;
 
-    fclose(obj_file);
+    if (origin < memory_file_bounds.start)
+        memory_file_bounds.start = origin;
+    if (end > memory_file_bounds.end)
+        memory_file_bounds.end = end;
+    return words_read;
 }
 
 // Check memory address is within the 'allocated' file memory
@@ -574,6 +913,77 @@ Word &memory_checked(Word addr, Error &error) {
     return memory[addr];
 }
 
+// Used for all memory accesses of the program, besides fetching instructions
+// Hooks cost a single branch here while none are enabled
+inline Word memory_read(const Word addr, Error &error) {
+    const Word value = memory_checked(addr, error);
+    if ((execution_hooks & HOOKS_READ) != 0 && error == Error::OK)
+        run_read_hooks(addr, value);
+    return value;
+}
+
+inline void memory_write(const Word addr, const Word value, Error &error) {
+    Word &word = memory_checked(addr, error);
+    OK_OR_RETURN(error);
+    if ((execution_hooks & HOOKS_WRITE) != 0) {
+        run_write_hooks(addr, word, value, error);
+        OK_OR_RETURN(error);
+    }
+    word = value;
+}
+
+void run_read_hooks(const Word addr, const Word value) {
+    const unsigned hooks = execution_hooks;
+    if (hooks & HOOK_WATCHPOINTS)
+        check_watchpoint(false, addr, value, value);
+    if (hooks & HOOK_HEATMAP)
+        ++heatmap.reads[addr];
+    if ((hooks & HOOK_UNINITIALIZED) && !is_defined(addr))
+        report_uninitialized_read(addr);
+}
+
+// Sets `error` if store must not happen
+void run_write_hooks(
+    const Word addr, Word &word, const Word value, Error &error
+) {
+    const unsigned hooks = execution_hooks;
+    if ((hooks & HOOK_SELF_MODIFY) && is_executed_word(addr)) {
+        report_self_modify(addr, error);
+        OK_OR_RETURN(error);
+    }
+    if (hooks & HOOK_WATCHPOINTS)
+        check_watchpoint(true, addr, word, value);
+    if (hooks & HOOK_UNDO)
+        record_undo_memory(addr, word);
+    if (hooks & HOOK_HEATMAP)
+        ++heatmap.writes[addr];
+    if (hooks & HOOK_UNINITIALIZED)
+        mark_defined(addr);
+}
+
+// Input which was read by an undone instruction is read again first
+// Then input is read from replay log, if replaying
+char read_input_char() {
+    if (undo_log.is_enabled) {
+        undo_log.current.flags |= UNDO_INPUT;
+        if (!undo_log.unread_input.empty()) {
+            const char input = undo_log.unread_input.back();
+            undo_log.unread_input.pop_back();
+            return input;
+        }
+    }
+    ++execution_stats.chars_in;
+    char input;
+    if (replay_log.mode == ReplayMode::REPLAY && replay_input(input))
+        return input;
+    tty_nobuffer_noecho();              // Disable echo
+    input = getchar() & BITMASK_LOW_8;  // Zero high 8 bits
+    tty_restore();
+    if (replay_log.mode == ReplayMode::RECORD)
+        replay_input(input);
+    return input;
+}
+
 // TODO(fix): Truncate to `size` bits in this function, don't rely on caller
 SignedWord sign_extend(SignedWord value, const size_t size) {
     // If previous-highest bit is set
@@ -597,6 +1007,10 @@ void set_condition_codes(const SignedWord result) {
 void print_char(char ch) {
     if (ch == '\r')
         ch = '\n';
+    // Output of undone instructions was already recorded or checked
+    if (replay_log.mode != ReplayMode::NONE && undo_log.redo_count == 0)
+        replay_output(ch);
+    ++execution_stats.chars_out;
     printf("%c", ch);
     stdout_on_new_line = ch == '\n';
 }
@@ -1,6 +1,7 @@
 #ifndef GLOBALS_HPP
 #define GLOBALS_HPP
 
+#include <cstdint>  // uint64_t
 #include <cstdlib>  // exit
 
 #include "types.hpp"
@@ -9,12 +10,29 @@ static Word memory[MEMORY_SIZE];
 
 static Registers registers;
 
-// Start and end addresses of file in memory
+// Start and end addresses of file in memory (covering all segments)
 static struct {
     Word start;
     Word end;
+    Word entry;  // Origin of first segment
 } memory_file_bounds;
 
 static bool stdout_on_new_line = true;  // Count start of stream as new line
 
+// Instructions completed since program started
+static uint64_t instruction_count = 0;
+
+// Counted while executing, for `--stats`. Each is one increment, so they are
+//     always kept. Not reverted by undo
+static struct {
+    uint64_t opcodes[16];  // Indexed by opcode
+    uint64_t traps[256];   // Indexed by trap vector
+    uint64_t loads;        // Words read by LD/LDR/LDI (pointers included)
+    uint64_t stores;       // Words written by ST/STR/STI
+    uint64_t branches_taken;
+    uint64_t branches_not_taken;  // Not including NOP
+    uint64_t chars_in;
+    uint64_t chars_out;
+} execution_stats;
+
 #endif
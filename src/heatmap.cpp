@@ -0,0 +1,133 @@
+#ifndef HEATMAP_CPP
+#define HEATMAP_CPP
+
+#include <cstdint>  // uint32_t, uint64_t
+#include <cstdio>   // FILE, fopen, etc
+#include <cstring>  // strlen, strcasecmp
+#include <vector>   // std::vector
+
+#include "bytes.cpp"
+#include "debuginfo.cpp"
+#include "error.hpp"
+#include "profile.cpp"
+#include "types.hpp"
+
+using std::vector;
+
+// Reads and writes of each word of memory, by the program (including traps)
+// Counted in `memory_read` and `memory_write`, while enabled
+
+#define HEATMAP_MAGIC 0x4c41'484d  // "LAHM"
+#define HEATMAP_VERSION 1
+
+typedef struct Heatmap {
+    bool is_enabled = false;
+    const char *filename = nullptr;
+    uint64_t reads[MEMORY_SIZE];
+    uint64_t writes[MEMORY_SIZE];
+} Heatmap;
+
+static Heatmap heatmap;
+
+void finish_heatmap(Error &error);
+// Used by `finish_heatmap`
+bool write_heatmap_binary(FILE *const file);
+bool write_heatmap_csv(FILE *const file);
+void print_heatmap_summary(FILE *const file);
+
+// Written as CSV if filename ends with `.csv`, otherwise as binary
+void finish_heatmap(Error &error) {
+    const char *const filename = heatmap.filename;
+    const size_t length = strlen(filename);
+    const bool is_csv =
+        length >= 4 && !strcasecmp(filename + length - 4, ".csv");
+
+    FILE *const file = fopen(filename, is_csv ? "w" : "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Failed to open heatmap for writing: %s\n", filename);
+        SET_ERROR(error, FILE);
+    } else {
+        const bool ok =
+            is_csv ? write_heatmap_csv(file) : write_heatmap_binary(file);
+        const bool failed = !ok || ferror(file) != 0;
+        if (fclose(file) != 0 || failed) {
+            fprintf(stderr, "Failed to write heatmap: %s\n", filename);
+            SET_ERROR(error, FILE);
+        }
+    }
+    print_heatmap_summary(stderr);
+}
+
+// File format (integers big-endian):
+//     u32     magic
+//     u32     version
+//     u32     entry count
+//     entries, for each accessed word, by address:
+//         u16     address
+//         u32     reads (saturated)
+//         u32     writes (saturated)
+bool write_heatmap_binary(FILE *const file) {
+    uint32_t count = 0;
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        if (heatmap.reads[i] + heatmap.writes[i] != 0)
+            ++count;
+    }
+    if (!write_u32(file, HEATMAP_MAGIC) || !write_u32(file, HEATMAP_VERSION) ||
+        !write_u32(file, count))
+        return false;
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        if (heatmap.reads[i] + heatmap.writes[i] == 0)
+            continue;
+        const uint32_t reads = heatmap.reads[i] > UINT32_MAX
+                                   ? UINT32_MAX
+                                   : static_cast<uint32_t>(heatmap.reads[i]);
+        const uint32_t writes = heatmap.writes[i] > UINT32_MAX
+                                    ? UINT32_MAX
+                                    : static_cast<uint32_t>(heatmap.writes[i]);
+        if (!write_u16(file, static_cast<uint16_t>(i)) ||
+            !write_u32(file, reads) || !write_u32(file, writes))
+            return false;
+    }
+    return true;
+}
+
+// Only accessed words are included
+// Write errors are checked by caller
+bool write_heatmap_csv(FILE *const file) {
+    fprintf(file, "address,reads,writes\n");
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        if (heatmap.reads[i] + heatmap.writes[i] == 0)
+            continue;
+        fprintf(
+            file,
+            "0x%04zx,%llu,%llu\n",
+            i,
+            static_cast<unsigned long long>(heatmap.reads[i]),
+            static_cast<unsigned long long>(heatmap.writes[i])
+        );
+    }
+    return true;
+}
+
+void print_heatmap_summary(FILE *const file) {
+    vector<uint64_t> accesses(MEMORY_SIZE);
+    for (size_t i = 0; i < MEMORY_SIZE; ++i)
+        accesses[i] = heatmap.reads[i] + heatmap.writes[i];
+    const vector<Word> addresses = sorted_profile_addresses(accesses.data());
+
+    fprintf(file, "\nHot memory:\n");
+    fprintf(file, "    %10s  %10s  %s\n", "READS", "WRITES", "ADDRESS");
+    for (size_t i = 0; i < addresses.size() && i < PROFILE_TOP_COUNT; ++i) {
+        const Word address = addresses[i];
+        fprintf(
+            file,
+            "    %10llu  %10llu  ",
+            static_cast<unsigned long long>(heatmap.reads[address]),
+            static_cast<unsigned long long>(heatmap.writes[address])
+        );
+        print_symbolized_address(file, debug_info, address);
+        fprintf(file, "\n");
+    }
+}
+
+#endif
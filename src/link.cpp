@@ -0,0 +1,325 @@
+#ifndef LINK_CPP
+#define LINK_CPP
+
+#include <cstdint>  // SIZE_MAX
+#include <cstdio>   // FILE, fopen, etc
+#include <cstring>  // strlen, strcasecmp
+#include <vector>   // std::vector
+
+#include "assemble.cpp"
+#include "bytes.cpp"
+#include "debuginfo.cpp"
+#include "error.hpp"
+#include "linkinfo.cpp"
+#include "types.hpp"
+
+using std::vector;
+
+// One input file of `link`
+typedef struct LinkModule {
+    const char *filename;
+    vector<Word> words;  // Segments, as produced by the assembler
+    LinkInfo link_info;
+    Word offset;  // Added to every address of module when it is placed
+} LinkModule;
+
+void link(
+    FILE *const diagnostics,
+    const vector<const char *> &obj_filenames,
+    const ObjectFile &output,
+    Error &error
+);
+// Used by `link`
+void read_obj_file_to_words(
+    FILE *const diagnostics,
+    const char *const filename,
+    vector<Word> &words,
+    LinkInfo &link_info,
+    Error &error
+);
+bool place_module(LinkModule &module, const bool is_first, size_t &next_free);
+void apply_fixups(
+    FILE *const diagnostics,
+    LinkModule &module,
+    const DebugInfo &globals,
+    Error &error
+);
+size_t index_of_address(const vector<Word> &words, const Word address);
+
+// Combine object files into one program
+// The first module, and any module which is not relocatable, is placed at its
+//     own origins. Every other module is moved to follow the modules before it
+void link(
+    FILE *const diagnostics,
+    const vector<const char *> &obj_filenames,
+    const ObjectFile &output,
+    Error &error
+) {
+    vector<LinkModule> modules(obj_filenames.size());
+    for (size_t i = 0; i < modules.size(); ++i) {
+        LinkModule &module = modules[i];
+        module.filename = obj_filenames[i];
+        read_obj_file_to_words(
+            diagnostics, module.filename, module.words, module.link_info, error
+        );
+    }
+    OK_OR_RETURN(error);
+
+    size_t next_free = 0;  // After end of all modules placed so far
+    for (size_t i = 0; i < modules.size(); ++i) {
+        if (!place_module(modules[i], i == 0, next_free)) {
+            fprintf(
+                diagnostics,
+                "Module does not fit in memory: %s\n",
+                modules[i].filename
+            );
+            SET_ERROR(error, LINK);
+            return;
+        }
+    }
+
+    // Globals and labels of all modules, at their final addresses
+    DebugInfo globals;
+    DebugInfo info;
+    for (size_t i = 0; i < modules.size(); ++i) {
+        const LinkModule &module = modules[i];
+        const vector<Symbol> &module_globals = module.link_info.globals;
+        for (size_t j = 0; j < module_globals.size(); ++j) {
+            const Word address = module_globals[j].address + module.offset;
+            add_debug_symbol(globals, module_globals[j].name, address);
+        }
+
+        DebugInfo module_info;
+        read_debug_info_file(module.filename, module_info);
+        // Line numbers would be ambiguous between files
+        for (size_t j = 0; j < module_info.symbols.size(); ++j) {
+            const Symbol &symbol = module_info.symbols[j];
+            add_debug_symbol(info, symbol.name, symbol.address + module.offset);
+        }
+    }
+    sort_debug_info(globals);
+    sort_debug_info(info);
+
+    for (size_t i = 1; i < globals.symbols_by_name.size(); ++i) {
+        const Symbol &a = globals.symbols[globals.symbols_by_name[i - 1]];
+        const Symbol &b = globals.symbols[globals.symbols_by_name[i]];
+        if (!strcasecmp(a.name, b.name)) {
+            fprintf(
+                diagnostics,
+                "Global label '%s' is defined by multiple modules\n",
+                a.name
+            );
+            SET_ERROR(error, LINK);
+        }
+    }
+    OK_OR_RETURN(error);
+
+    vector<Word> words;
+    vector<size_t> segment_starts;
+    for (size_t i = 0; i < modules.size(); ++i) {
+        LinkModule &module = modules[i];
+        apply_fixups(diagnostics, module, globals, error);
+        for (size_t j = 0; j < module.words.size();
+             j += 2 + module.words[j + 1]) {
+            segment_starts.push_back(words.size() + j);
+        }
+        words.insert(words.end(), module.words.begin(), module.words.end());
+    }
+    OK_OR_RETURN(error);
+
+    Error overlap_error = Error::OK;
+    check_segments_overlap(diagnostics, words, segment_starts, overlap_error);
+    if (overlap_error != Error::OK) {
+        SET_ERROR(error, LINK);
+        return;
+    }
+
+    if (output.kind == ObjectFile::FILE) {
+        // Linked program is not relocatable
+        write_obj_file(diagnostics, output.filename, words, LinkInfo(), error);
+        OK_OR_RETURN(error);
+        if (output.filename[0] != '\0') {
+            write_debug_info_file(diagnostics, output.filename, info, error);
+            OK_OR_RETURN(error);
+        }
+    } else {
+        write_words_to_memory(words);
+        debug_info = info;
+    }
+}
+
+// Any object file is read into segments, as produced by the assembler
+void read_obj_file_to_words(
+    FILE *const diagnostics,
+    const char *const filename,
+    vector<Word> &words,
+    LinkInfo &link_info,
+    Error &error
+) {
+    FILE *const file = fopen(filename, "rb");
+    if (file == nullptr) {
+        fprintf(diagnostics, "Could not open file %s\n", filename);
+        SET_ERROR(error, FILE);
+        return;
+    }
+
+    Word first;
+    bool ok = read_u16(file, first);
+
+    if (ok && first != OBJECT_EXTENDED_MARKER) {
+        // Rest of file is a single segment
+        words.push_back(first);
+        words.push_back(0x0000);
+        for (Word word; read_u16(file, word);)
+            words.push_back(word);
+        const size_t size = words.size() - 2;
+        ok = size > 0 && first + size <= MEMORY_SIZE;
+        words[1] = size;
+
+    } else if (ok) {
+        Word kind = 0;
+        ok = read_u16(file, kind) &&
+             (kind == static_cast<Word>(ObjectKind::SEGMENTED) ||
+              kind == static_cast<Word>(ObjectKind::RELOCATABLE));
+        const bool is_relocatable =
+            kind == static_cast<Word>(ObjectKind::RELOCATABLE);
+        // Segmented objects have segments until end of file
+        Word segment_count = 0;
+        if (ok && is_relocatable)
+            ok = read_u16(file, segment_count) && segment_count > 0;
+
+        for (size_t i = 0; ok; ++i) {
+            if (is_relocatable && i >= segment_count)
+                break;
+            Word origin;
+            if (!read_u16(file, origin)) {
+                ok = !is_relocatable && i > 0 && !ferror(file);
+                break;
+            }
+            Word size;
+            ok = read_u16(file, size) && origin + size <= MEMORY_SIZE;
+            words.push_back(origin);
+            words.push_back(size);
+            for (size_t j = 0; ok && j < size; ++j) {
+                Word word;
+                ok = read_u16(file, word);
+                words.push_back(word);
+            }
+        }
+
+        if (ok && is_relocatable) {
+            link_info.is_relocatable = true;
+            ok = read_link_info(file, link_info);
+        }
+    }
+
+    if (!ok) {
+        fprintf(diagnostics, "Invalid object file %s\n", filename);
+        SET_ERROR(error, FILE);
+    }
+    fclose(file);
+}
+
+// Returns `false` if module does not fit in memory after previous modules
+bool place_module(LinkModule &module, const bool is_first, size_t &next_free) {
+    vector<Word> &words = module.words;
+    size_t lowest = MEMORY_SIZE;
+    size_t highest = 0;  // After end of last segment
+    for (size_t i = 0; i < words.size(); i += 2 + words[i + 1]) {
+        if (words[i] < lowest)
+            lowest = words[i];
+        if (words[i] + words[i + 1] > highest)
+            highest = words[i] + words[i + 1];
+    }
+
+    module.offset = 0;
+    if (!is_first && module.link_info.is_relocatable) {
+        const size_t length = highest - lowest;
+        if (next_free + length > MEMORY_SIZE)
+            return false;
+        module.offset = next_free - lowest;
+        for (size_t i = 0; i < words.size(); i += 2 + words[i + 1])
+            words[i] += module.offset;
+        highest = next_free + length;
+    }
+    if (highest > next_free)
+        next_free = highest;
+    return true;
+}
+
+void apply_fixups(
+    FILE *const diagnostics,
+    LinkModule &module,
+    const DebugInfo &globals,
+    Error &error
+) {
+    const LinkInfo &link_info = module.link_info;
+    for (size_t i = 0; i < link_info.fixups.size(); ++i) {
+        const Fixup &fixup = link_info.fixups[i];
+        const Word address = fixup.address + module.offset;
+        const size_t index = index_of_address(module.words, address);
+        if (index == SIZE_MAX ||
+            (fixup.symbol == FIXUP_OWN_MODULE &&
+             fixup.kind != ReferenceKind::ADDRESS) ||
+            (fixup.symbol != FIXUP_OWN_MODULE &&
+             fixup.symbol >= link_info.externals.size())) {
+            fprintf(diagnostics, "Invalid fixup in %s\n", module.filename);
+            SET_ERROR(error, LINK);
+            continue;
+        }
+        Word &word = module.words[index];
+
+        if (fixup.symbol == FIXUP_OWN_MODULE) {
+            word += module.offset;
+            continue;
+        }
+
+        const char *const name = link_info.externals[fixup.symbol].name;
+        StringSlice slice;
+        slice.pointer = name;
+        slice.length = strlen(name);
+        const Symbol *const global = find_symbol_by_name(globals, slice);
+        if (global == nullptr) {
+            fprintf(
+                diagnostics,
+                "Undefined external label '%s' in %s\n",
+                name,
+                module.filename
+            );
+            SET_ERROR(error, LINK);
+            continue;
+        }
+
+        if (fixup.kind == ReferenceKind::ADDRESS) {
+            word = global->address;
+            continue;
+        }
+
+        const uint8_t size = fixup.kind == ReferenceKind::PC_OFFSET11 ? 11 : 9;
+        const Word mask = (1U << size) - 1;
+        const SignedWord pc_offset = global->address - address - 1;
+        if (!does_integer_fit_size_inner(pc_offset, size)) {
+            fprintf(
+                diagnostics,
+                "Label '%s' is too far away to be referenced from %s\n",
+                name,
+                module.filename
+            );
+            SET_ERROR(error, LINK);
+            continue;
+        }
+        word |= pc_offset & mask;
+    }
+}
+
+// Index in `words` of the word at `address`, or `SIZE_MAX` if there is none
+size_t index_of_address(const vector<Word> &words, const Word address) {
+    for (size_t i = 0; i < words.size(); i += 2 + words[i + 1]) {
+        const Word origin = words[i];
+        if (address >= origin && address < origin + words[i + 1])
+            return i + 2 + (address - origin);
+    }
+    return SIZE_MAX;
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef LINKINFO_CPP
+#define LINKINFO_CPP
+
+#include <cstdio>   // FILE
+#include <cstring>  // strlen
+#include <vector>   // std::vector
+
+#include "bytes.cpp"
+#include "debuginfo.cpp"
+#include "token.cpp"
+#include "types.hpp"
+
+using std::vector;
+
+// Symbols and fixups of a relocatable object, which are resolved when linking
+// Only programs which use `.EXTERNAL` or `.GLOBAL` are relocatable
+
+// `Fixup::symbol` for an address of a label in the same module
+#define FIXUP_OWN_MODULE 0xFFFF
+
+typedef struct ExternalSymbol {
+    LabelString name;
+} ExternalSymbol;
+
+typedef struct Fixup {
+    ReferenceKind kind;
+    Word address;  // Of word to patch, before relocation
+    Word symbol;   // Index of external symbol, or `FIXUP_OWN_MODULE`
+} Fixup;
+
+typedef struct LinkInfo {
+    bool is_relocatable = false;
+    vector<Symbol> globals;
+    vector<ExternalSymbol> externals;
+    // Words of references to external symbols are assembled as if the offset
+    //     or address is 0, and addresses of own labels as if not relocated
+    vector<Fixup> fixups;
+} LinkInfo;
+
+bool write_link_info(FILE *const file, const LinkInfo &info);
+bool read_link_info(FILE *const file, LinkInfo &info);
+// Used by `*_link_info`
+bool write_symbol_name(FILE *const file, const char *const name);
+bool read_symbol_name(FILE *const file, LabelString &name);
+
+// Format, following segments of a relocatable object (all words):
+//     global count
+//     globals: address, name
+//     external count
+//     externals: name
+//     fixup count
+//     fixups: kind, address, symbol
+// Names are a length, followed by each character as a word
+bool write_link_info(FILE *const file, const LinkInfo &info) {
+    bool ok = write_u16(file, info.globals.size());
+    for (size_t i = 0; ok && i < info.globals.size(); ++i) {
+        ok = write_u16(file, info.globals[i].address) &&
+             write_symbol_name(file, info.globals[i].name);
+    }
+
+    ok = ok && write_u16(file, info.externals.size());
+    for (size_t i = 0; ok && i < info.externals.size(); ++i)
+        ok = write_symbol_name(file, info.externals[i].name);
+
+    ok = ok && write_u16(file, info.fixups.size());
+    for (size_t i = 0; ok && i < info.fixups.size(); ++i) {
+        const Fixup &fixup = info.fixups[i];
+        ok = write_u16(file, static_cast<Word>(fixup.kind)) &&
+             write_u16(file, fixup.address) && write_u16(file, fixup.symbol);
+    }
+    return ok;
+}
+
+// Does not set `is_relocatable`
+bool read_link_info(FILE *const file, LinkInfo &info) {
+    Word count;
+    bool ok = read_u16(file, count);
+    if (ok)
+        info.globals.resize(count);
+    for (size_t i = 0; ok && i < info.globals.size(); ++i) {
+        ok = read_u16(file, info.globals[i].address) &&
+             read_symbol_name(file, info.globals[i].name);
+    }
+
+    ok = ok && read_u16(file, count);
+    if (ok)
+        info.externals.resize(count);
+    for (size_t i = 0; ok && i < info.externals.size(); ++i)
+        ok = read_symbol_name(file, info.externals[i].name);
+
+    ok = ok && read_u16(file, count);
+    if (ok)
+        info.fixups.resize(count);
+    for (size_t i = 0; ok && i < info.fixups.size(); ++i) {
+        Fixup &fixup = info.fixups[i];
+        Word kind;
+        ok = read_u16(file, kind) &&
+             kind <= static_cast<Word>(ReferenceKind::ADDRESS) &&
+             read_u16(file, fixup.address) && read_u16(file, fixup.symbol);
+        fixup.kind = static_cast<ReferenceKind>(kind);
+        // Symbol index is checked when linking
+    }
+    return ok;
+}
+
+bool write_symbol_name(FILE *const file, const char *const name) {
+    const size_t length = strlen(name);
+    bool ok = write_u16(file, length);
+    for (size_t i = 0; ok && i < length; ++i)
+        ok = write_u16(file, name[i]);
+    return ok;
+}
+
+bool read_symbol_name(FILE *const file, LabelString &name) {
+    Word length;
+    if (!read_u16(file, length) || length >= MAX_LABEL)
+        return false;
+    for (size_t i = 0; i < length; ++i) {
+        Word ch;
+        if (!read_u16(file, ch) || ch == '\0' || ch > 0x7f)
+            return false;
+        name[i] = static_cast<char>(ch);
+    }
+    name[length] = '\0';
+    return true;
+}
+
+#endif
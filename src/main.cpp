@@ -1,15 +1,33 @@
 #include "assemble.cpp"
+#include "batch.cpp"
 #include "cli.cpp"
 #include "error.hpp"
 #include "execute.cpp"
+#include "link.cpp"
+#include "stats.cpp"
 
-Error try_run(Options &options);
+Error try_run(Options &options, AssemblyCache &cache);
+void execute_program(
+    const Options &options, const ObjectFile &object, Error &error
+);
 
 int main(const int argc, const char *const *const argv) {
     Options options;
     parse_options(options, argc, argv);  // Exits on error
 
-    Error error = try_run(options);
+    AssemblyCache cache;
+    cache.directory = options.cache_directory;
+    if (options.cache_max_kib != 0)
+        cache.max_bytes = options.cache_max_kib * 1024;
+
+    Error error = try_run(options, cache);
+
+    // Evict once all files are assembled, even if some failed
+    if (cache.directory != nullptr) {
+        evict_cache(cache);
+        if (options.cache_stats)
+            print_cache_stats(cache);
+    }
 
     switch (error) {
         case Error::OK:
@@ -17,6 +35,9 @@ int main(const int argc, const char *const *const argv) {
         case Error::ASSEMBLE:
             fprintf(stderr, "Failed to assemble.\n");
             break;
+        case Error::LINK:
+            fprintf(stderr, "Failed to link.\n");
+            break;
         default:
             break;
     }
@@ -24,37 +45,81 @@ int main(const int argc, const char *const *const argv) {
     return static_cast<int>(error);
 }
 
-Error try_run(Options &options) {
+Error try_run(Options &options, AssemblyCache &cache) {
     Error error = Error::OK;
     ObjectFile object;
 
     if (options.debugger_quiet) {
         debugger_quiet = true;
     }
+    // Parse all commands before doing anything else
+    if (options.debug_script_filename != nullptr) {
+        load_debugger_script_file(options.debug_script_filename, error);
+        if (error != Error::OK)
+            return error;
+        debugger_quiet = true;
+    }
+    if (options.debug_commands != nullptr) {
+        if (!add_debugger_script_commands(options.debug_commands))
+            return Error::CLI;
+        debugger_quiet = true;
+    }
+    // Terminal is left for the program
+    if (options.debug_server != nullptr)
+        debugger_quiet = true;
 
     switch (options.mode) {
         case Mode::ASSEMBLE_ONLY: {
+            if (options.in_filenames.size() > 1) {
+                assemble_all(options.in_filenames, options.jobs, cache, error);
+                if (error != Error::OK)
+                    return error;
+                break;
+            }
             object.kind = ObjectFile::FILE;
             object.filename = options.out_filename;
-            assemble(options.in_filename, object, error);
+            assemble(stderr, options.in_filename, object, cache, error);
             if (error != Error::OK)
                 return error;
         }; break;
 
-        case Mode::EXECUTE_ONLY: {
+        case Mode::LINK_ONLY: {
             object.kind = ObjectFile::FILE;
-            object.filename = options.in_filename;
-            execute(object, options.debugger, error);
+            object.filename = options.out_filename;
+            link(stderr, options.in_filenames, object, error);
+            if (error != Error::OK)
+                return error;
+        }; break;
+
+        case Mode::DISASSEMBLE_ONLY: {
+            disassemble_file(
+                stderr, options.in_filename, options.out_filename, error
+            );
+            if (error != Error::OK)
+                return error;
+        }; break;
+
+        case Mode::EXECUTE_ONLY: {
+            if (options.in_filenames.size() > 1) {
+                object.kind = ObjectFile::MEMORY;
+                link(stderr, options.in_filenames, object, error);
+                if (error != Error::OK)
+                    return error;
+            } else {
+                object.kind = ObjectFile::FILE;
+                object.filename = options.in_filename;
+            }
+            execute_program(options, object, error);
             if (error != Error::OK)
                 return error;
         }; break;
 
         case Mode::ASSEMBLE_EXECUTE: {
             object.kind = ObjectFile::MEMORY;
-            assemble(options.in_filename, object, error);
+            assemble(stderr, options.in_filename, object, cache, error);
             if (error != Error::OK)
                 return error;
-            execute(object, options.debugger, error);
+            execute_program(options, object, error);
             if (error != Error::OK)
                 return error;
         }; break;
@@ -62,3 +127,95 @@ Error try_run(Options &options) {
 
     return Error::OK;
 }
+
+// Replay log is opened only once program is ready to execute
+void execute_program(
+    const Options &options, const ObjectFile &object, Error &error
+) {
+    if (options.cycle_costs_filename != nullptr &&
+        !read_cycle_costs_file(options.cycle_costs_filename)) {
+        SET_ERROR(error, FILE);
+        return;
+    }
+    update_cycle_tables();
+    if (options.cache_model != nullptr &&
+        !configure_cache_model(options.cache_model)) {
+        SET_ERROR(error, CLI);
+        return;
+    }
+    if (options.record_filename != nullptr &&
+        !open_replay_log(options.record_filename, ReplayMode::RECORD)) {
+        SET_ERROR(error, FILE);
+        return;
+    }
+    if (options.replay_filename != nullptr &&
+        !open_replay_log(options.replay_filename, ReplayMode::REPLAY)) {
+        SET_ERROR(error, FILE);
+        return;
+    }
+    if (options.max_instructions != 0)
+        instruction_limit = options.max_instructions;
+    // Otherwise enabled by `record` command
+    undo_log.is_enabled = options.record_undo;
+    profile.is_enabled = options.profile;
+    call_profile.is_enabled = options.call_profile_filename != nullptr;
+    call_profile.filename = options.call_profile_filename;
+    heatmap.is_enabled = options.heatmap_filename != nullptr;
+    heatmap.filename = options.heatmap_filename;
+    defined_memory.is_enabled = options.check_uninitialized;
+    self_modify.is_enabled = options.check_self_modify;
+    self_modify.is_strict = options.strict_self_modify;
+    coverage.is_enabled = options.coverage_filename != nullptr ||
+                          options.coverage_data_filename != nullptr;
+    coverage.lcov_filename = options.coverage_filename;
+    coverage.data_filename = options.coverage_data_filename;
+    // Source of object file is assumed to be next to it
+    if (options.mode == Mode::ASSEMBLE_EXECUTE)
+        strcpy_max_size(
+            coverage.source_filename, options.in_filename, FILENAME_MAX - 1
+        );
+    else if (options.in_filenames.size() <= 1)
+        replace_filename_extension(
+            coverage.source_filename, options.in_filename, "asm"
+        );
+    if (options.sample_instructions != 0) {
+        sampler.mode = SampleMode::INSTRUCTIONS;
+        sampler.interval = options.sample_instructions;
+    } else if (options.sample_microseconds != 0) {
+        sampler.mode = SampleMode::TIMER;
+        sampler.interval = options.sample_microseconds;
+    }
+    // Client connects before program starts
+    if (options.debug_server != nullptr &&
+        !open_remote_server(options.debug_server)) {
+        close_replay_log(error);
+        SET_ERROR(error, FILE);
+        return;
+    }
+    const double start_seconds = monotonic_seconds();
+    execute(object, options.debugger, error);
+    const double seconds = monotonic_seconds() - start_seconds;
+    // Also printed if program failed, as far as it got
+    if (profile.is_enabled)
+        print_profile(stderr);
+    if (call_profile.is_enabled)
+        finish_call_profile(error);
+    if (options.cycles)
+        print_cycles(stderr);
+    if (cache_model.is_enabled)
+        print_cache_model(stderr);
+    if (heatmap.is_enabled)
+        finish_heatmap(error);
+    if (coverage.is_enabled)
+        finish_coverage(error);
+    if (defined_memory.is_enabled)
+        print_uninitialized_reads(stderr);
+    if (self_modify.is_enabled)
+        print_self_modify(stderr);
+    if (options.stats)
+        print_stats(stderr, seconds);
+    if (options.stats_json_filename != nullptr)
+        write_stats_json_file(options.stats_json_filename, seconds, error);
+    close_remote_server(error);
+    close_replay_log(error);
+}
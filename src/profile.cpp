@@ -0,0 +1,173 @@
+#ifndef PROFILE_CPP
+#define PROFILE_CPP
+
+#include <cstdint>  // uint64_t
+#include <cstdio>   // FILE, fprintf
+#include <cstdlib>  // qsort
+#include <vector>   // std::vector
+
+#include "bitmasks.hpp"
+#include "debuginfo.cpp"
+#include "disassemble.cpp"
+#include "globals.hpp"
+#include "types.hpp"
+
+using std::vector;
+
+// Count of executions of each address, and of backwards jumps from it
+// Counters are indexed directly by program counter, so recording is two
+//     increments at most. Nothing is touched unless enabled
+
+#define PROFILE_TOP_COUNT 10  // Addresses and loops to print
+
+typedef struct Profile {
+    bool is_enabled = false;
+    uint64_t executions[MEMORY_SIZE];
+    // Taken `BR` or `JMP` to the same or an earlier address. Indexed by
+    //     address of branch, which closes a loop
+    uint64_t back_edges[MEMORY_SIZE];
+} Profile;
+
+static Profile profile;
+
+// Counts being sorted, as `qsort` takes no context
+static const uint64_t *profile_sort_counts = nullptr;
+
+inline void record_profile(const Word program_counter);
+void print_profile(FILE *const file);
+// Used by `print_profile`
+void print_profile_counts(
+    FILE *const file,
+    const char *const title,
+    const uint64_t *const counts,
+    const uint64_t total
+);
+void print_profile_labels(FILE *const file, const uint64_t total);
+vector<Word> sorted_profile_addresses(const uint64_t *const counts);
+int compare_profile_addresses(const void *const a, const void *const b);
+
+// Called after instruction at `program_counter` was executed
+inline void record_profile(const Word program_counter) {
+    ++profile.executions[program_counter];
+    if (registers.program_counter > program_counter)
+        return;
+    // Ignore subroutine returns, which go back to their caller
+    const Word instr = memory[program_counter];
+    const Opcode opcode = static_cast<Opcode>(bits_12_15(instr));
+    if (opcode == Opcode::BR ||
+        (opcode == Opcode::JMP_RET && bits_6_8(instr) != 7))
+        ++profile.back_edges[program_counter];
+}
+
+void print_profile(FILE *const file) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < MEMORY_SIZE; ++i)
+        total += profile.executions[i];
+    fprintf(
+        file,
+        "\nProfile: %llu instruction%s\n",
+        static_cast<unsigned long long>(total),
+        total == 1 ? "" : "s"
+    );
+    if (total == 0)
+        return;
+    print_profile_counts(file, "Hot addresses", profile.executions, total);
+    print_profile_counts(file, "Hot loops", profile.back_edges, 0);
+    print_profile_labels(file, total);
+}
+
+// Percentage of `total` is omitted if it is 0
+void print_profile_counts(
+    FILE *const file,
+    const char *const title,
+    const uint64_t *const counts,
+    const uint64_t total
+) {
+    const vector<Word> addresses = sorted_profile_addresses(counts);
+    if (addresses.empty())
+        return;
+    fprintf(file, "%s:\n", title);
+    for (size_t i = 0; i < addresses.size() && i < PROFILE_TOP_COUNT; ++i) {
+        const Word address = addresses[i];
+        char text[MAX_DISASSEMBLY];
+        format_instruction(
+            text,
+            decode_cached(address, memory[address]),
+            address,
+            debug_info,
+            false
+        );
+        fprintf(
+            file,
+            "    %10llu  ",
+            static_cast<unsigned long long>(counts[address])
+        );
+        if (total != 0)
+            fprintf(file, "%5.1f%%  ", 100.0 * counts[address] / total);
+        fprintf(file, "%-20s  ", text);
+        print_symbolized_address(file, debug_info, address);
+        fprintf(file, "\n");
+    }
+}
+
+// Each label covers every address up to the next label
+void print_profile_labels(FILE *const file, const uint64_t total) {
+    const vector<Symbol> &symbols = debug_info.symbols;
+    if (symbols.empty())
+        return;
+
+    // Totals are stored at the address of each label, to reuse sorting
+    static uint64_t label_totals[MEMORY_SIZE];
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        const size_t end =
+            i + 1 < symbols.size() ? symbols[i + 1].address : MEMORY_SIZE;
+        uint64_t sum = 0;
+        for (size_t address = symbols[i].address; address < end; ++address)
+            sum += profile.executions[address];
+        label_totals[symbols[i].address] = sum;
+    }
+
+    const vector<Word> addresses = sorted_profile_addresses(label_totals);
+    if (addresses.empty())
+        return;
+    fprintf(file, "Labels:\n");
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        const Word address = addresses[i];
+        fprintf(
+            file,
+            "    %10llu  %5.1f%%  %s\n",
+            static_cast<unsigned long long>(label_totals[address]),
+            100.0 * label_totals[address] / total,
+            find_symbol_before(debug_info, address)->name
+        );
+    }
+}
+
+// Addresses with a non-zero count, highest count first
+vector<Word> sorted_profile_addresses(const uint64_t *const counts) {
+    vector<Word> addresses;
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        if (counts[i] != 0)
+            addresses.push_back(static_cast<Word>(i));
+    }
+    profile_sort_counts = counts;
+    qsort(
+        addresses.data(),
+        addresses.size(),
+        sizeof(Word),
+        compare_profile_addresses
+    );
+    return addresses;
+}
+
+int compare_profile_addresses(const void *const a, const void *const b) {
+    const Word a_address = *static_cast<const Word *>(a);
+    const Word b_address = *static_cast<const Word *>(b);
+    const uint64_t a_count = profile_sort_counts[a_address];
+    const uint64_t b_count = profile_sort_counts[b_address];
+    if (a_count != b_count)
+        return a_count < b_count ? 1 : -1;
+    return (a_address > b_address) - (a_address < b_address);
+}
+
+#endif
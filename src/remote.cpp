@@ -0,0 +1,675 @@
+#ifndef REMOTE_CPP
+#define REMOTE_CPP
+
+#include <netinet/in.h>   // sockaddr_in, INADDR_LOOPBACK
+#include <netinet/tcp.h>  // TCP_NODELAY
+#include <sys/socket.h>   // socket, bind, etc
+#include <sys/stat.h>     // stat
+#include <sys/un.h>       // sockaddr_un
+#include <unistd.h>       // close, unlink
+
+#include <cerrno>   // errno, EINTR
+#include <csignal>  // SIGTRAP, SIGINT
+#include <cstdint>  // uint32_t
+#include <cstdio>   // fprintf
+#include <cstdlib>  // strtol
+#include <cstring>  // strlen, strerror, strncmp
+#include <vector>   // std::vector
+
+#include "debugger.cpp"
+#include "error.hpp"
+#include "globals.hpp"
+#include "trace.cpp"
+#include "types.hpp"
+
+// Subset of the GDB remote serial protocol, for debugging from other tools
+// Each resumption (`s` or `c`) is a debugger command, and each stop of the
+//     debugger sends a stop reply to the client
+// Memory is byte-addressed by the client: word N is bytes 2N (high byte) and
+//     2N+1 (low byte). Registers are r0-r7, pc and psr (only NZP bits used),
+//     each 16 bits, in the same (big-endian) byte order
+
+// Large enough for all of memory in one `m` reply, as hex
+#define REMOTE_PACKET_SIZE (4 * MEMORY_SIZE + 32)
+#define REMOTE_RECEIVE_SIZE (64 * 1024)
+// Instructions between checks for an interrupt from client (power of 2)
+#define REMOTE_POLL_INTERVAL 0x1'0000
+#define REMOTE_REGISTER_COUNT (GP_REGISTER_COUNT + 2)
+#define REMOTE_INTERRUPT '\x03'
+
+typedef struct RemoteServer {
+    int fd = -1;  // Connection to client. Negative if not connected
+    bool is_ack_mode = true;
+    // Resumed by client, which is owed a stop reply
+    bool is_running = false;
+    int stop_signal = SIGTRAP;
+    // Bytes received but not yet handled
+    std::vector<char> input;
+    size_t input_start = 0;
+    std::vector<char> packet;  // Payload of current packet, unescaped
+    std::vector<char> reply;   // Payload of reply being built
+    std::vector<char> output;  // Framed reply
+} RemoteServer;
+
+static RemoteServer remote;
+
+bool open_remote_server(const char *const address);
+// Used by `open_remote_server`
+int open_remote_listener(const char *const address, const bool is_port);
+void close_remote_server(const Error error);
+bool is_remote_connected(void);
+DebuggerAction ask_remote_command(void);
+// Used by `ask_remote_command`
+DebuggerAction detach_remote_client(void);
+void poll_remote_interrupt(void);
+DebuggerAction handle_remote_packet(
+    const char *packet, const size_t length, std::vector<char> &reply
+);
+// Used by `handle_remote_packet`
+void append_remote_registers(std::vector<char> &reply);
+bool set_remote_register(const uint32_t index, const uint32_t value);
+void append_remote_memory(
+    std::vector<char> &reply, const uint32_t start, const uint32_t length
+);
+void set_remote_memory_byte(const uint32_t address, const uint8_t value);
+bool set_remote_breakpoint(
+    const char type, const uint32_t address, const uint32_t length,
+    const bool is_set
+);
+void append_stop_reply(std::vector<char> &reply);
+void append_hex(std::vector<char> &reply, const uint32_t value, int digits);
+void append_string(std::vector<char> &reply, const char *const string);
+bool take_hex(const char *&p, const char *const end, uint32_t &value);
+int hex_digit_value(const char ch);
+// Socket I/O
+bool read_remote_packet(void);
+bool receive_remote_input(const bool is_blocking);
+bool send_remote_packet(const std::vector<char> &payload);
+bool write_remote(const char *const data, const size_t length);
+uint8_t remote_checksum(const char *const data, const size_t length);
+
+// `address` is a TCP port on localhost, or a Unix socket path
+// Waits for a client to connect
+bool open_remote_server(const char *const address) {
+    bool is_port = address[0] != '\0';
+    for (size_t i = 0; address[i] != '\0'; ++i) {
+        if (address[i] < '0' || address[i] > '9')
+            is_port = false;
+    }
+
+    const int listener = open_remote_listener(address, is_port);
+    if (listener < 0)
+        return false;
+
+    fprintf(stderr, "Waiting for debugger to connect to %s\n", address);
+    do {
+        remote.fd = accept(listener, nullptr, nullptr);
+    } while (remote.fd < 0 && errno == EINTR);
+    if (remote.fd < 0) {
+        fprintf(
+            stderr,
+            "Failed to accept debugger connection: %s\n",
+            strerror(errno)
+        );
+    }
+    close(listener);
+    if (!is_port)
+        unlink(address);
+    if (remote.fd < 0)
+        return false;
+
+    if (is_port) {
+        const int no_delay = 1;
+        setsockopt(
+            remote.fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay)
+        );
+    }
+    remote.input.reserve(2 * REMOTE_RECEIVE_SIZE);
+    remote.reply.reserve(REMOTE_PACKET_SIZE);
+    remote.output.reserve(REMOTE_PACKET_SIZE + 4);
+    return true;
+}
+
+// Returns socket which is listening, or -1 on error
+int open_remote_listener(const char *const address, const bool is_port) {
+    int listener = -1;
+    bool ok;
+    if (is_port) {
+        const long port = strtol(address, nullptr, 10);
+        if (port < 1 || port > 0xffff) {
+            fprintf(stderr, "Invalid port for debug server: %s\n", address);
+            return -1;
+        }
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        const int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in name = {};
+        name.sin_family = AF_INET;
+        name.sin_port = htons(static_cast<uint16_t>(port));
+        name.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        const sockaddr *const generic = reinterpret_cast<sockaddr *>(&name);
+        ok = listener >= 0 && bind(listener, generic, sizeof(name)) == 0;
+    } else {
+        sockaddr_un name = {};
+        if (strlen(address) >= sizeof(name.sun_path)) {
+            fprintf(stderr, "Debug server socket path is too long\n");
+            return -1;
+        }
+        name.sun_family = AF_UNIX;
+        strcpy(name.sun_path, address);
+        // Left behind by a previous server. Never remove any other file
+        struct stat info;
+        if (stat(address, &info) == 0 && S_ISSOCK(info.st_mode))
+            unlink(address);
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        const sockaddr *const generic = reinterpret_cast<sockaddr *>(&name);
+        ok = listener >= 0 && bind(listener, generic, sizeof(name)) == 0;
+    }
+    ok = ok && listen(listener, 1) == 0;
+
+    if (!ok) {
+        fprintf(
+            stderr,
+            "Failed to start debug server on %s: %s\n",
+            address,
+            strerror(errno)
+        );
+        if (listener >= 0)
+            close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+// Client is told that program exited, with the error code as its status
+void close_remote_server(const Error error) {
+    if (remote.fd < 0)
+        return;
+    remote.reply.clear();
+    append_string(remote.reply, "W");
+    append_hex(remote.reply, static_cast<uint32_t>(error), 2);
+    send_remote_packet(remote.reply);
+    close(remote.fd);
+    remote.fd = -1;
+}
+
+bool is_remote_connected() {
+    return remote.fd >= 0;
+}
+
+// Handles packets until client resumes execution, detaches or disconnects
+DebuggerAction ask_remote_command() {
+    if (remote.is_running) {
+        remote.is_running = false;
+        remote.reply.clear();
+        append_stop_reply(remote.reply);
+        remote.stop_signal = SIGTRAP;
+        if (!send_remote_packet(remote.reply))
+            return detach_remote_client();
+    }
+
+    while (true) {
+        if (!read_remote_packet())
+            return detach_remote_client();
+        remote.reply.clear();
+        const DebuggerAction action = handle_remote_packet(
+            remote.packet.data(), remote.packet.size(), remote.reply
+        );
+        switch (action) {
+            case DebuggerAction::STEP:
+            case DebuggerAction::CONTINUE:
+                remote.is_running = true;
+                return action;
+            case DebuggerAction::NONE:
+                if (!send_remote_packet(remote.reply))
+                    return detach_remote_client();
+                break;
+            default:
+                // Kill has no reply
+                if (action != DebuggerAction::QUIT)
+                    send_remote_packet(remote.reply);
+                close(remote.fd);
+                remote.fd = -1;
+                return action;
+        }
+    }
+}
+
+// Client disconnected, so program continues without debugger
+DebuggerAction detach_remote_client() {
+    close(remote.fd);
+    remote.fd = -1;
+    return DebuggerAction::STOP;
+}
+
+// Checked while program is running, as client can only interrupt it then
+void poll_remote_interrupt() {
+    const size_t start = remote.input.size();
+    if (!receive_remote_input(false))
+        return;
+    // Interrupt is not part of a packet, so can be removed from input
+    size_t kept = start;
+    for (size_t i = start; i < remote.input.size(); ++i) {
+        if (remote.input[i] == REMOTE_INTERRUPT) {
+            is_interrupted = 1;
+            remote.stop_signal = SIGINT;
+            continue;
+        }
+        remote.input[kept] = remote.input[i];
+        ++kept;
+    }
+    remote.input.resize(kept);
+}
+
+// Reply is left empty for an unsupported packet
+// Returns action of a packet which resumes, detaches or kills
+DebuggerAction handle_remote_packet(
+    const char *packet, const size_t length, std::vector<char> &reply
+) {
+    const char *const end = packet + length;
+    if (length == 0)
+        return DebuggerAction::NONE;
+    const char kind = packet[0];
+    const char *p = packet + 1;
+    uint32_t address, count, value;
+
+    switch (kind) {
+        case '?':
+            append_stop_reply(reply);
+            break;
+
+        case 'g':
+            append_remote_registers(reply);
+            break;
+
+        case 'G':
+            for (uint32_t i = 0; i < REMOTE_REGISTER_COUNT; ++i) {
+                if (end - p < 4)
+                    break;
+                const char *const digits_end = p + 4;
+                if (!take_hex(p, digits_end, value) || p != digits_end)
+                    break;
+                set_remote_register(i, value);
+            }
+            append_string(reply, p == end ? "OK" : "E01");
+            break;
+
+        case 'p':
+            if (!take_hex(p, end, address) ||
+                address >= REMOTE_REGISTER_COUNT) {
+                append_string(reply, "E01");
+                break;
+            }
+            append_remote_registers(reply);
+            // Keep only requested register
+            reply.erase(reply.begin(), reply.begin() + 4 * address);
+            reply.resize(4);
+            break;
+
+        case 'P':
+            if (take_hex(p, end, address) && p != end && *p++ == '=' &&
+                take_hex(p, end, value) && set_remote_register(address, value))
+                append_string(reply, "OK");
+            else
+                append_string(reply, "E01");
+            break;
+
+        case 'm':
+            if (!take_hex(p, end, address) || p == end || *p++ != ',' ||
+                !take_hex(p, end, count) || address >= 2 * MEMORY_SIZE) {
+                append_string(reply, "E01");
+                break;
+            }
+            append_remote_memory(reply, address, count);
+            break;
+
+        case 'M':
+        case 'X': {
+            if (!take_hex(p, end, address) || p == end || *p++ != ',' ||
+                !take_hex(p, end, count) || p == end || *p++ != ':') {
+                append_string(reply, "E01");
+                break;
+            }
+            // Data is hex for `M`, and binary (already unescaped) for `X`
+            const size_t data_size = kind == 'M' ? 2 * count : count;
+            if (static_cast<size_t>(end - p) != data_size ||
+                address + count > 2 * MEMORY_SIZE) {
+                append_string(reply, "E01");
+                break;
+            }
+            bool is_valid = true;
+            for (uint32_t i = 0; is_valid && i < count; ++i) {
+                uint8_t byte = static_cast<uint8_t>(p[i]);
+                if (kind == 'M') {
+                    const int high = hex_digit_value(p[2 * i]);
+                    const int low = hex_digit_value(p[2 * i + 1]);
+                    is_valid = high >= 0 && low >= 0;
+                    byte = static_cast<uint8_t>(high << 4 | low);
+                }
+                if (is_valid)
+                    set_remote_memory_byte(address + i, byte);
+            }
+            append_string(reply, is_valid ? "OK" : "E01");
+        }; break;
+
+        case 'Z':
+        case 'z': {
+            const char type = p < end ? *p++ : '\0';
+            if (p == end || *p++ != ',' || !take_hex(p, end, address) ||
+                p == end || *p++ != ',' || !take_hex(p, end, count) ||
+                address >= 2 * MEMORY_SIZE) {
+                append_string(reply, "E01");
+                break;
+            }
+            if (set_remote_breakpoint(type, address, count, kind == 'Z'))
+                append_string(reply, "OK");
+        }; break;
+
+        // Signal and address are ignored
+        case 'c':
+        case 'C':
+        case 's':
+        case 'S':
+            if (kind == 'c' || kind == 's') {
+                if (take_hex(p, end, address))
+                    registers.program_counter = address / 2;
+            }
+            return kind == 'c' || kind == 'C' ? DebuggerAction::CONTINUE
+                                              : DebuggerAction::STEP;
+
+        // Reverse execution, using undo log
+        case 'b':
+            if (p == end || (*p != 's' && *p != 'c'))
+                break;
+            if (*p == 's' ? !undo_instruction() : !undo_until_breakpoint()) {
+                append_string(reply, "T05replaylog:begin;");
+                break;
+            }
+            append_stop_reply(reply);
+            break;
+
+        case 'D':
+            append_string(reply, "OK");
+            return DebuggerAction::STOP;
+
+        case 'k':
+            return DebuggerAction::QUIT;
+
+        // Only one thread
+        case 'H':
+        case 'T':
+            append_string(reply, "OK");
+            break;
+
+        case 'q':
+            if (!strncmp(p, "Supported", 9)) {
+                append_string(reply, "PacketSize=");
+                append_hex(reply, REMOTE_PACKET_SIZE, 5);
+                append_string(
+                    reply, ";QStartNoAckMode+;ReverseStep+;ReverseContinue+"
+                );
+            } else if (!strncmp(p, "Attached", 8)) {
+                append_string(reply, "1");
+            } else if (!strncmp(p, "C", 1) && length == 2) {
+                append_string(reply, "QC1");
+            } else if (!strncmp(p, "fThreadInfo", 11)) {
+                append_string(reply, "m1");
+            } else if (!strncmp(p, "sThreadInfo", 11)) {
+                append_string(reply, "l");
+            }
+            break;
+
+        case 'Q':
+            if (!strncmp(p, "StartNoAckMode", 14)) {
+                // Takes effect after acknowledging this packet
+                remote.is_ack_mode = false;
+                append_string(reply, "OK");
+            }
+            break;
+
+        case 'v':
+            if (!strncmp(p, "Cont?", 5)) {
+                append_string(reply, "vCont;c;C;s;S");
+            } else if (!strncmp(p, "Cont;", 5) && length > 6) {
+                // Only one thread, so first action applies
+                const char action = p[5];
+                if (action == 'c' || action == 'C')
+                    return DebuggerAction::CONTINUE;
+                if (action == 's' || action == 'S')
+                    return DebuggerAction::STEP;
+            } else if (!strncmp(p, "Kill", 4)) {
+                append_string(reply, "OK");
+                return DebuggerAction::QUIT;
+            }
+            break;
+
+        default:
+            break;
+    }
+    return DebuggerAction::NONE;
+}
+
+void append_remote_registers(std::vector<char> &reply) {
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i)
+        append_hex(reply, registers.general_purpose[i], 4);
+    append_hex(reply, registers.program_counter, 4);
+    append_hex(reply, static_cast<uint32_t>(registers.condition), 4);
+}
+
+// Returns `false` if register does not exist
+// Condition is only changed to a valid value
+bool set_remote_register(const uint32_t index, const uint32_t value) {
+    if (index < GP_REGISTER_COUNT) {
+        registers.general_purpose[index] = value;
+    } else if (index == GP_REGISTER_COUNT) {
+        registers.program_counter = value;
+    } else if (index == GP_REGISTER_COUNT + 1) {
+        if (value & 0b100)
+            registers.condition = ConditionCode::NEGATIVE;
+        else if (value & 0b010)
+            registers.condition = ConditionCode::ZERO;
+        else if (value & 0b001)
+            registers.condition = ConditionCode::POSITIVE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Read is truncated at end of memory
+void append_remote_memory(
+    std::vector<char> &reply, const uint32_t start, const uint32_t length
+) {
+    static const char *const HEX_DIGITS = "0123456789abcdef";
+    uint32_t end = start + length;
+    if (end > 2 * MEMORY_SIZE || end < start)
+        end = 2 * MEMORY_SIZE;
+    const size_t offset = reply.size();
+    reply.resize(offset + 2 * (end - start));
+    char *out = reply.data() + offset;
+    for (uint32_t address = start; address < end; ++address) {
+        const Word word = memory[address >> 1];
+        const uint8_t byte = (address & 1) ? word & 0xff : word >> 8;
+        out[0] = HEX_DIGITS[byte >> 4];
+        out[1] = HEX_DIGITS[byte & 0xf];
+        out += 2;
+    }
+}
+
+void set_remote_memory_byte(const uint32_t address, const uint8_t value) {
+    Word &word = memory[address >> 1];
+    if (address & 1)
+        word = (word & 0xff00) | value;
+    else
+        word = (word & 0x00ff) | (value << 8);
+}
+
+// Type 0 and 1 are breakpoints, 2 to 4 are write, read and access watchpoints
+// Returns `false` if type is not supported
+bool set_remote_breakpoint(
+    const char type, const uint32_t address, const uint32_t length,
+    const bool is_set
+) {
+    const Word start = address / 2;
+    uint32_t end = (address + (length > 0 ? length : 1) - 1) / 2;
+    if (end >= MEMORY_SIZE)
+        end = MEMORY_SIZE - 1;
+    switch (type) {
+        case '0':
+        case '1':
+            set_breakpoint(start, is_set);
+            return true;
+        case '2':
+        case '3':
+        case '4':
+            if (type != '3')
+                set_watchpoints(watchpoints.writes, start, end, is_set);
+            if (type != '2')
+                set_watchpoints(watchpoints.reads, start, end, is_set);
+            return true;
+        default:
+            return false;
+    }
+}
+
+void append_stop_reply(std::vector<char> &reply) {
+    append_string(reply, "S");
+    append_hex(reply, remote.stop_signal, 2);
+}
+
+void append_hex(std::vector<char> &reply, const uint32_t value, int digits) {
+    static const char *const HEX_DIGITS = "0123456789abcdef";
+    while (digits > 0) {
+        --digits;
+        reply.push_back(HEX_DIGITS[(value >> (4 * digits)) & 0xf]);
+    }
+}
+
+void append_string(std::vector<char> &reply, const char *const string) {
+    reply.insert(reply.end(), string, string + strlen(string));
+}
+
+// Returns `false` if there are no hex digits
+bool take_hex(const char *&p, const char *const end, uint32_t &value) {
+    const char *const start = p;
+    value = 0;
+    for (int digit; p < end && (digit = hex_digit_value(*p)) >= 0; ++p)
+        value = value << 4 | digit;
+    return p != start;
+}
+
+int hex_digit_value(const char ch) {
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    return -1;
+}
+
+// Packets are `$payload#xx`, where `xx` is the checksum of the payload
+// Acknowledgements and interrupts outside of packets are skipped
+// Returns `false` if client disconnected
+bool read_remote_packet() {
+    std::vector<char> &input = remote.input;
+    std::vector<char> &packet = remote.packet;
+    while (true) {
+        // Find start of packet
+        while (remote.input_start < input.size() &&
+               input[remote.input_start] != '$')
+            ++remote.input_start;
+
+        // Find end of packet, including checksum
+        size_t i = remote.input_start + 1;
+        while (i < input.size() && input[i] != '#')
+            ++i;
+        if (i + 2 >= input.size()) {
+            // Incomplete. Keep what has been received of packet
+            input.erase(input.begin(), input.begin() + remote.input_start);
+            remote.input_start = 0;
+            if (!receive_remote_input(true))
+                return false;
+            continue;
+        }
+
+        packet.clear();
+        for (size_t j = remote.input_start + 1; j < i; ++j) {
+            // Escaped character is XOR'd with 0x20
+            if (input[j] == '}' && j + 1 < i)
+                packet.push_back(input[++j] ^ 0x20);
+            else
+                packet.push_back(input[j]);
+        }
+        const int high = hex_digit_value(input[i + 1]);
+        const int low = hex_digit_value(input[i + 2]);
+        const uint8_t checksum =
+            remote_checksum(input.data() + remote.input_start + 1,
+                            i - remote.input_start - 1);
+        remote.input_start = i + 3;
+
+        const bool is_valid = high >= 0 && low >= 0 &&
+                              checksum == (high << 4 | low);
+        if (remote.is_ack_mode && !write_remote(is_valid ? "+" : "-", 1))
+            return false;
+        if (is_valid)
+            return true;
+    }
+}
+
+// Appends to `remote.input`
+// Returns `false` if client disconnected, or if nothing was available when
+//     not `is_blocking`
+bool receive_remote_input(const bool is_blocking) {
+    std::vector<char> &input = remote.input;
+    const size_t start = input.size();
+    input.resize(start + REMOTE_RECEIVE_SIZE);
+    ssize_t count;
+    do {
+        count = recv(
+            remote.fd,
+            input.data() + start,
+            REMOTE_RECEIVE_SIZE,
+            is_blocking ? 0 : MSG_DONTWAIT
+        );
+    } while (count < 0 && errno == EINTR);
+    input.resize(start + (count > 0 ? count : 0));
+    return count > 0;
+}
+
+// Written with a single call, as replies can be large
+// Returns `false` if client disconnected
+bool send_remote_packet(const std::vector<char> &payload) {
+    std::vector<char> &output = remote.output;
+    output.clear();
+    output.push_back('$');
+    output.insert(output.end(), payload.begin(), payload.end());
+    output.push_back('#');
+    append_hex(output, remote_checksum(payload.data(), payload.size()), 2);
+    return write_remote(output.data(), output.size());
+}
+
+// Returns `false` if client disconnected
+// Never raises `SIGPIPE`, which would end the program
+bool write_remote(const char *const data, const size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        const ssize_t count =
+            send(remote.fd, data + written, length - written, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        written += count;
+    }
+    return true;
+}
+
+uint8_t remote_checksum(const char *const data, const size_t length) {
+    uint8_t sum = 0;
+    for (size_t i = 0; i < length; ++i)
+        sum += static_cast<uint8_t>(data[i]);
+    return sum;
+}
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef REPLAY_CPP
+#define REPLAY_CPP
+
+#include <cstdint>  // uint64_t
+#include <cstdio>   // FILE, fopen, etc
+
+#include "bytes.cpp"
+#include "error.hpp"
+#include "globals.hpp"
+
+// Record every character read and written by a program, with the instruction
+//     count it happened at, so a run can be re-executed exactly.
+// When replaying, input is read from the log, and output is checked against
+//     it. Any difference stops execution.
+
+#define REPLAY_MAGIC 0x4c41'5250  // "LARP"
+#define REPLAY_VERSION 1
+#define REPLAY_BUFFER_SIZE (64 * 1024)
+
+enum class ReplayMode {
+    NONE,
+    RECORD,
+    REPLAY,
+};
+
+enum class ReplayEventKind {
+    INPUT = 1,
+    OUTPUT = 2,
+    HALT = 3,
+};
+
+typedef struct ReplayEvent {
+    ReplayEventKind kind;
+    uint64_t instruction;  // Count of instructions executed before event
+    char ch;               // Only for input and output
+} ReplayEvent;
+
+typedef struct ReplayLog {
+    ReplayMode mode = ReplayMode::NONE;
+    FILE *file = nullptr;
+    const char *filename = nullptr;
+    uint64_t last_instruction = 0;  // Of previous event
+    bool failed = false;    // Write failed
+    bool diverged = false;  // Program did not match replay. Stops execution
+    // Only when replaying
+    ReplayEvent next;
+    bool has_next = false;
+} ReplayLog;
+
+static ReplayLog replay_log;
+
+bool open_replay_log(const char *const filename, const ReplayMode mode);
+void close_replay_log(Error &error);
+bool replay_input(char &input);
+void replay_output(const char output);
+void replay_halt(void);
+// Used by `replay_*` functions
+void write_replay_event(const ReplayEventKind kind, const char ch);
+void read_next_replay_event(void);
+void check_replay_event(const ReplayEventKind kind, const char ch);
+void print_replay_event(const ReplayEventKind kind, const char ch);
+bool write_varint(FILE *const file, uint64_t value);
+bool read_varint(FILE *const file, uint64_t &value);
+
+// File format (integers big-endian):
+//     u32     magic
+//     u32     version
+//     events, until end of file:
+//         u8      kind
+//         varint  instructions since previous event
+//         u8      character (input and output only)
+// Varints are little-endian groups of 7 bits, with the high bit set on all
+//     but the last byte
+bool open_replay_log(const char *const filename, const ReplayMode mode) {
+    const bool is_record = mode == ReplayMode::RECORD;
+    FILE *const file = fopen(filename, is_record ? "wb" : "rb");
+    if (file == nullptr) {
+        fprintf(
+            stderr,
+            "Failed to open replay log for %s: %s\n",
+            is_record ? "writing" : "reading",
+            filename
+        );
+        return false;
+    }
+    // Events are small, so avoid a write for each
+    setvbuf(file, nullptr, _IOFBF, REPLAY_BUFFER_SIZE);
+
+    replay_log.mode = mode;
+    replay_log.file = file;
+    replay_log.filename = filename;
+
+    if (is_record) {
+        replay_log.failed = !write_u32(file, REPLAY_MAGIC) ||
+                            !write_u32(file, REPLAY_VERSION);
+        return true;
+    }
+
+    uint32_t magic, version;
+    if (!read_u32(file, magic) || magic != REPLAY_MAGIC ||
+        !read_u32(file, version) || version != REPLAY_VERSION) {
+        fprintf(stderr, "Invalid replay log: %s\n", filename);
+        fclose(file);
+        replay_log.mode = ReplayMode::NONE;
+        return false;
+    }
+    read_next_replay_event();
+    return true;
+}
+
+// Replay is only checked to have ended if program halted
+void close_replay_log(Error &error) {
+    if (replay_log.mode == ReplayMode::NONE)
+        return;
+    if (fclose(replay_log.file) != 0)
+        replay_log.failed = true;
+    if (replay_log.failed) {
+        fprintf(
+            stderr, "Failed to write replay log: %s\n", replay_log.filename
+        );
+        SET_ERROR(error, FILE);
+    }
+    replay_log.mode = ReplayMode::NONE;
+}
+
+// When recording, `input` is the character which was read
+// Returns `true` if `input` was set from replay
+bool replay_input(char &input) {
+    if (replay_log.mode == ReplayMode::RECORD) {
+        write_replay_event(ReplayEventKind::INPUT, input);
+        return false;
+    }
+    check_replay_event(ReplayEventKind::INPUT, '\0');
+    input = replay_log.diverged ? '\0' : replay_log.next.ch;
+    if (!replay_log.diverged)
+        read_next_replay_event();
+    return true;
+}
+
+void replay_output(const char output) {
+    if (replay_log.mode == ReplayMode::RECORD) {
+        write_replay_event(ReplayEventKind::OUTPUT, output);
+        return;
+    }
+    check_replay_event(ReplayEventKind::OUTPUT, output);
+    if (!replay_log.diverged)
+        read_next_replay_event();
+}
+
+void replay_halt() {
+    if (replay_log.mode == ReplayMode::RECORD) {
+        write_replay_event(ReplayEventKind::HALT, '\0');
+        return;
+    }
+    check_replay_event(ReplayEventKind::HALT, '\0');
+}
+
+void write_replay_event(const ReplayEventKind kind, const char ch) {
+    FILE *const file = replay_log.file;
+    const uint64_t delta = instruction_count - replay_log.last_instruction;
+    replay_log.last_instruction = instruction_count;
+    bool ok = write_u8(file, static_cast<uint8_t>(kind)) &&
+              write_varint(file, delta);
+    if (kind != ReplayEventKind::HALT)
+        ok = ok && write_u8(file, static_cast<uint8_t>(ch));
+    if (!ok)
+        replay_log.failed = true;
+}
+
+// End of file (or an invalid event) leaves `has_next` unset
+void read_next_replay_event() {
+    FILE *const file = replay_log.file;
+    ReplayEvent &event = replay_log.next;
+    replay_log.has_next = false;
+
+    uint8_t kind;
+    uint64_t delta;
+    if (!read_u8(file, kind) || kind < 1 ||
+        kind > static_cast<uint8_t>(ReplayEventKind::HALT) ||
+        !read_varint(file, delta))
+        return;
+    event.kind = static_cast<ReplayEventKind>(kind);
+    event.instruction = replay_log.last_instruction + delta;
+    event.ch = '\0';
+    if (event.kind != ReplayEventKind::HALT) {
+        uint8_t ch;
+        if (!read_u8(file, ch))
+            return;
+        event.ch = static_cast<char>(ch);
+    }
+    replay_log.last_instruction = event.instruction;
+    replay_log.has_next = true;
+}
+
+// Input character is not compared
+void check_replay_event(const ReplayEventKind kind, const char ch) {
+    const ReplayEvent &next = replay_log.next;
+    if (replay_log.diverged)
+        return;
+    if (replay_log.has_next && next.kind == kind &&
+        next.instruction == instruction_count &&
+        (kind != ReplayEventKind::OUTPUT || next.ch == ch))
+        return;
+
+    replay_log.diverged = true;
+    fprintf(
+        stderr,
+        "Replay diverged at instruction %llu: expected ",
+        static_cast<unsigned long long>(instruction_count)
+    );
+    if (replay_log.has_next) {
+        print_replay_event(next.kind, next.ch);
+        fprintf(
+            stderr,
+            " at instruction %llu",
+            static_cast<unsigned long long>(next.instruction)
+        );
+    } else {
+        fprintf(stderr, "end of log");
+    }
+    fprintf(stderr, ", got ");
+    print_replay_event(kind, ch);
+    fprintf(stderr, "\n");
+}
+
+void print_replay_event(const ReplayEventKind kind, const char ch) {
+    switch (kind) {
+        case ReplayEventKind::INPUT:
+            fprintf(stderr, "input");
+            break;
+        case ReplayEventKind::OUTPUT:
+            fprintf(stderr, "output 0x%02hhx", static_cast<uint8_t>(ch));
+            break;
+        case ReplayEventKind::HALT:
+            fprintf(stderr, "HALT");
+            break;
+    }
+}
+
+bool write_varint(FILE *const file, uint64_t value) {
+    while (value >= 0x80) {
+        if (!write_u8(file, static_cast<uint8_t>(value | 0x80)))
+            return false;
+        value >>= 7;
+    }
+    return write_u8(file, static_cast<uint8_t>(value));
+}
+
+bool read_varint(FILE *const file, uint64_t &value) {
+    value = 0;
+    for (size_t shift = 0; shift < 64; shift += 7) {
+        uint8_t byte;
+        if (!read_u8(file, byte))
+            return false;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef SAMPLE_CPP
+#define SAMPLE_CPP
+
+#include <signal.h>    // sigaction, SIGPROF
+#include <sys/time.h>  // setitimer
+
+#include <cstdint>  // uint64_t, UINT64_MAX
+#include <cstdio>   // FILE, fprintf
+#include <vector>   // std::vector
+
+#include "debugger.cpp"
+#include "debuginfo.cpp"
+#include "globals.hpp"
+#include "profile.cpp"
+#include "trace.cpp"
+#include "types.hpp"
+
+using std::vector;
+
+// Statistical profile, of the program counter and innermost subroutine
+// Samples are taken every `interval` instructions, or on a `SIGPROF` timer of
+//     `interval` microseconds of CPU time. Either way, the run loop only
+//     compares `instruction_count` with `instruction_stop`, as it already did
+//     for the instruction limit, and a timer tick is seen as an interrupt
+// The buffer is never grown. When full, every second sample is dropped, and
+//     only every second sample is taken from then on
+
+#define SAMPLE_BUFFER_SIZE (64 * 1024)  // Must be even
+
+enum class SampleMode {
+    NONE,
+    INSTRUCTIONS,
+    TIMER,
+};
+
+typedef struct Sample {
+    Word program_counter;
+    Word subroutine;  // Program entry, if not in a subroutine
+} Sample;
+
+typedef struct Sampler {
+    SampleMode mode = SampleMode::NONE;
+    uint64_t interval = 0;  // Instructions, or microseconds
+    uint64_t stride = 1;    // Only every `stride`th tick is sampled
+    uint64_t ticks = 0;
+    uint64_t next_sample = UINT64_MAX;  // Instruction count
+    size_t count = 0;
+    Sample samples[SAMPLE_BUFFER_SIZE];
+} Sampler;
+
+static Sampler sampler;
+
+// Set by `SIGPROF`, while a program is executing with a sample timer
+static volatile sig_atomic_t is_sample_due = 0;
+
+// Run loop stops at this count, to check the limit or take a sample
+static uint64_t instruction_stop = UINT64_MAX;
+
+void start_sampling(struct sigaction &previous);
+void stop_sampling(const struct sigaction &previous);
+void take_due_sample(void);
+void print_samples(FILE *const file);
+// Used by `start_sampling` and `take_due_sample`
+void update_instruction_stop(void);
+void handle_sample_timer(int signal);
+
+// Call stack must be enabled, to know current subroutine
+void start_sampling(struct sigaction &previous) {
+    sampler.next_sample = UINT64_MAX;
+    is_sample_due = 0;
+    if (sampler.mode == SampleMode::INSTRUCTIONS)
+        sampler.next_sample = instruction_count + sampler.interval;
+    update_instruction_stop();
+    if (sampler.mode != SampleMode::TIMER)
+        return;
+
+    struct sigaction action = {};
+    action.sa_handler = handle_sample_timer;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, &previous);
+    struct itimerval timer = {};
+    timer.it_interval.tv_sec = static_cast<time_t>(sampler.interval / 1000000);
+    timer.it_interval.tv_usec =
+        static_cast<suseconds_t>(sampler.interval % 1000000);
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+void stop_sampling(const struct sigaction &previous) {
+    if (sampler.mode != SampleMode::TIMER)
+        return;
+    const struct itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    sigaction(SIGPROF, &previous, nullptr);
+}
+
+// Does nothing if no sample is due (loop stopped for another reason)
+void take_due_sample() {
+    if (is_sample_due) {
+        is_sample_due = 0;
+    } else if (instruction_count >= sampler.next_sample) {
+        sampler.next_sample = instruction_count + sampler.interval;
+        update_instruction_stop();
+    } else {
+        return;
+    }
+
+    if (sampler.ticks++ % sampler.stride != 0)
+        return;
+    if (sampler.count == SAMPLE_BUFFER_SIZE) {
+        for (size_t i = 0; i < SAMPLE_BUFFER_SIZE / 2; ++i)
+            sampler.samples[i] = sampler.samples[i * 2];
+        sampler.count = SAMPLE_BUFFER_SIZE / 2;
+        sampler.stride *= 2;
+        sampler.ticks = 1;
+    }
+
+    sampler.samples[sampler.count++] = {
+        registers.program_counter, current_subroutine()
+    };
+}
+
+void print_samples(FILE *const file) {
+    fprintf(
+        file,
+        "\nSamples: %zu, every %llu %s\n",
+        sampler.count,
+        static_cast<unsigned long long>(sampler.interval * sampler.stride),
+        sampler.mode == SampleMode::TIMER ? "microseconds" : "instructions"
+    );
+    if (sampler.count == 0)
+        return;
+
+    vector<uint64_t> addresses(MEMORY_SIZE);
+    vector<uint64_t> subroutines(MEMORY_SIZE);
+    for (size_t i = 0; i < sampler.count; ++i) {
+        ++addresses[sampler.samples[i].program_counter];
+        ++subroutines[sampler.samples[i].subroutine];
+    }
+    print_profile_counts(
+        file, "Sampled addresses", addresses.data(), sampler.count
+    );
+
+    const vector<Word> sorted = sorted_profile_addresses(subroutines.data());
+    fprintf(file, "Sampled subroutines:\n");
+    for (size_t i = 0; i < sorted.size() && i < PROFILE_TOP_COUNT; ++i) {
+        fprintf(
+            file,
+            "    %10llu  %5.1f%%  ",
+            static_cast<unsigned long long>(subroutines[sorted[i]]),
+            100.0 * subroutines[sorted[i]] / sampler.count
+        );
+        print_symbolized_address(file, debug_info, sorted[i]);
+        fprintf(file, "\n");
+    }
+}
+
+void update_instruction_stop() {
+    instruction_stop = sampler.next_sample < instruction_limit
+                           ? sampler.next_sample
+                           : instruction_limit;
+}
+
+void handle_sample_timer(int signal) {
+    (void)signal;
+    is_sample_due = 1;
+}
+
+#endif
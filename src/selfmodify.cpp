@@ -0,0 +1,79 @@
+#ifndef SELFMODIFY_CPP
+#define SELFMODIFY_CPP
+
+#include <cstdint>  // uint64_t
+#include <cstdio>   // FILE, fprintf
+#include <cstring>  // memset
+
+#include "bitmap.cpp"
+#include "coverage.cpp"
+#include "debuginfo.cpp"
+#include "error.hpp"
+#include "globals.hpp"
+#include "types.hpp"
+
+// Stores (`ST`/`STR`/`STI`) into words which have already been executed
+// Every store is counted, but each address is only reported once
+// Strict mode fails the store instead, before memory is changed
+// Executed words are those recorded for coverage, which is recorded while
+//     either is enabled
+
+// TODO(refactor): Create header file for execute.cpp or extract functions
+void print_on_new_line(void);
+
+typedef struct SelfModify {
+    bool is_enabled = false;
+    bool is_strict = false;
+    AddressBitmap reported;
+    uint64_t stores;
+} SelfModify;
+
+static SelfModify self_modify;
+
+void start_self_modify(void);
+inline bool is_executed_word(const Word address);
+void report_self_modify(const Word address, Error &error);
+void print_self_modify(FILE *const file);
+
+void start_self_modify() {
+    memset(self_modify.reported, 0, sizeof(self_modify.reported));
+    self_modify.stores = 0;
+}
+
+inline bool is_executed_word(const Word address) {
+    return bitmap_test(coverage.executed, address);
+}
+
+// Called while store is executing, after program counter is incremented
+// Sets `error` in strict mode
+void report_self_modify(const Word address, Error &error) {
+    ++self_modify.stores;
+    const bool is_new = bitmap_set(self_modify.reported, address, true);
+    if (!self_modify.is_strict && !is_new)
+        return;
+
+    print_on_new_line();
+    fprintf(
+        stderr,
+        "%s to executed code at ",
+        self_modify.is_strict ? "Cannot store" : "Store"
+    );
+    print_symbolized_address(stderr, debug_info, address);
+    fprintf(stderr, ", by ");
+    print_symbolized_address(
+        stderr, debug_info, static_cast<Word>(registers.program_counter - 1)
+    );
+    fprintf(stderr, "\n");
+    if (self_modify.is_strict)
+        SET_ERROR(error, EXECUTE);
+}
+
+void print_self_modify(FILE *const file) {
+    fprintf(
+        file,
+        "\nSelf-modifying stores: %llu\n",
+        static_cast<unsigned long long>(self_modify.stores)
+    );
+}
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef STATS_CPP
+#define STATS_CPP
+
+#include <cstdint>  // uint64_t
+#include <cstdio>   // FILE, fopen, etc
+#include <ctime>    // clock_gettime
+
+#include "error.hpp"
+#include "globals.hpp"
+#include "types.hpp"
+
+// Reports of `execution_stats`, as a table or as JSON
+// Wall time includes time spent waiting for input
+
+// Indexed by opcode. Match names of `Opcode`
+static const char *const OPCODE_NAMES[] = {
+    "BR",  "ADD", "LD",  "ST",  "JSR_JSRR", "AND",      "LDR", "STR",
+    "RTI", "NOT", "LDI", "STI", "JMP_RET",  "RESERVED", "LEA", "TRAP",
+};
+
+// Standard and extension traps, always included in JSON
+static const struct {
+    TrapVector vector;
+    const char *name;
+} TRAP_NAMES[] = {
+    {TrapVector::GETC, "GETC"},
+    {TrapVector::OUT, "OUT"},
+    {TrapVector::PUTS, "PUTS"},
+    {TrapVector::IN, "IN"},
+    {TrapVector::PUTSP, "PUTSP"},
+    {TrapVector::HALT, "HALT"},
+    {TrapVector::REG, "REG"},
+    {TrapVector::DEBUG, "DEBUG"},
+};
+
+double monotonic_seconds(void);
+void print_stats(FILE *const file, const double seconds);
+void write_stats_json_file(
+    const char *const filename, const double seconds, Error &error
+);
+// Used by `print_stats` and `write_stats_json_file`
+const char *trap_name(const size_t vector);
+double instructions_per_microsecond(const double seconds);
+
+double monotonic_seconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<double>(time.tv_sec) +
+           static_cast<double>(time.tv_nsec) / 1e9;
+}
+
+void print_stats(FILE *const file, const double seconds) {
+    const unsigned long long total = instruction_count;
+    fprintf(file, "\nStatistics:\n");
+    fprintf(file, "    %-20s  %llu\n", "Instructions", total);
+    fprintf(file, "    %-20s  %.6f s\n", "Wall time", seconds);
+    fprintf(
+        file, "    %-20s  %.2f\n", "MIPS", instructions_per_microsecond(seconds)
+    );
+    const struct {
+        const char *name;
+        uint64_t count;
+    } counts[] = {
+        {"Loads", execution_stats.loads},
+        {"Stores", execution_stats.stores},
+        {"Branches taken", execution_stats.branches_taken},
+        {"Branches not taken", execution_stats.branches_not_taken},
+        {"Characters in", execution_stats.chars_in},
+        {"Characters out", execution_stats.chars_out},
+    };
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i) {
+        fprintf(
+            file,
+            "    %-20s  %llu\n",
+            counts[i].name,
+            static_cast<unsigned long long>(counts[i].count)
+        );
+    }
+    if (total == 0)
+        return;
+
+    fprintf(file, "Opcodes:\n");
+    for (size_t i = 0; i < 16; ++i) {
+        const uint64_t count = execution_stats.opcodes[i];
+        if (count == 0)
+            continue;
+        fprintf(
+            file,
+            "    %-20s  %-10llu  %5.1f%%\n",
+            OPCODE_NAMES[i],
+            static_cast<unsigned long long>(count),
+            100.0 * count / total
+        );
+    }
+    const uint64_t traps = execution_stats.opcodes[0xf];
+    if (traps == 0)
+        return;
+    fprintf(file, "Traps:\n");
+    for (size_t i = 0; i < 256; ++i) {
+        const uint64_t count = execution_stats.traps[i];
+        if (count == 0)
+            continue;
+        const char *const name = trap_name(i);
+        if (name != nullptr)
+            fprintf(file, "    %-20s  ", name);
+        else
+            fprintf(file, "    0x%02zx%16s  ", i, "");
+        fprintf(
+            file,
+            "%-10llu  %5.1f%%\n",
+            static_cast<unsigned long long>(count),
+            100.0 * count / traps
+        );
+    }
+}
+
+// Unknown trap vectors are only included if executed (such as an invalid one
+//     which failed), named like `"0x30"`
+void write_stats_json_file(
+    const char *const filename, const double seconds, Error &error
+) {
+    FILE *const file = fopen(filename, "w");
+    if (file == nullptr) {
+        fprintf(
+            stderr, "Failed to open statistics for writing: %s\n", filename
+        );
+        SET_ERROR(error, FILE);
+        return;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(
+        file,
+        "  \"instructions\": %llu,\n",
+        static_cast<unsigned long long>(instruction_count)
+    );
+    fprintf(file, "  \"wall_seconds\": %.6f,\n", seconds);
+    fprintf(file, "  \"mips\": %.2f,\n", instructions_per_microsecond(seconds));
+    fprintf(
+        file,
+        "  \"loads\": %llu,\n"
+        "  \"stores\": %llu,\n"
+        "  \"branches_taken\": %llu,\n"
+        "  \"branches_not_taken\": %llu,\n"
+        "  \"chars_in\": %llu,\n"
+        "  \"chars_out\": %llu,\n",
+        static_cast<unsigned long long>(execution_stats.loads),
+        static_cast<unsigned long long>(execution_stats.stores),
+        static_cast<unsigned long long>(execution_stats.branches_taken),
+        static_cast<unsigned long long>(execution_stats.branches_not_taken),
+        static_cast<unsigned long long>(execution_stats.chars_in),
+        static_cast<unsigned long long>(execution_stats.chars_out)
+    );
+
+    fprintf(file, "  \"opcodes\": {\n");
+    for (size_t i = 0; i < 16; ++i) {
+        fprintf(
+            file,
+            "    \"%s\": %llu%s\n",
+            OPCODE_NAMES[i],
+            static_cast<unsigned long long>(execution_stats.opcodes[i]),
+            i + 1 < 16 ? "," : ""
+        );
+    }
+    fprintf(file, "  },\n");
+
+    fprintf(file, "  \"traps\": {");
+    bool is_first = true;
+    for (size_t i = 0; i < 256; ++i) {
+        const uint64_t count = execution_stats.traps[i];
+        const char *const name = trap_name(i);
+        if (name == nullptr && count == 0)
+            continue;
+        fprintf(file, "%s\n", is_first ? "" : ",");
+        is_first = false;
+        if (name != nullptr)
+            fprintf(file, "    \"%s\": ", name);
+        else
+            fprintf(file, "    \"0x%02zx\": ", i);
+        fprintf(file, "%llu", static_cast<unsigned long long>(count));
+    }
+    fprintf(file, "\n  }\n");
+    fprintf(file, "}\n");
+
+    const bool failed = ferror(file) != 0;
+    if (fclose(file) != 0 || failed) {
+        fprintf(stderr, "Failed to write statistics: %s\n", filename);
+        SET_ERROR(error, FILE);
+    }
+}
+
+// `nullptr` if vector is not a known trap
+const char *trap_name(const size_t vector) {
+    for (size_t i = 0; i < sizeof(TRAP_NAMES) / sizeof(TRAP_NAMES[0]); ++i) {
+        if (static_cast<size_t>(TRAP_NAMES[i].vector) == vector)
+            return TRAP_NAMES[i].name;
+    }
+    return nullptr;
+}
+
+// Millions of instructions per second
+double instructions_per_microsecond(const double seconds) {
+    if (seconds <= 0)
+        return 0;
+    return static_cast<double>(instruction_count) / seconds / 1e6;
+}
+
+#endif
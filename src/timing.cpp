@@ -0,0 +1,278 @@
+#ifndef TIMING_CPP
+#define TIMING_CPP
+
+#include <cstdint>  // uint64_t
+#include <cstdio>   // FILE, fopen, etc
+#include <cstdlib>  // strtoull
+#include <cstring>  // strncasecmp, strcspn, etc
+
+#include "bitmasks.hpp"
+#include "debugger.cpp"
+#include "debuginfo.cpp"
+#include "globals.hpp"
+#include "profile.cpp"
+#include "types.hpp"
+
+// Cycles a program would take on the LC-3 microarchitecture, following the
+//     state machine of the textbook (Patt & Patel, appendix C)
+// Each state takes one cycle, except for memory accesses, which take
+//     `memory` cycles. Trap routines are executed by the simulator, so each
+//     is given a fixed cost instead
+// The run loop only calls `record_cycles` if built with `LASIM_TIMING`
+//     (`make TIMING=1`). Otherwise `--cycles` and `--cycle-costs` are rejected
+
+// Index into `cycle_costs`
+enum class CycleCost {
+    MEMORY,
+    FETCH,
+    ADD,
+    AND,
+    NOT,
+    BR,
+    BR_TAKEN,
+    JMP,
+    JSR,
+    JSRR,
+    LD,
+    LDR,
+    LDI,
+    LEA,
+    ST,
+    STR,
+    STI,
+    TRAP,
+    GETC,
+    OUT,
+    PUTS,
+    IN,
+    PUTSP,
+    HALT,
+    REG,
+    DEBUG,
+    COUNT,
+};
+
+typedef struct CycleCostEntry {
+    const char *name;
+    uint64_t cycles;  // States other than memory accesses
+    uint64_t memory_accesses;
+} CycleCostEntry;
+
+// Can be changed with a cost table file. MUST match order of `CycleCost`
+static CycleCostEntry cycle_costs[] = {
+    {"memory", 5, 0},
+    {"fetch", 3, 1},
+    {"ADD", 1, 0},
+    {"AND", 1, 0},
+    {"NOT", 1, 0},
+    {"BR", 1, 0},
+    {"BR_taken", 1, 0},
+    {"JMP", 1, 0},
+    {"JSR", 2, 0},
+    {"JSRR", 2, 0},
+    {"LD", 2, 1},
+    {"LDR", 2, 1},
+    {"LDI", 3, 2},
+    {"LEA", 1, 0},
+    {"ST", 2, 1},
+    {"STR", 2, 1},
+    {"STI", 3, 2},
+    {"TRAP", 2, 1},
+    {"GETC", 0, 0},
+    {"OUT", 0, 0},
+    {"PUTS", 0, 0},
+    {"IN", 0, 0},
+    {"PUTSP", 0, 0},
+    {"HALT", 0, 0},
+    {"REG", 0, 0},
+    {"DEBUG", 0, 0},
+};
+
+typedef struct Timing {
+    // Derived from `cycle_costs`, including fetch
+    uint64_t opcode_cycles[16];
+    uint64_t jsrr_cycles;
+    uint64_t branch_taken_cycles;  // In addition to `BR`
+    uint64_t trap_cycles[256];     // Only of trap routine
+    uint64_t total;
+    uint64_t subroutine_cycles[MEMORY_SIZE];  // Excluding called subroutines
+} Timing;
+
+static Timing timing;
+
+bool read_cycle_costs_file(const char *const filename);
+void update_cycle_tables(void);
+inline void record_cycles(const Word program_counter, const Word subroutine);
+void print_cycles(FILE *const file);
+// Used by `update_cycle_tables`
+uint64_t instruction_cycles(const CycleCost cost);
+
+// Each line is a name and a number of cycles, such as `memory 3`
+// Blank lines and lines starting with `#` are ignored
+bool read_cycle_costs_file(const char *const filename) {
+    FILE *const file = fopen(filename, "r");
+    if (file == nullptr) {
+        fprintf(stderr, "Failed to open cycle cost table: %s\n", filename);
+        return false;
+    }
+
+    char line[256];
+    size_t line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file) != nullptr) {
+        ++line_number;
+        const char *name = line;
+        while (*name == ' ' || *name == '\t')
+            ++name;
+        if (*name == '#' || *name == '\n' || *name == '\0')
+            continue;
+        const size_t name_length = strcspn(name, " \t\n");
+        const char *const value = name + name_length;
+        char *end;
+        const unsigned long long cycles = strtoull(value, &end, 10);
+        while (*end == ' ' || *end == '\t')
+            ++end;
+
+        size_t index = 0;
+        for (; index < static_cast<size_t>(CycleCost::COUNT); ++index) {
+            const char *const entry = cycle_costs[index].name;
+            if (strlen(entry) == name_length &&
+                !strncasecmp(entry, name, name_length))
+                break;
+        }
+        if (index == static_cast<size_t>(CycleCost::COUNT) || end == value ||
+            (*end != '\n' && *end != '\0') || strchr(value, '-') != nullptr) {
+            fprintf(
+                stderr,
+                "Invalid cycle cost on line %zu of %s\n",
+                line_number,
+                filename
+            );
+            ok = false;
+            break;
+        }
+        cycle_costs[index].cycles = cycles;
+    }
+    fclose(file);
+    return ok;
+}
+
+// Must be called before executing, and after changing `cycle_costs`
+void update_cycle_tables() {
+    const struct {
+        Opcode opcode;
+        CycleCost cost;
+    } opcodes[] = {
+        {Opcode::ADD, CycleCost::ADD},
+        {Opcode::AND, CycleCost::AND},
+        {Opcode::NOT, CycleCost::NOT},
+        {Opcode::BR, CycleCost::BR},
+        {Opcode::JMP_RET, CycleCost::JMP},
+        {Opcode::JSR_JSRR, CycleCost::JSR},
+        {Opcode::LD, CycleCost::LD},
+        {Opcode::LDR, CycleCost::LDR},
+        {Opcode::LDI, CycleCost::LDI},
+        {Opcode::LEA, CycleCost::LEA},
+        {Opcode::ST, CycleCost::ST},
+        {Opcode::STR, CycleCost::STR},
+        {Opcode::STI, CycleCost::STI},
+        {Opcode::TRAP, CycleCost::TRAP},
+    };
+    // Invalid instructions fail after fetch
+    for (size_t i = 0; i < 16; ++i)
+        timing.opcode_cycles[i] = instruction_cycles(CycleCost::FETCH);
+    for (size_t i = 0; i < sizeof(opcodes) / sizeof(opcodes[0]); ++i) {
+        timing.opcode_cycles[static_cast<size_t>(opcodes[i].opcode)] +=
+            instruction_cycles(opcodes[i].cost);
+    }
+    timing.jsrr_cycles = instruction_cycles(CycleCost::FETCH) +
+                         instruction_cycles(CycleCost::JSRR);
+    timing.branch_taken_cycles = instruction_cycles(CycleCost::BR_TAKEN);
+
+    const struct {
+        TrapVector vector;
+        CycleCost cost;
+    } traps[] = {
+        {TrapVector::GETC, CycleCost::GETC},
+        {TrapVector::OUT, CycleCost::OUT},
+        {TrapVector::PUTS, CycleCost::PUTS},
+        {TrapVector::IN, CycleCost::IN},
+        {TrapVector::PUTSP, CycleCost::PUTSP},
+        {TrapVector::HALT, CycleCost::HALT},
+        {TrapVector::REG, CycleCost::REG},
+        {TrapVector::DEBUG, CycleCost::DEBUG},
+    };
+    for (size_t i = 0; i < sizeof(traps) / sizeof(traps[0]); ++i) {
+        timing.trap_cycles[static_cast<size_t>(traps[i].vector)] =
+            instruction_cycles(traps[i].cost);
+    }
+}
+
+uint64_t instruction_cycles(const CycleCost cost) {
+    const CycleCostEntry &entry = cycle_costs[static_cast<size_t>(cost)];
+    return entry.cycles +
+           entry.memory_accesses *
+               cycle_costs[static_cast<size_t>(CycleCost::MEMORY)].cycles;
+}
+
+// Called after instruction at `program_counter` completed
+// `subroutine` is the one which was current before it executed, so caller is
+//     charged for `JSR`, and subroutine for `RET`
+inline void record_cycles(const Word program_counter, const Word subroutine) {
+    const Word instr = memory[program_counter];
+    uint64_t cycles = timing.opcode_cycles[bits_12_15(instr)];
+    switch (static_cast<Opcode>(bits_12_15(instr))) {
+        case Opcode::BR:
+            // Condition codes are not changed by `BR`
+            if ((bits_9_11(instr) &
+                 static_cast<uint8_t>(registers.condition)) != 0)
+                cycles += timing.branch_taken_cycles;
+            break;
+        case Opcode::JSR_JSRR:
+            if (bit_11(instr) == 0b0)
+                cycles = timing.jsrr_cycles;
+            break;
+        case Opcode::TRAP:
+            cycles += timing.trap_cycles[bits_0_8(instr)];
+            break;
+        default:
+            break;
+    }
+    timing.total += cycles;
+
+    timing.subroutine_cycles[subroutine] += cycles;
+}
+
+void print_cycles(FILE *const file) {
+    fprintf(
+        file,
+        "\nCycles: %llu (%.2f per instruction, %llu per memory access)\n",
+        static_cast<unsigned long long>(timing.total),
+        instruction_count == 0
+            ? 0.0
+            : static_cast<double>(timing.total) / instruction_count,
+        static_cast<unsigned long long>(
+            cycle_costs[static_cast<size_t>(CycleCost::MEMORY)].cycles
+        )
+    );
+    const vector<Word> subroutines =
+        sorted_profile_addresses(timing.subroutine_cycles);
+    if (subroutines.empty())
+        return;
+    fprintf(file, "Subroutines:\n");
+    for (size_t i = 0; i < subroutines.size(); ++i) {
+        const Word subroutine = subroutines[i];
+        fprintf(
+            file,
+            "    %10llu  %5.1f%%  ",
+            static_cast<unsigned long long>(
+                timing.subroutine_cycles[subroutine]
+            ),
+            100.0 * timing.subroutine_cycles[subroutine] / timing.total
+        );
+        print_symbolized_address(file, debug_info, subroutine);
+        fprintf(file, "\n");
+    }
+}
+
+#endif
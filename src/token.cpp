@@ -21,14 +21,21 @@ typedef char LabelString[MAX_LABEL];
 
 typedef struct LabelDefinition {
     LabelString name;
-    Word index;
+    size_t index;
 } LabelDefinition;
 
+// What a label reference is replaced with
+enum class ReferenceKind {
+    PC_OFFSET9,
+    PC_OFFSET11,  // Used for `JSR` only
+    ADDRESS,      // Used for `.FILL` only
+};
+
 typedef struct LabelReference {
     LabelString name;
-    Word index;
-    int line_number;   // For diagnostic
-    bool is_offset11;  // Used for `JSR` only
+    size_t index;
+    int line_number;  // For diagnostic
+    ReferenceKind kind;
 } LabelReference;
 
 enum class Directive {
@@ -37,6 +44,8 @@ enum class Directive {
     FILL,
     BLKW,
     STRINGZ,
+    EXTERNAL,
+    GLOBAL,
 };
 
 // TODO(feat/diagnostic): Warn on unused labels ?
@@ -48,6 +57,8 @@ static const char *const DIRECTIVE_NAMES[] = {
     "FILL",
     "BLKW",
     "STRINGZ",
+    "EXTERNAL",
+    "GLOBAL",
 };
 
 enum class Instruction {
@@ -138,15 +149,29 @@ typedef struct Token {
 } Token;
 
 // Note: 'take' here means increment the line pointer and return a token
-void take_next_token(const char *&line, Token &token, bool &failed);
+void take_next_token(
+    FILE *const diagnostics, const char *&line, Token &token, bool &failed
+);
 // Used by `take_next_token`
-void take_literal_string(const char *&line, Token &token, bool &failed);
-void take_directive(const char *&line, Token &token, bool &failed);
+void take_literal_string(
+    FILE *const diagnostics, const char *&line, Token &token, bool &failed
+);
+void take_directive(
+    FILE *const diagnostics, const char *&line, Token &token, bool &failed
+);
 void take_register(const char *&line, Token &token);
-void take_integer_token(const char *&line, Token &token, bool &failed);
-int take_integer(const char *&line, InitialSignWord &number);
-int take_integer_hex(const char *&line, InitialSignWord &number);
-int take_integer_decimal(const char *&line, InitialSignWord &number);
+void take_integer_token(
+    FILE *const diagnostics, const char *&line, Token &token, bool &failed
+);
+int take_integer(
+    FILE *const diagnostics, const char *&line, InitialSignWord &number
+);
+int take_integer_hex(
+    FILE *const diagnostics, const char *&line, InitialSignWord &number
+);
+int take_integer_decimal(
+    FILE *const diagnostics, const char *&line, InitialSignWord &number
+);
 int8_t parse_hex_digit(const char ch);
 bool append_decimal_digit_checked(
     Word &number, uint8_t digit, bool is_negative
@@ -155,7 +180,7 @@ bool is_char_eol(const char ch);
 bool is_char_valid_in_identifier(const char ch);
 bool is_char_valid_identifier_start(const char ch);
 
-void print_invalid_token(const char *const &line);
+void print_invalid_token(FILE *const diagnostics, const char *const &line);
 
 // Enums to/from string
 static const char *directive_to_string(const Directive directive);
@@ -169,7 +194,9 @@ static const char *token_kind_to_string(const TokenKind token_kind);
 // Debugging
 void _print_token(const Token &token);
 
-void take_next_token(const char *&line, Token &token, bool &failed) {
+void take_next_token(
+    FILE *const diagnostics, const char *&line, Token &token, bool &failed
+) {
     token.kind = TokenKind::EOL;
 
     // Ignore leading spaces
@@ -193,7 +220,7 @@ void take_next_token(const char *&line, Token &token, bool &failed) {
     }
 
     // String literal
-    take_literal_string(line, token, failed);
+    take_literal_string(diagnostics, line, token, failed);
     RETURN_IF_FAILED(failed);
     if (token.kind != TokenKind::EOL)
         return;  // Tried to parse, but failed
@@ -203,20 +230,20 @@ void take_next_token(const char *&line, Token &token, bool &failed) {
     RETURN_IF_FAILED(failed);
 
     // Directive
-    take_directive(line, token, failed);
+    take_directive(diagnostics, line, token, failed);
     RETURN_IF_FAILED(failed);
     if (token.kind != TokenKind::EOL)
         return;  // Tried to parse, but failed
 
     // Hex/decimal literal
-    take_integer_token(line, token, failed);
+    take_integer_token(diagnostics, line, token, failed);
     RETURN_IF_FAILED(failed);
     if (token.kind != TokenKind::EOL)
         return;  // Tried to parse, but failed
 
     // Character cannot start an identifier -> invalid
     if (!is_char_valid_identifier_start(line[0])) {
-        print_invalid_token(line);
+        print_invalid_token(diagnostics, line);
         failed = true;
         return;
     }
@@ -233,9 +260,9 @@ void take_next_token(const char *&line, Token &token, bool &failed) {
     if (!instruction_from_string_slice(token, identifier)) {
         // Label
         if (identifier.length >= MAX_LABEL) {
-            fprintf(stderr, "Label is over %d characters: `", MAX_LABEL);
-            print_string_slice(stderr, identifier);
-            fprintf(stderr, "`\n");
+            fprintf(diagnostics, "Label is over %d characters: `", MAX_LABEL);
+            print_string_slice(diagnostics, identifier);
+            fprintf(diagnostics, "`\n");
             failed = true;
             return;
         }
@@ -244,7 +271,9 @@ void take_next_token(const char *&line, Token &token, bool &failed) {
     }
 }
 
-void take_literal_string(const char *&line, Token &token, bool &failed) {
+void take_literal_string(
+    FILE *const diagnostics, const char *&line, Token &token, bool &failed
+) {
     if (line[0] != '"')
         return;
     ++line;  // Opening quote
@@ -254,7 +283,7 @@ void take_literal_string(const char *&line, Token &token, bool &failed) {
     for (; line[0] != '"'; ++line) {
         // String cannot be multi-line, or unclosed within a file
         if (line[0] == '\n' || line[0] == '\0') {
-            fprintf(stderr, "Unterminated string literal\n");
+            fprintf(diagnostics, "Unterminated string literal\n");
             failed = true;
             return;
         }
@@ -264,7 +293,9 @@ void take_literal_string(const char *&line, Token &token, bool &failed) {
     ++line;  // Closing quote
 }
 
-void take_directive(const char *&line, Token &token, bool &failed) {
+void take_directive(
+    FILE *const diagnostics, const char *&line, Token &token, bool &failed
+) {
     if (line[0] != '.')
         return;
     ++line;  // '.'
@@ -279,9 +310,9 @@ void take_directive(const char *&line, Token &token, bool &failed) {
 
     // Sets kind and value
     if (!directive_from_string(token, directive)) {
-        fprintf(stderr, "Invalid directive `.");
-        print_string_slice(stderr, directive);
-        fprintf(stderr, "`\n");
+        fprintf(diagnostics, "Invalid directive `.");
+        print_string_slice(diagnostics, directive);
+        fprintf(diagnostics, "`\n");
         failed = true;
     }
 }
@@ -305,7 +336,9 @@ void take_register(const char *&line, Token &token) {
 }
 
 // TODO(refactor): Change `int` return to `ParseResult` enum
-int take_integer_hex(const char *&line, InitialSignWord &integer) {
+int take_integer_hex(
+    FILE *const diagnostics, const char *&line, InitialSignWord &integer
+) {
     const char *new_line = line;
 
     bool is_signed = false;
@@ -357,7 +390,7 @@ int take_integer_hex(const char *&line, InitialSignWord &integer) {
         // Leading zeros have already been skipped
         // Ignore sign
         if (i >= 4) {
-            fprintf(stderr, "Integer literal is too large for a word\n");
+            fprintf(diagnostics, "Integer literal is too large for a word\n");
             return -1;
         }
         number <<= 4;
@@ -371,7 +404,9 @@ int take_integer_hex(const char *&line, InitialSignWord &integer) {
     return 1;
 }
 
-int take_integer_decimal(const char *&line, InitialSignWord &integer) {
+int take_integer_decimal(
+    FILE *const diagnostics, const char *&line, InitialSignWord &integer
+) {
     const char *new_line = line;
 
     bool is_signed = false;
@@ -413,7 +448,7 @@ int take_integer_decimal(const char *&line, InitialSignWord &integer) {
             break;
         }
         if (!append_decimal_digit_checked(number, ch - '0', is_signed)) {
-            fprintf(stderr, "Integer literal is too large for a word\n");
+            fprintf(diagnostics, "Integer literal is too large for a word\n");
             return -1;
         }
         ++line;
@@ -425,22 +460,26 @@ int take_integer_decimal(const char *&line, InitialSignWord &integer) {
     return 1;
 }
 
-int take_integer(const char *&line, InitialSignWord &integer) {
+int take_integer(
+    FILE *const diagnostics, const char *&line, InitialSignWord &integer
+) {
     int result;
-    result = take_integer_hex(line, integer);
+    result = take_integer_hex(diagnostics, line, integer);
     if (result != 0)
         return result;
-    result = take_integer_decimal(line, integer);
+    result = take_integer_decimal(diagnostics, line, integer);
     if (result != 0)
         return result;
     return 0;
 }
 
-void take_integer_token(const char *&line, Token &token, bool &failed) {
+void take_integer_token(
+    FILE *const diagnostics, const char *&line, Token &token, bool &failed
+) {
     const char *const line_start = line;
-    int result = take_integer(line, token.value.integer);
+    int result = take_integer(diagnostics, line, token.value.integer);
     if (result == -1) {
-        print_invalid_token(line_start);
+        print_invalid_token(diagnostics, line_start);
         failed = true;
         return;
     }
@@ -485,9 +524,9 @@ bool is_char_valid_identifier_start(const char ch) {
     return ch == '_' || isalpha(ch);
 }
 
-void print_invalid_token(const char *const &line) {
-    fprintf(stderr, "Invalid token: `");
-    fprintf(stderr, "%c", line[0]);
+void print_invalid_token(FILE *const diagnostics, const char *const &line) {
+    fprintf(diagnostics, "Invalid token: `");
+    fprintf(diagnostics, "%c", line[0]);
     // Print rest of instruction/label/integer if not starting with punctuation
     if (isalnum(line[0])) {
         for (size_t i = 1;; ++i) {
@@ -495,10 +534,10 @@ void print_invalid_token(const char *const &line) {
             // Only these symbols can terminate a label
             if (isspace(ch) || ch == ',' || ch == ':')
                 break;
-            fprintf(stderr, "%c", ch);
+            fprintf(diagnostics, "%c", ch);
         }
     }
-    fprintf(stderr, "`\n");
+    fprintf(diagnostics, "`\n");
 }
 
 static const char *directive_to_string(const Directive directive) {
@@ -0,0 +1,100 @@
+#ifndef TRACE_CPP
+#define TRACE_CPP
+
+#include <signal.h>  // sigaction, SIGINT
+
+#include <cstdint>  // uint64_t, UINT64_MAX
+#include <cstdio>   // FILE, fprintf
+
+#include "debuginfo.cpp"
+#include "disassemble.cpp"
+#include "globals.hpp"
+#include "types.hpp"
+
+// The most recent instructions are always recorded, so the path to an error
+//     can be printed after it happens
+// Recording is a single store per instruction, into a slot indexed by
+//     `instruction_count`. Undone instructions are simply overwritten
+
+#define TRACE_SIZE 64  // Must be a power of 2
+
+typedef struct TraceEntry {
+    Word program_counter;
+    Word instr;
+} TraceEntry;
+
+static TraceEntry trace[TRACE_SIZE];
+
+// Execution stops once this many instructions have completed
+static uint64_t instruction_limit = UINT64_MAX;
+
+// Set by SIGINT, while a program is executing
+static volatile sig_atomic_t is_interrupted = 0;
+
+inline void record_trace(const Word program_counter, const Word instr);
+void print_trace(FILE *const file);
+void catch_interrupts(struct sigaction &previous, const bool is_restarted);
+void restore_interrupts(const struct sigaction &previous);
+// Used by `catch_interrupts`
+void handle_interrupt(int signal);
+
+inline void record_trace(const Word program_counter, const Word instr) {
+    trace[instruction_count & (TRACE_SIZE - 1)] = {program_counter, instr};
+}
+
+// Oldest first. Includes an instruction which failed, as it was recorded
+//     before executing
+void print_trace(FILE *const file) {
+    // Failed instruction was still counted
+    const uint64_t end = instruction_count;
+    const uint64_t start = end > TRACE_SIZE ? end - TRACE_SIZE : 0;
+    if (start == end)
+        return;
+    fprintf(
+        file,
+        "Last %llu instruction%s:\n",
+        static_cast<unsigned long long>(end - start),
+        end - start == 1 ? "" : "s"
+    );
+    for (uint64_t i = start; i < end; ++i) {
+        const TraceEntry &entry = trace[i & (TRACE_SIZE - 1)];
+        char text[MAX_DISASSEMBLY];
+        format_instruction(
+            text,
+            decode_cached(entry.program_counter, entry.instr),
+            entry.program_counter,
+            debug_info,
+            false
+        );
+        fprintf(
+            file,
+            "    %8llu  %-20s  ",
+            static_cast<unsigned long long>(i + 1),
+            text
+        );
+        print_symbolized_address(file, debug_info, entry.program_counter);
+        fprintf(file, "\n");
+    }
+}
+
+// If `is_restarted`, reading input is not interrupted (used by debugger, which
+//     suspends execution rather than ending it)
+void catch_interrupts(struct sigaction &previous, const bool is_restarted) {
+    is_interrupted = 0;
+    struct sigaction action = {};
+    action.sa_handler = handle_interrupt;
+    action.sa_flags = is_restarted ? SA_RESTART : 0;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &previous);
+}
+
+void restore_interrupts(const struct sigaction &previous) {
+    sigaction(SIGINT, &previous, nullptr);
+}
+
+void handle_interrupt(int signal) {
+    (void)signal;
+    is_interrupted = 1;
+}
+
+#endif
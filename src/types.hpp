@@ -76,6 +76,19 @@ enum class TrapVector {
     DEBUG = 0x2f,
 };
 
+// Object files normally begin with the origin of their only segment, followed
+//     by its words. If the first word is this marker instead (which is never a
+//     useful origin), it is followed by an `ObjectKind` word, then the contents
+#define OBJECT_EXTENDED_MARKER 0xFFFF
+
+enum class ObjectKind {
+    // Any amount of segments, each as: origin, word count, words
+    // Execution starts at origin of first segment
+    SEGMENTED = 0x0001,
+    // Segment count, segments (as above), then symbols and fixups for linking
+    RELOCATABLE = 0x0002,
+};
+
 typedef struct ObjectFile {
     enum {
         FILE,
@@ -0,0 +1,93 @@
+#ifndef UNINITIALIZED_CPP
+#define UNINITIALIZED_CPP
+
+#include <cstdint>  // uint64_t
+#include <cstdio>   // FILE, fprintf
+#include <cstring>  // memset
+
+#include "bitmap.cpp"
+#include "debuginfo.cpp"
+#include "globals.hpp"
+#include "types.hpp"
+
+// Reads of memory which was never written, by the program or its object file
+// Memory is zero-filled when loaded, so these reads would otherwise go
+//     unnoticed. `.BLKW` words are not defined until written
+// Without line information (such as for a linked program), every word of the
+//     object file is defined
+
+// TODO(refactor): Create header file for execute.cpp or extract functions
+void print_on_new_line(void);
+
+typedef struct DefinedMemory {
+    bool is_enabled = false;
+    AddressBitmap bits;
+    uint64_t reads;  // Uninitialized reads reported
+} DefinedMemory;
+
+static DefinedMemory defined_memory;
+
+void start_defined_memory(void);
+inline void mark_defined(const Word address);
+inline bool is_defined(const Word address);
+void report_uninitialized_read(const Word address);
+void print_uninitialized_reads(FILE *const file);
+// Used by `start_defined_memory`
+void mark_defined_range(const size_t start, const size_t end);
+
+// Must be called after program is loaded
+void start_defined_memory() {
+    memset(defined_memory.bits, 0, sizeof(defined_memory.bits));
+    defined_memory.reads = 0;
+
+    const vector<LineEntry> &lines = debug_info.lines;
+    if (lines.empty()) {
+        mark_defined_range(memory_file_bounds.start, memory_file_bounds.end);
+        return;
+    }
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (lines[i].kind == LineKind::RESERVED)
+            continue;
+        const size_t end =
+            i + 1 < lines.size() ? lines[i + 1].address : MEMORY_SIZE;
+        mark_defined_range(lines[i].address, end);
+    }
+}
+
+void mark_defined_range(const size_t start, const size_t end) {
+    for (size_t address = start; address < end; ++address)
+        mark_defined(static_cast<Word>(address));
+}
+
+inline void mark_defined(const Word address) {
+    bitmap_set(defined_memory.bits, address, true);
+}
+
+inline bool is_defined(const Word address) {
+    return bitmap_test(defined_memory.bits, address);
+}
+
+// Called while instruction is executing, after program counter is incremented
+// Each address is only reported once
+void report_uninitialized_read(const Word address) {
+    ++defined_memory.reads;
+    mark_defined(address);
+    print_on_new_line();
+    fprintf(stderr, "Read of uninitialized memory at ");
+    print_symbolized_address(stderr, debug_info, address);
+    fprintf(stderr, ", by ");
+    print_symbolized_address(
+        stderr, debug_info, static_cast<Word>(registers.program_counter - 1)
+    );
+    fprintf(stderr, "\n");
+}
+
+void print_uninitialized_reads(FILE *const file) {
+    fprintf(
+        file,
+        "\nUninitialized reads: %llu\n",
+        static_cast<unsigned long long>(defined_memory.reads)
+    );
+}
+
+#endif
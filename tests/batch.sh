@@ -0,0 +1,25 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+[ -d "$out/batch" ] || mkdir "$out/batch"
+rm -f "$out/batch/"*
+for asm in "$examples/"*.asm; do
+    cp "$asm" -t "$out/batch"
+done
+
+# Assemble all files at once, then each file alone
+lasim -a "$out/batch/"*.asm
+
+echo '------'
+for asm in "$out/batch"/*.asm; do
+    filename="$(basename "${asm%%.asm}")"
+    obj_batch="$out/batch/$filename.obj"
+    obj_single="$out/batch/$filename.single.obj"
+
+    printf 'BATCH       %-18s' "$filename"
+
+    lasim -a "$asm" -o "$obj_single"
+    diff "$obj_single" "$obj_batch" >/dev/null
+    report_status $?
+done
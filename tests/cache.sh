@@ -0,0 +1,49 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+dir="$out/cache"
+actual_file="$out/cache.actual"
+expected_file="$tests/cache.expected"
+
+rm -rf "$dir"
+mkdir "$dir"
+cp "$examples/hello_world.asm" "$examples/fibonacci.asm" "$dir"
+# Segments covering all of memory
+printf '.ORIG x0000\n.BLKW x8000\n.END\n.ORIG x8000\n.BLKW x8000\n.END\n' \
+    > "$dir/full.asm"
+
+echo 'Miss' > "$actual_file"
+lasim -a "$dir/hello_world.asm" "$dir/full.asm" \
+    --cache "$dir/cache" --cache-stats 2>&1 |
+    sed 's/ in .*//' >> "$actual_file"
+cp "$dir/hello_world.obj" "$dir/hello_world.expected.obj"
+
+echo 'Hit' >> "$actual_file"
+lasim -a "$dir/hello_world.asm" "$dir/full.asm" \
+    --cache "$dir/cache" --cache-stats 2>&1 |
+    sed 's/ in .*//' >> "$actual_file"
+cmp "$dir/hello_world.obj" "$dir/hello_world.expected.obj" \
+    >> "$actual_file" 2>&1
+
+# Size of first segment is past end of words
+echo 'Corrupt' >> "$actual_file"
+for entry in "$dir/cache/"*.lac; do
+    printf '\017\377' |
+        dd of="$entry" bs=1 seek=14 conv=notrunc 2> /dev/null
+done
+lasim -a "$dir/hello_world.asm" \
+    --cache "$dir/cache" --cache-stats 2>&1 |
+    sed 's/ in .*//' >> "$actual_file"
+cmp "$dir/hello_world.obj" "$dir/hello_world.expected.obj" \
+    >> "$actual_file" 2>&1
+
+# Only the large entry, which is least recently used, is evicted
+echo 'Evict' >> "$actual_file"
+touch -d '2000-01-01' "$dir/cache/"*.lac
+lasim -a "$dir/hello_world.asm" "$dir/fibonacci.asm" \
+    --cache "$dir/cache" --cache-size 1 --cache-stats 2>&1 |
+    sed 's/ in .*//' >> "$actual_file"
+
+diff "$expected_file" "$actual_file"
+report_status $?
@@ -0,0 +1,19 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+actual_file="$out/cache_model.actual"
+expected_file="$tests/cache_model.expected"
+
+# Built with optional models by `make test`
+lasim_models() {
+    "$out/lasim_models" $@ || exit $?
+}
+
+lasim_models "$tests/call_profile.asm" --cache-model 16,4,2 \
+    2> "$actual_file" > /dev/null
+lasim_models "$tests/call_profile.asm" --cache-model 8,2,1,fifo \
+    2>> "$actual_file" > /dev/null
+
+diff "$expected_file" "$actual_file"
+report_status $?
@@ -0,0 +1,32 @@
+; Recursive subroutine calling a leaf at each level, for `--call-profile`
+.ORIG x3000
+
+    lea r6, Stack
+    and r0, r0, #0
+    add r0, r0, #5
+    JSR Recurse
+    JSR Leaf
+    HALT
+
+; Calls itself `R0` times
+Recurse
+    add r0, r0, #0
+    BRz RecurseEnd
+    add r6, r6, #-1
+    str r7, r6, #0
+    JSR Leaf
+    add r0, r0, #-1
+    JSR Recurse
+    ldr r7, r6, #0
+    add r6, r6, #1
+RecurseEnd
+    RET
+
+Leaf
+    add r1, r1, #1
+    RET
+
+    .BLKW 8
+Stack
+
+.END
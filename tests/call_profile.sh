@@ -0,0 +1,14 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+folded_file="$out/call_profile.folded"
+actual_file="$out/call_profile.actual"
+expected_file="$tests/call_profile.expected"
+
+lasim "$tests/call_profile.asm" --call-profile "$folded_file" \
+    2> "$actual_file" > /dev/null
+cat "$folded_file" >> "$actual_file"
+
+diff "$expected_file" "$actual_file"
+report_status $?
@@ -0,0 +1,20 @@
+; Branches on input, for `--coverage`
+.ORIG x3000
+
+    GETC
+    ld r1, NegY
+    add r1, r0, r1
+    BRz Yes
+    lea r0, NoString
+    PUTS
+    HALT
+Yes
+    lea r0, YesString
+    PUTS
+    HALT
+
+NegY        .FILL x-79
+YesString   .STRINGZ "yes"
+NoString    .STRINGZ "no"
+
+.END
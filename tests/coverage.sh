@@ -0,0 +1,26 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+data_file="$out/coverage.bin"
+lcov_file="$out/coverage.info"
+actual_file="$out/coverage.actual"
+expected_file="$tests/coverage.expected"
+
+rm -f "$data_file"
+printf 'n' | lasim "$tests/coverage.asm" \
+    --coverage-data "$data_file" --coverage "$lcov_file" \
+    2> "$actual_file" > /dev/null
+sed 's|^SF:.*/|SF:|' "$lcov_file" >> "$actual_file"
+# Merged with previous run
+printf 'y' | lasim "$tests/coverage.asm" \
+    --coverage-data "$data_file" --coverage "$lcov_file" \
+    2>> "$actual_file" > /dev/null
+sed 's|^SF:.*/|SF:|' "$lcov_file" >> "$actual_file"
+# Not merged with another program
+"$tests/../lasim" "$tests/profile.asm" --coverage-data "$data_file" \
+    2>> "$actual_file" > /dev/null
+echo "exit $?" >> "$actual_file"
+
+diff "$expected_file" "$actual_file"
+report_status $?
@@ -0,0 +1,10 @@
+; Caller is charged for `JSR` and `HALT`, and subroutine for `RET`
+.ORIG x3000
+
+    JSR Sub
+    HALT
+
+Sub
+    RET
+
+.END
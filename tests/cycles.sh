@@ -0,0 +1,25 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+costs_file="$out/cycles.costs"
+actual_file="$out/cycles.actual"
+expected_file="$tests/cycles.expected"
+
+# Built with optional models by `make test`
+lasim_models() {
+    "$out/lasim_models" $@ || exit $?
+}
+
+printf '# Slower memory\nmemory 10\n' > "$costs_file"
+lasim_models "$tests/call_profile.asm" --cycles 2> "$actual_file" > /dev/null
+lasim_models "$tests/call_profile.asm" --cycle-costs "$costs_file" \
+    2>> "$actual_file" > /dev/null
+lasim_models "$tests/cycles.asm" --cycles 2>> "$actual_file" > /dev/null
+# Script runs out before program ends, which stops debugger. Subroutines are
+#     still tracked for cycles
+lasim_models "$tests/cycles.asm" --cycles --debug-commands r \
+    2>> "$actual_file" > /dev/null
+
+diff "$expected_file" "$actual_file"
+report_status $?
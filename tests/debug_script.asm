@@ -0,0 +1,14 @@
+.ORIG 0x3000
+        AND R1, R1, #0
+        JSR OUTER
+        ADD R1, R1, #1
+        HALT
+OUTER   ST R7, SAVE
+        JSR INNER
+        JSR INNER
+        LD R7, SAVE
+        RET
+INNER   ADD R1, R1, #2
+        RET
+SAVE    .FILL 0
+.END
@@ -0,0 +1,19 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+output_actual_file="$out/debug_script.actual"
+output_expected_file="$tests/debug_script.expected"
+
+lasim "$tests/debug_script.asm" --debug-script "$tests/debug_script.txt" \
+    2> "$output_actual_file"
+
+# Invalid arguments are reported before the program is run
+for commands in 'b x3g00' 'mg' 'w x3000 if r1 ==' 'c 1'; do
+    "$project/lasim" "$tests/debug_script.asm" --debug-commands "$commands" \
+        2>> "$output_actual_file"
+    echo "exit $?" >> "$output_actual_file"
+done
+
+diff "$output_expected_file" "$output_actual_file"
+report_status $?
@@ -0,0 +1,17 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/segments.asm"
+obj_file="$out/disassemble.obj"
+source_file="$out/disassemble.asm"
+reassembled_file="$out/disassemble.reassembled.obj"
+
+# Source without debug info must assemble to the same object
+lasim -a "$asm_file" -o "$obj_file"
+rm -f "$out/disassemble.dbg"
+lasim --disassemble "$obj_file" -o "$source_file"
+lasim -a "$source_file" -o "$reassembled_file"
+
+cmp "$obj_file" "$reassembled_file"
+report_status $?
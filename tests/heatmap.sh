@@ -0,0 +1,18 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+csv_file="$out/heatmap.csv"
+binary_file="$out/heatmap.bin"
+actual_file="$out/heatmap.actual"
+expected_file="$tests/heatmap.expected"
+
+lasim "$tests/call_profile.asm" --heatmap "$csv_file" \
+    2> "$actual_file" > /dev/null
+cat "$csv_file" >> "$actual_file"
+lasim "$tests/call_profile.asm" --heatmap "$binary_file" \
+    2> /dev/null > /dev/null
+od -An -tx1 "$binary_file" >> "$actual_file"
+
+diff "$expected_file" "$actual_file"
+report_status $?
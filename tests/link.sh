@@ -0,0 +1,17 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+main_obj_file="$out/link_main.obj"
+lib_obj_file="$out/link_lib.obj"
+linked_obj_file="$out/link.obj"
+output_actual_file="$out/link.actual"
+output_expected_file="$tests/link.expected"
+
+lasim -a "$tests/link_main.asm" -o "$main_obj_file"
+lasim -a "$tests/link_lib.asm" -o "$lib_obj_file"
+lasim -l "$main_obj_file" "$lib_obj_file" -o "$linked_obj_file"
+lasim -x "$linked_obj_file" > "$output_actual_file"
+
+diff "$output_expected_file" "$output_actual_file"
+report_status $?
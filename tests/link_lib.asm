@@ -0,0 +1,16 @@
+; Library module, placed after the main program when linking
+.GLOBAL PRINT_LINE
+.GLOBAL GREETING
+.ORIG x5000
+PRINT_LINE
+    ST R7, SAVE_R7
+    PUTS
+    LD R0, NEWLINE
+    OUT
+    LD R7, SAVE_R7
+    RET
+SAVE_R7 .BLKW 1
+NEWLINE .FILL x0A
+GREETING_ADDR .FILL GREETING
+GREETING .STRINGZ "hello"
+.END
@@ -0,0 +1,17 @@
+; Main module, linked with link_lib.asm
+.EXTERNAL PRINT_LINE
+.EXTERNAL GREETING
+.GLOBAL MAIN
+.ORIG x3000
+MAIN
+    LD R0, GREETING_PTR
+    JSR PRINT_LINE
+    LEA R0, OWN
+    JSR PRINT_LINE
+    LD R0, OWN_PTR
+    JSR PRINT_LINE
+    HALT
+GREETING_PTR .FILL GREETING
+OWN_PTR .FILL OWN
+OWN .STRINGZ "own"
+.END
@@ -0,0 +1,21 @@
+; Nested loop calling a subroutine, for `--profile`
+.ORIG x3000
+
+    and r1, r1, #0
+    add r1, r1, #3
+Outer
+    and r2, r2, #0
+    add r2, r2, #4
+Inner
+    JSR Double
+    add r2, r2, #-1
+    BRp Inner
+    add r1, r1, #-1
+    BRp Outer
+    HALT
+
+Double
+    add r3, r3, r3
+    RET
+
+.END
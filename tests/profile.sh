@@ -0,0 +1,11 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+actual_file="$out/profile.actual"
+expected_file="$tests/profile.expected"
+
+lasim "$tests/profile.asm" --profile 2> "$actual_file" > /dev/null
+
+diff "$expected_file" "$actual_file"
+report_status $?
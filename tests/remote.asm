@@ -0,0 +1,14 @@
+; Stops at `DEBUG`, after client has disconnected, for `--debug-server`
+.ORIG x3000
+
+    LEA r0, Before
+    PUTS
+    DEBUG
+    LEA r0, After
+    PUTS
+    HALT
+
+Before .STRINGZ "Before\n"
+After .STRINGZ "After\n"
+
+.END
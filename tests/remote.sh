@@ -0,0 +1,28 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+actual_file="$out/remote.actual"
+expected_file="$tests/remote.expected"
+socket="$out/remote.sock"
+
+# Client resumes and disconnects, so replies fail. Program continues without
+#     debugger, instead of being ended by `SIGPIPE`
+rm -f "$socket"
+"$tests/../lasim" "$tests/remote.asm" --debug-server "$socket" \
+    > "$actual_file" 2> /dev/null &
+server=$!
+for _ in $(seq 50); do
+    [ -S "$socket" ] && break
+    sleep 0.1
+done
+perl -MIO::Socket::UNIX -e '
+    $client = IO::Socket::UNIX->new(Peer => $ARGV[0]) or die;
+    print $client q($c#63);
+    close $client;
+' "$socket"
+wait $server
+echo "exit $?" >> "$actual_file"
+
+diff "$expected_file" "$actual_file"
+report_status $?
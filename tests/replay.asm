@@ -0,0 +1,12 @@
+.ORIG 0x3000
+LOOP    GETC
+        ADD R1, R0, #-10
+        BRz DONE
+        OUT
+        OUT
+        BR LOOP
+DONE    LEA R0, MSG
+        PUTS
+        HALT
+MSG     .STRINGZ "bye"
+.END
@@ -0,0 +1,17 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+log_file="$out/replay.log"
+record_actual_file="$out/replay_record.actual"
+replay_actual_file="$out/replay.actual"
+output_expected_file="$tests/replay.expected"
+
+printf 'abc\n' | lasim "$tests/replay.asm" --record "$log_file" \
+    > "$record_actual_file"
+lasim "$tests/replay.asm" --replay "$log_file" < /dev/null \
+    > "$replay_actual_file"
+
+diff "$record_actual_file" "$replay_actual_file" &&
+    diff "$output_expected_file" "$replay_actual_file"
+report_status $?
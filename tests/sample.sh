@@ -0,0 +1,11 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+actual_file="$out/sample.actual"
+expected_file="$tests/sample.expected"
+
+lasim "$tests/call_profile.asm" --sample 7 2> "$actual_file" > /dev/null
+
+diff "$expected_file" "$actual_file"
+report_status $?
@@ -0,0 +1,24 @@
+; Code, data, and a subroutine in separate segments
+; Output: ABhello
+
+.ORIG x3000
+    LD R0, CHAR
+    OUT
+    JSR PRINT_B
+    LEA R0, MESSAGE
+    PUTS
+    HALT
+CHAR .FILL x41
+.END
+
+.ORIG x30f0
+MESSAGE .STRINGZ "hello"
+.END
+
+.ORIG x3100
+PRINT_B
+    LD R0, CHAR_B
+    OUT
+    RET
+CHAR_B .FILL x42
+.END
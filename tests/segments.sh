@@ -0,0 +1,15 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/segments.asm"
+obj_file="$out/segments.obj"
+output_actual_file="$out/segments.actual"
+output_expected_file="$tests/segments.expected"
+
+# Separate steps, to read segmented object file
+lasim -a "$asm_file" -o "$obj_file"
+lasim -x "$obj_file" > "$output_actual_file"
+
+diff "$output_expected_file" "$output_actual_file"
+report_status $?
@@ -0,0 +1,21 @@
+; Stores into executed code, for `--check-self-modify`
+.ORIG x3000
+
+    and r2, r2, #0
+    add r2, r2, #3
+Loop
+    ld r1, NewInstruction
+    st r1, Patched          ; Executed after first iteration
+    st r1, Data             ; Never executed
+    add r2, r2, #-1
+    BRz Done
+Patched
+    add r0, r0, #1
+    BR Loop
+Done
+    HALT
+
+NewInstruction  add r0, r0, #2
+Data            .FILL x0
+
+.END
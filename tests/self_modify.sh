@@ -0,0 +1,16 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+actual_file="$out/self_modify.actual"
+expected_file="$tests/self_modify.expected"
+
+lasim "$tests/self_modify.asm" --check-self-modify \
+    2> "$actual_file" > /dev/null
+# Fails at first store
+"$tests/../lasim" "$tests/self_modify.asm" --strict-self-modify \
+    2>> "$actual_file" > /dev/null
+echo "exit $?" >> "$actual_file"
+
+diff "$expected_file" "$actual_file"
+report_status $?
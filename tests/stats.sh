@@ -0,0 +1,14 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+json_file="$out/stats.json"
+actual_file="$out/stats.actual"
+expected_file="$tests/stats.expected"
+
+lasim "$tests/call_profile.asm" --stats-json "$json_file" > /dev/null
+# Time varies between runs
+grep -v -e '"wall_seconds"' -e '"mips"' "$json_file" > "$actual_file"
+
+diff "$expected_file" "$actual_file"
+report_status $?
@@ -47,4 +47,181 @@ int main() {
               does_positive_integer_fit_size(-0x7fff, 5), false);
     assert_eq("Negative number doesn't fit in size",
               does_positive_integer_fit_size(-0x8000, 5), false);
+
+    // FNV-1a reference values
+    assert_eq("Hash of nothing", hash_bytes("", 0, FNV_OFFSET_BASIS) ==
+              FNV_OFFSET_BASIS, true);
+    assert_eq("Hash of byte", hash_bytes("a", 1, FNV_OFFSET_BASIS) ==
+              0xaf63dc4c8601ec8cULL, true);
+    assert_eq("Hash continues", hash_bytes("b", 1, hash_bytes("a", 1,
+              FNV_OFFSET_BASIS)) == hash_bytes("ab", 2, FNV_OFFSET_BASIS),
+              true);
+
+    // Debug info lookups
+    DebugInfo info;
+    add_debug_symbol(info, "LOOP", 0x3004);
+    add_debug_symbol(info, "start", 0x3000);
+    add_debug_line(info, 0x3000, 3, LineKind::CODE);
+    add_debug_line(info, 0x3004, 7, LineKind::DATA);
+    add_debug_line(info, 0x3008, 0, LineKind::RESERVED);
+    sort_debug_info(info);
+    assert_eq("Symbol before start", find_symbol_before(info, 0x2fff) ==
+              nullptr, true);
+    assert_eq("Symbol at address", find_symbol_before(info, 0x3004)->address,
+              0x3004);
+    assert_eq("Symbol before address", find_symbol_before(info, 0x3006)->
+              address, 0x3004);
+    assert_eq("Line before start", find_source_line(info, 0x2fff), 0u);
+    assert_eq("Line of address", find_source_line(info, 0x3005), 7u);
+    assert_eq("Line after end", find_source_line(info, 0x3008), 0u);
+    StringSlice name = {"loop", 4};
+    assert_eq("Symbol by name", find_symbol_by_name(info, name)->address,
+              0x3004);
+    name = {"LOO", 3};
+    assert_eq("Unknown symbol", find_symbol_by_name(info, name) == nullptr,
+              true);
+    char filename[FILENAME_MAX];
+    replace_filename_extension(filename, "dir.v2/prog.obj", "asm");
+    assert_eq("Extension replaced", !strcmp(filename, "dir.v2/prog.asm"),
+              true);
+    replace_filename_extension(filename, "dir.v2/prog", "asm");
+    assert_eq("Extension added", !strcmp(filename, "dir.v2/prog.asm"), true);
+
+    // Breakpoint bitmap
+    assert_eq("Breakpoint added", set_breakpoint(0x3040, true), true);
+    assert_eq("Breakpoint not added twice", set_breakpoint(0x3040, true),
+              false);
+    assert_eq("Breakpoint is set", is_breakpoint(0x3040), true);
+    assert_eq("Neighbour is not set", is_breakpoint(0x3041), false);
+    assert_eq("Breakpoint removed", set_breakpoint(0x3040, false), true);
+    assert_eq("Breakpoint is not set", is_breakpoint(0x3040), false);
+    assert_eq("No breakpoints remain", breakpoints.count == 0, true);
+
+    // Watchpoint ranges
+    assert_eq("Watchpoints added",
+              set_watchpoints(watchpoints.writes, 0x3010, 0x3013, true) == 4,
+              true);
+    assert_eq("Overlapping watchpoints added",
+              set_watchpoints(watchpoints.writes, 0x3012, 0x3014, true) == 1,
+              true);
+    check_watchpoint(false, 0x3012, 0x0001, 0x0001);
+    assert_eq("Read is not watched", watchpoints.triggered, false);
+    registers.program_counter = 0x3001;
+    check_watchpoint(true, 0x3012, 0x0001, 0x0002);
+    assert_eq("Write is watched", watchpoints.triggered, true);
+    assert_eq("PC of watched write", watchpoints.hit.program_counter, 0x3000);
+    assert_eq("New value of watched write", watchpoints.hit.new_value, 0x0002);
+    watchpoints.triggered = false;
+    assert_eq("Watchpoints removed",
+              set_watchpoints(watchpoints.writes, 0x3000, 0x3020, false) == 5,
+              true);
+    assert_eq("No watchpoints remain", watchpoints.count == 0, true);
+
+    // Breakpoint conditions
+    Condition condition;
+    registers.general_purpose[3] = 0;
+    registers.condition = ConditionCode::ZERO;
+    memory[0x4000] = 11;
+    assert_eq("Condition compiles",
+              compile_condition(stderr, "r3 == 0 && mem[x4000] > 10",
+                                condition),
+              true);
+    assert_eq("Condition is true", evaluate_condition(condition), true);
+    memory[0x4000] = 10;
+    assert_eq("Condition is false", evaluate_condition(condition), false);
+    compile_condition(stderr, "(r3 - 1) < 0 && z && !n", condition);
+    assert_eq("Signed comparison and flags", evaluate_condition(condition),
+              true);
+    assert_eq("Incomplete condition",
+              compile_condition(stderr, "r3 ==", condition), false);
+    assert_eq("Trailing characters",
+              compile_condition(stderr, "r3 r4", condition), false);
+    memory[0x4000] = 0;
+
+    // Shadow call stack
+    push_call_frame(0x3001, 0x3010);
+    push_call_frame(0x3011, 0x3020);
+    call_stack.stop_depth = 1;
+    pop_call_frame();
+    assert_eq("Return reaches stop depth", call_stack.returned, true);
+    assert_eq("Outer frame remains", call_stack.frames[0].call_site, 0x3001);
+    pop_call_frame();
+    pop_call_frame();
+    assert_eq("Unmatched return is ignored", call_stack.depth == 0, true);
+    call_stack.stop_depth = NO_STOP_DEPTH;
+    call_stack.returned = false;
+
+    // Undo log
+    undo_log.is_enabled = true;
+    registers.program_counter = 0x3000;
+    registers.general_purpose[1] = 0x0001;
+    memory[0x3050] = 0x1234;
+    memory[0x3000] = 0x1261;  // ADD R1, R1, #1
+    begin_undo_entry();
+    registers.program_counter = 0x3001;
+    registers.general_purpose[1] = 0x0002;
+    registers.condition = ConditionCode::POSITIVE;
+    record_undo_memory(0x3050, memory[0x3050]);
+    memory[0x3050] = 0x5678;
+    end_undo_entry();
+    assert_eq("Instruction undone", undo_instruction(), true);
+    assert_eq("PC restored", registers.program_counter, 0x3000);
+    assert_eq("Register restored", registers.general_purpose[1], 0x0001);
+    assert_eq("Memory restored", memory[0x3050], 0x1234);
+    assert_eq("Condition restored",
+              registers.condition == ConditionCode::ZERO, true);
+    assert_eq("Nothing more to undo", undo_instruction(), false);
+    undo_log.is_enabled = false;
+    memory[0x3050] = 0;
+
+    // Trace ring buffer
+    instruction_count = TRACE_SIZE + 1;
+    record_trace(0x3001, 0x1234);
+    assert_eq("Trace wraps around", trace[1].instr, 0x1234);
+    assert_eq("Trace records PC", trace[1].program_counter, 0x3001);
+    instruction_count = 0;
+
+    // Disassembler
+    char text[MAX_DISASSEMBLY];
+    DebugInfo labels;
+    DecodedInstruction decoded;
+    decode_instruction(0x3000, 0x0ffe, decoded);
+    format_instruction(text, decoded, 0x3000, labels, true);
+    assert_eq("Branch target as offset", strcmp(text, "BR #-2"), 0);
+    add_debug_symbol(labels, "LOOP", 0x2fff);
+    sort_debug_info(labels);
+    format_instruction(text, decoded, 0x3000, labels, true);
+    assert_eq("Branch target as label", strcmp(text, "BR LOOP"), 0);
+    decode_instruction(0x3000, 0x1a98, decoded);
+    assert_eq("Invalid padding is not an instruction", decoded.is_valid,
+              false);
+    decode_instruction(0x3000, 0x7e7f, decoded);
+    format_instruction(text, decoded, 0x3000, labels, false);
+    assert_eq("Negative offset", strcmp(text, "STR R7, R1, #-1"), 0);
+    assert_eq("Cache is invalidated by a new word",
+              decode_cached(0x3000, 0xf025).instruction == Instruction::HALT,
+              true);
+
+    // Remote debugging packets
+    std::vector<char> reply;
+    memory[0x3000] = 0x1234;
+    memory[0x3001] = 0xabcd;
+    handle_remote_packet("m6000,4", 7, reply);
+    assert_eq("Memory is read as bytes",
+              reply.size() == 8 && !memcmp(reply.data(), "1234abcd", 8),
+              true);
+    reply.clear();
+    handle_remote_packet("M6003,1:ef", 10, reply);
+    assert_eq("Memory byte is written", memory[0x3001], 0xabef);
+    reply.clear();
+    handle_remote_packet("Z0,6002,2", 9, reply);
+    assert_eq("Breakpoint is set", is_breakpoint(0x3001), true);
+    handle_remote_packet("z0,6002,2", 9, reply);
+    assert_eq("Breakpoint is removed", is_breakpoint(0x3001), false);
+    assert_eq("Continue resumes",
+              handle_remote_packet("c", 1, reply) == DebuggerAction::CONTINUE,
+              true);
+    assert_eq("Checksum", remote_checksum("OK", 2), 0x9a);
+    memory[0x3000] = 0;
+    memory[0x3001] = 0;
 }
@@ -0,0 +1,27 @@
+; Recursion deeper than the recorded call stack, for undoing `RET`
+.ORIG x3000
+
+    ld r0, Depth
+    ld r6, StackAddress
+    JSR Recurse
+    HALT
+
+Depth           .FILL #1030
+StackAddress    .FILL Stack
+
+; Calls itself `R0` times
+Recurse
+    add r0, r0, #-1
+    BRz Return
+    add r6, r6, #-1
+    str r7, r6, #0
+    JSR Recurse
+    ldr r7, r6, #0
+    add r6, r6, #1
+Return
+    RET
+
+    .BLKW #1030
+Stack
+
+.END
@@ -0,0 +1,13 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+actual_file="$out/undo.actual"
+expected_file="$tests/undo.expected"
+
+# Frames of recursive calls are counted
+lasim "$tests/undo.asm" --debug-script "$tests/undo.txt" 2>&1 |
+    uniq -c > "$actual_file"
+
+diff "$expected_file" "$actual_file"
+report_status $?
@@ -0,0 +1,22 @@
+; Reads of defined and uninitialized memory, for `--check-uninitialized`
+.ORIG x3000
+
+    ld r1, Defined
+    ld r2, Buffer           ; Uninitialized
+    ld r2, Buffer           ; Only reported once
+    st r1, Buffer
+    ld r2, Buffer
+    lea r3, Buffer
+    ldr r2, r3, #1          ; Uninitialized
+    ; First character is written, but terminator is not
+    lea r0, String
+    add r1, r1, #0
+    str r1, r0, #0
+    PUTS
+    HALT
+
+Defined     .FILL x41
+Buffer      .BLKW 2
+String      .BLKW 2
+
+.END
@@ -0,0 +1,12 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+actual_file="$out/uninitialized.actual"
+expected_file="$tests/uninitialized.expected"
+
+lasim "$tests/uninitialized.asm" --check-uninitialized \
+    2> "$actual_file" > /dev/null
+
+diff "$expected_file" "$actual_file"
+report_status $?